@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+    #include <fcntl.h>
+    #include <io.h>
+    #define DEVNULL "NUL"
+    #define OPEN    _open
+    #define CLOSE   _close
+#else
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <unistd.h>
+    #define DEVNULL "/dev/null"
+    #define OPEN    open
+    #define CLOSE   close
+#endif
+
+#include "c-log.h"  // interface only; impl compiled in src/c-log-impl.c
+
+unsigned callsites_hot_loop(const unsigned *pkts, unsigned n);
+
+enum { PKTS = 4096, ROUNDS = 256 };
+
+static double bench_hot_loop(const unsigned *pkts, unsigned *sink) {
+    uint64_t t0 = clog_now_ns_mono_();
+    for (int r = 0; r < ROUNDS; r++) *sink += callsites_hot_loop(pkts, PKTS);
+    return (double)(clog_now_ns_mono_() - t0) / ((double)ROUNDS * PKTS);
+}
+
+#if !defined(_WIN32)
+/* holds a TRACE override while the main thread runs the disabled hot loop: it must not cost that thread anything */
+static pthread_mutex_t hold_mu    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  hold_cv    = PTHREAD_COND_INITIALIZER;
+static int             hold_state = 0; /* 1 override set, 2 released */
+
+static void *override_holder(void *arg) {
+    (void)arg;
+    clog_thread_set_level(CLOG_TRACE);
+    pthread_mutex_lock(&hold_mu);
+    hold_state = 1;
+    pthread_cond_broadcast(&hold_cv);
+    while (hold_state != 2) pthread_cond_wait(&hold_cv, &hold_mu);
+    pthread_mutex_unlock(&hold_mu);
+    return NULL;
+}
+
+static double bench_other_override(const unsigned *pkts, unsigned *sink) {
+    pthread_t th;
+    if (pthread_create(&th, NULL, override_holder, NULL) != 0) return -1.0;
+    pthread_mutex_lock(&hold_mu);
+    while (hold_state != 1) pthread_cond_wait(&hold_cv, &hold_mu);
+    pthread_mutex_unlock(&hold_mu);
+    double ns = bench_hot_loop(pkts, sink);
+    pthread_mutex_lock(&hold_mu);
+    hold_state = 2;
+    pthread_cond_broadcast(&hold_cv);
+    pthread_mutex_unlock(&hold_mu);
+    pthread_join(th, NULL);
+    return ns;
+}
+#endif
+
+static double bench_enabled(int n) {
+    uint64_t t0 = clog_now_ns_mono_();
+    for (int i = 0; i < n; i++) log_info_group("bench", "record %d of %d: %s", i, n, "payload");
+    return (double)(clog_now_ns_mono_() - t0) / (double)n;
+}
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 200000;
+    if (n <= 0) n = 200000;
+
+    static unsigned pkts[PKTS];
+    for (unsigned i = 0; i < PKTS; i++) pkts[i] = (i * 2654435761u) >> 20;
+
+    int fd = OPEN(DEVNULL, O_WRONLY);
+    if (fd < 0) {
+        perror(DEVNULL);
+        return 1;
+    }
+    int saved = clog_get_fd();
+    clog_set_fd(fd);
+
+    unsigned sink = 0;
+    clog_set_level(CLOG_ERROR);
+    double disabled = bench_hot_loop(pkts, &sink);
+#if !defined(_WIN32)
+    double other = bench_other_override(pkts, &sink);
+#endif
+    clog_set_level(CLOG_INFO);
+    double enabled = bench_enabled(n);
+
+    clog_set_fd(saved);
+    CLOSE(fd);
+
+    printf("hot loop, 32 disabled sites: %8.2f ns/pkt (sink %u)\n", disabled, sink);
+#if !defined(_WIN32)
+    printf("  same, another thread at TRACE: %8.2f ns/pkt\n", other);
+#endif
+    printf("enabled record to " DEVNULL ":  %8.2f ns/record\n", enabled);
+    return 0;
+}
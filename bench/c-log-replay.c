@@ -0,0 +1,399 @@
+// c-log-replay — replay a workload trace recorded with clog_record_start() against this build of the logger.
+//
+//   c-log-replay [-r] [-x SPEED] [-n ROUNDS] [-l LEVEL] [-o FILE] TRACE
+//
+// Every recorded thread gets a replay thread that makes the same calls (site, level, format, argument types)
+// with synthetic arguments of the recorded sizes, through the same gate and front-end the log macros use. By
+// default calls run back to back; -r keeps the recorded inter-arrival times (divided by SPEED). Output goes to
+// /dev/null unless -o is given. Rebuild with different CLOG_* options and compare the ns/call figures.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c-log.h"  // interface only; impl compiled in src/c-log-impl.c
+
+#define MAX_ARGS 6 /* typed arguments per call; wider sites are replayed as one string of the rendered length */
+#define FILL_MAX 65535
+
+typedef struct {
+    char *file, *group, *fmt; /* fmt: rewritten so every argument is long long, double or a pointer */
+    int   line;
+    int   nsz;   /* sizes per 'R' entry */
+    int   nargs; /* typed arguments to pass; -1: one string as long as all sizes together */
+    char  cls[16];
+    clog_psite_ ps; /* the prefix cache slot a macro expansion at this site would own */
+} site_t;
+
+typedef struct {
+    const unsigned char **recs; /* 'R' entries */
+    size_t                n, cap;
+    uint64_t              calls, ns;
+    pthread_t             th;
+} thr_t;
+
+static site_t      *g_sites;
+static size_t       g_nsites, g_emitted;
+static thr_t        g_thr[256];
+static char         g_fill[FILL_MAX + 1];
+static int          g_realtime, g_rounds = 1;
+static double       g_speed = 1.0;
+static volatile int g_go;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint16_t rd16(const unsigned char *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static char *rdstr(const unsigned char **pp, const unsigned char *end) {
+    if (end - *pp < 2) return NULL;
+    size_t n = rd16(*pp);
+    *pp += 2;
+    if ((size_t)(end - *pp) < n) return NULL;
+    char *s = malloc(n + 1);
+    if (!s) return NULL;
+    memcpy(s, *pp, n);
+    s[n] = '\0';
+    *pp += n;
+    return s;
+}
+
+/* drop '*' width/precision and length modifiers; integers become %ll?, %c becomes %s of one char */
+static char *rewrite_fmt(const char *fmt) {
+    char *out = malloc(strlen(fmt) * 2 + 8), *o = out;
+    if (!out) return NULL;
+    for (const char *p = fmt; *p;) {
+        if (*p != '%' || p[1] == '%') {
+            if (*p == '%') *o++ = *p++;
+            *o++ = *p++;
+            continue;
+        }
+        *o++ = *p++;
+        while (*p && strchr("-+ #0", *p)) *o++ = *p++;
+        if (*p == '*') ++p;
+        while (*p >= '0' && *p <= '9') *o++ = *p++;
+        if (*p == '.') {
+            if (p[1] == '*') {
+                p += 2;
+            } else {
+                *o++ = *p++;
+                while (*p >= '0' && *p <= '9') *o++ = *p++;
+            }
+        }
+        while (*p && strchr("hljztL", *p)) ++p;
+        if (!*p) break;
+        char c = *p++;
+        if (strchr("diouxX", c)) {
+            *o++ = 'l';
+            *o++ = 'l';
+            *o++ = c;
+        } else {
+            *o++ = c == 'c' ? 's' : c;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+static int load(const char *path, unsigned char **bufp) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "c-log-replay: %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    size_t         size = (size_t)st.st_size, got = 0;
+    unsigned char *buf  = malloc(size ? size : 1);
+    while (buf && got < size) {
+        ssize_t r = read(fd, buf + got, size - got);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    close(fd);
+    if (!buf || got != size || size < 8 || memcmp(buf, "CLOGREC1", 8) != 0) {
+        fprintf(stderr, "c-log-replay: %s: not a c-log trace\n", path);
+        free(buf);
+        return -1;
+    }
+    *bufp = buf;
+
+    const unsigned char *p = buf + 8, *end = buf + size;
+    g_sites                = calloc(65536, sizeof *g_sites);
+    if (!g_sites) return -1;
+    while (p < end) {
+        if (*p == 'S' && end - p >= 7) {
+            uint16_t id = rd16(p + 1);
+            int32_t  line;
+            memcpy(&line, p + 3, sizeof line);
+            p += 7;
+            site_t *s = &g_sites[id];
+            s->line   = line;
+            s->file   = rdstr(&p, end);
+            s->group  = rdstr(&p, end);
+            char *fmt = rdstr(&p, end);
+            if (!s->file || !s->group || !fmt || p >= end) break;
+            unsigned n = *p++;
+            if (n != 0xff) {
+                if ((size_t)(end - p) < n || n > sizeof s->cls) break;
+                memcpy(s->cls, p, n);
+                p += n;
+            }
+            s->nsz   = n == 0xff ? 1 : (int)n;
+            s->nargs = n == 0xff || n > MAX_ARGS ? -1 : (int)n; /* untyped or too wide: sizes summed */
+            s->fmt   = s->nargs >= 0 ? rewrite_fmt(fmt) : strdup("%s");
+            free(fmt);
+            if ((size_t)id + 1 > g_nsites) g_nsites = (size_t)id + 1;
+        } else if (*p == 'R' && end - p >= 10) {
+            const site_t *s   = &g_sites[rd16(p + 1)];
+            size_t        len = 10 + 2 * (size_t)s->nsz;
+            thr_t        *t   = &g_thr[p[4]];
+            if ((size_t)(end - p) < len || !s->fmt) break;
+            if (t->n == t->cap) {
+                t->cap  = t->cap ? t->cap * 2 : 1024;
+                t->recs = realloc(t->recs, t->cap * sizeof *t->recs);
+                if (!t->recs) return -1;
+            }
+            t->recs[t->n++] = p;
+            g_emitted += p[5];
+            p += len;
+        } else {
+            break;
+        }
+    }
+    if (p != end) {
+        fprintf(stderr, "c-log-replay: %s: corrupt entry at offset %ld\n", path, (long)(p - buf));
+        return -1;
+    }
+    return 0;
+}
+
+typedef union {
+    long long   i;
+    double      f;
+    const char *s;
+} arg_t;
+
+static const char *fill(size_t n) { return g_fill + FILL_MAX - (n < FILL_MAX ? n : FILL_MAX); }
+
+static void make_args(const site_t *s, const unsigned char *sz, arg_t *v) {
+    for (int k = 0; k < s->nargs; k++) {
+        uint16_t size = rd16(sz + 2 * k);
+        int      neg = size & 0x8000, d = size & 0x7fff;
+        switch (s->cls[k]) {
+            case 'i': {
+                long long x = 1;
+                for (int j = 1; j < d && j < 18; j++) x *= 10;
+                v[k].i = neg ? -x : x;
+                break;
+            }
+            case 'f': {
+                double x = 1.5;
+                for (int j = 1; j < d && j < 308; j++) x *= 10;
+                v[k].f = neg ? -x : x;
+                break;
+            }
+            case 'c': v[k].s = fill(1); break;
+            case 'p': v[k].s = g_fill; break;
+            default: v[k].s = fill(size); break;
+        }
+    }
+}
+
+/* what CLOG_LOG_ expands to at the recorded site (probe, inline level gate, cached or plain front-end), with the
+   site's own file, line and prefix slot instead of __FILE__ / __LINE__ / a static */
+#if CLOG_PREFIX_CACHE
+#    define EMIT_CALL_(...) clog_log_site_(&s->ps, lvl, s->file, s->line, s->group, __VA_ARGS__)
+#else
+#    define EMIT_CALL_(...) clog_log_file_line_(lvl, s->file, s->line, s->group, __VA_ARGS__)
+#endif
+#define EMIT(...)                                                                \
+    (CLOG_PROBE_LOG_(lvl, s->file, s->line, s->group, CLOG_FIRST_(__VA_ARGS__)), \
+     CLOG_GATE_(lvl) ? EMIT_CALL_(__VA_ARGS__) : (void)0)
+
+/* one call per combination of argument classes, nested by position (no recursion in the preprocessor) */
+#define L6(...) EMIT(__VA_ARGS__)
+#define L5(...)                                              \
+    if (n == 5) EMIT(__VA_ARGS__);                           \
+    else                                                     \
+        switch (s->cls[5]) {                                 \
+            case 'i': L6(__VA_ARGS__, v[5].i); break;        \
+            case 'f': L6(__VA_ARGS__, v[5].f); break;        \
+            default: L6(__VA_ARGS__, v[5].s); break;         \
+        }
+#define L4(...)                                              \
+    if (n == 4) EMIT(__VA_ARGS__);                           \
+    else                                                     \
+        switch (s->cls[4]) {                                 \
+            case 'i': L5(__VA_ARGS__, v[4].i); break;        \
+            case 'f': L5(__VA_ARGS__, v[4].f); break;        \
+            default: L5(__VA_ARGS__, v[4].s); break;         \
+        }
+#define L3(...)                                              \
+    if (n == 3) EMIT(__VA_ARGS__);                           \
+    else                                                     \
+        switch (s->cls[3]) {                                 \
+            case 'i': L4(__VA_ARGS__, v[3].i); break;        \
+            case 'f': L4(__VA_ARGS__, v[3].f); break;        \
+            default: L4(__VA_ARGS__, v[3].s); break;         \
+        }
+#define L2(...)                                              \
+    if (n == 2) EMIT(__VA_ARGS__);                           \
+    else                                                     \
+        switch (s->cls[2]) {                                 \
+            case 'i': L3(__VA_ARGS__, v[2].i); break;        \
+            case 'f': L3(__VA_ARGS__, v[2].f); break;        \
+            default: L3(__VA_ARGS__, v[2].s); break;         \
+        }
+#define L1(...)                                              \
+    if (n == 1) EMIT(__VA_ARGS__);                           \
+    else                                                     \
+        switch (s->cls[1]) {                                 \
+            case 'i': L2(__VA_ARGS__, v[1].i); break;        \
+            case 'f': L2(__VA_ARGS__, v[1].f); break;        \
+            default: L2(__VA_ARGS__, v[1].s); break;         \
+        }
+#define L0(...)                                              \
+    if (n == 0) EMIT(__VA_ARGS__);                           \
+    else                                                     \
+        switch (s->cls[0]) {                                 \
+            case 'i': L1(__VA_ARGS__, v[0].i); break;        \
+            case 'f': L1(__VA_ARGS__, v[0].f); break;        \
+            default: L1(__VA_ARGS__, v[0].s); break;         \
+        }
+
+static void replay_one(const unsigned char *r) {
+    site_t       *s   = &g_sites[rd16(r + 1)];
+    clog_level    lvl = (clog_level)r[3];
+    arg_t         v[MAX_ARGS];
+    if (s->nargs < 0) {
+        size_t len = 0;
+        for (int j = 0; j < s->nsz; j++) len += rd16(r + 10 + 2 * j);
+        EMIT("%s", fill(len));
+        return;
+    }
+    int n = s->nargs;
+    make_args(s, r + 10, v);
+    L0(s->fmt)
+}
+
+static void *replay_thread(void *arg) {
+    thr_t *t = arg;
+    while (!g_go) sched_yield();
+    uint64_t t0 = now_ns(), due = t0;
+    for (int round = 0; round < g_rounds; round++) {
+        for (size_t i = 0; i < t->n; i++) {
+            const unsigned char *r = t->recs[i];
+            if (g_realtime) {
+                uint32_t dt;
+                memcpy(&dt, r + 6, sizeof dt);
+                due += (uint64_t)((double)dt / g_speed);
+                uint64_t now = now_ns();
+                if (due > now + 100000) {
+                    struct timespec ts = {(time_t)((due - now) / 1000000000ull), (long)((due - now) % 1000000000ull)};
+                    nanosleep(&ts, NULL);
+                }
+                while (now_ns() < due) {}
+            }
+            replay_one(r);
+        }
+    }
+    t->calls = (uint64_t)g_rounds * t->n;
+    t->ns    = now_ns() - t0;
+    return NULL;
+}
+
+static int parse_level(const char *s) {
+    static const char *names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+    for (int i = 0; i < 6; i++)
+        if (strcmp(s, names[i]) == 0) return i;
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    const char *out = "/dev/null";
+    int         lvl = -1, opt;
+    while ((opt = getopt(argc, argv, "rx:n:l:o:h")) != -1) {
+        switch (opt) {
+            case 'r': g_realtime = 1; break;
+            case 'x': g_speed = atof(optarg); break;
+            case 'n': g_rounds = atoi(optarg); break;
+            case 'l':
+                if ((lvl = parse_level(optarg)) < 0) {
+                    fprintf(stderr, "c-log-replay: bad level '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'o': out = optarg; break;
+            default:
+                fputs("usage: c-log-replay [-r] [-x SPEED] [-n ROUNDS] [-l LEVEL] [-o FILE] TRACE\n", stderr);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc - 1 || g_speed <= 0 || g_rounds <= 0) {
+        fputs("usage: c-log-replay [-r] [-x SPEED] [-n ROUNDS] [-l LEVEL] [-o FILE] TRACE\n", stderr);
+        return 2;
+    }
+
+    unsigned char *buf = NULL;
+    if (load(argv[optind], &buf) != 0) return 2;
+    memset(g_fill, 'x', FILL_MAX);
+
+    int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "c-log-replay: %s: %s\n", out, strerror(errno));
+        return 2;
+    }
+    clog_set_fd(fd);
+    if (lvl >= 0) clog_set_level((clog_level)lvl);
+
+    int nthr = 0;
+    for (int i = 0; i < 256; i++) {
+        if (!g_thr[i].n) continue;
+        if (pthread_create(&g_thr[i].th, NULL, replay_thread, &g_thr[i]) != 0) {
+            fprintf(stderr, "c-log-replay: pthread_create failed\n");
+            return 2;
+        }
+        ++nthr;
+    }
+    uint64_t t0 = now_ns();
+    g_go        = 1;
+    uint64_t calls = 0;
+    for (int i = 0; i < 256; i++) {
+        if (!g_thr[i].n) continue;
+        pthread_join(g_thr[i].th, NULL);
+        calls += g_thr[i].calls;
+    }
+    uint64_t wall = now_ns() - t0;
+    clog_set_fd(2);
+    close(fd);
+
+    size_t sites = 0;
+    for (size_t i = 0; i < g_nsites; i++) sites += g_sites[i].fmt != NULL;
+    printf("replayed %llu calls from %zu sites on %d threads in %.3f ms (%s)\n", (unsigned long long)calls, sites,
+           nthr, (double)wall / 1e6, g_realtime ? "recorded pacing" : "back to back");
+    printf("  recorded:   %zu of %zu calls were emitted\n", g_emitted,
+           calls ? (size_t)(calls / (uint64_t)g_rounds) : 0);
+    printf("  wall:       %8.1f ns/call\n", calls ? (double)wall / (double)calls : 0.0);
+    for (int i = 0; i < 256; i++)
+        if (g_thr[i].n)
+            printf("  thread %3d: %8.1f ns/call over %llu calls\n", i,
+                   (double)g_thr[i].ns / (double)g_thr[i].calls, (unsigned long long)g_thr[i].calls);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Call-site density probe for the size report: a hot loop with CALLSITES_N log statements.
+// Compiled twice (CLOG_COLD_SITES=0/1); cmake/clog-size-report.cmake compares the sections.
+#include "c-log.h"
+
+#define CALLSITES_N 32
+
+unsigned callsites_hot_loop(const unsigned *pkts, unsigned n);
+unsigned callsites_hot_loop(const unsigned *pkts, unsigned n) {
+    unsigned acc = 0;
+    for (unsigned i = 0; i < n; i++) {
+        unsigned p = pkts[i];
+        acc += p * 2654435761u;
+        log_trace("pkt %u len %u", i, p);
+        log_trace_group("net", "acc %u", acc);
+        log_debug("pkt %u acc %u", p, acc);
+        log_debug_group("net", "i=%u p=%u acc=%u", i, p, acc);
+        log_info("step %u", i);
+        log_info_group("net", "p %u", p);
+        log_warn("odd p %u", p);
+        log_warn_group("net", "odd acc %u", acc);
+        acc ^= p >> 3;
+        log_trace("pkt %u len %u", i, p);
+        log_trace_group("net", "acc %u", acc);
+        log_debug("pkt %u acc %u", p, acc);
+        log_debug_group("net", "i=%u p=%u acc=%u", i, p, acc);
+        log_info("step %u", i);
+        log_info_group("net", "p %u", p);
+        log_warn("odd p %u", p);
+        log_warn_group("net", "odd acc %u", acc);
+        acc += p << 1;
+        log_trace("pkt %u len %u", i, p);
+        log_trace_group("net", "acc %u", acc);
+        log_debug("pkt %u acc %u", p, acc);
+        log_debug_group("net", "i=%u p=%u acc=%u", i, p, acc);
+        log_info("step %u", i);
+        log_info_group("net", "p %u", p);
+        log_warn("odd p %u", p);
+        log_warn_group("net", "odd acc %u", acc);
+        acc -= p;
+        log_trace("pkt %u len %u", i, p);
+        log_trace_group("net", "acc %u", acc);
+        log_debug("pkt %u acc %u", p, acc);
+        log_debug_group("net", "i=%u p=%u acc=%u", i, p, acc);
+        log_info("step %u", i);
+        log_info_group("net", "p %u", p);
+        log_warn("odd p %u", p);
+        log_warn_group("net", "odd acc %u", acc);
+    }
+    return acc;
+}
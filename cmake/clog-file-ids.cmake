@@ -0,0 +1,44 @@
+# clog_file_ids(<target>)
+# Gives every C/C++ source of <target> a compile-time file id: the source is built with -DCLOG_FILE_ID=<n>, so
+# its log sites reference clog_file_<n>_ (the basename, defined once in a generated table) instead of embedding
+# the __FILE__ path. Ids are unique across the configure run and only apply to targets passed here, so a source
+# shared with another target keeps __FILE__ there. The table (clog-files-<target>.c) and an "id<TAB>path" map
+# for offline tools (clog-files-<target>.map) are written to the current binary dir.
+
+function(clog_file_ids target)
+  get_target_property(_srcs ${target} SOURCES)
+  get_target_property(_dir ${target} SOURCE_DIR)
+  set(_table "/* generated by clog_file_ids(${target}); do not edit */\n#include \"c-log.h\"\n\n")
+  set(_map "")
+  foreach(_src IN LISTS _srcs)
+    if(NOT _src MATCHES "\\.(c|cc|cpp|cxx)$")
+      continue()
+    endif()
+    get_filename_component(_abs "${_src}" ABSOLUTE BASE_DIR "${_dir}")
+    get_property(_id GLOBAL PROPERTY "CLOG_FILE_ID:${_abs}")
+    if("${_id}" STREQUAL "")
+      get_property(_id GLOBAL PROPERTY CLOG_FILE_ID_NEXT)
+      if("${_id}" STREQUAL "")
+        set(_id 0)
+      endif()
+      math(EXPR _next "${_id} + 1")
+      set_property(GLOBAL PROPERTY CLOG_FILE_ID_NEXT ${_next})
+      set_property(GLOBAL PROPERTY "CLOG_FILE_ID:${_abs}" ${_id})
+      set_property(
+        SOURCE "${_abs}"
+        APPEND
+        PROPERTY COMPILE_DEFINITIONS "$<$<BOOL:$<TARGET_PROPERTY:CLOG_FILE_IDS>>:CLOG_FILE_ID=${_id}>")
+    endif()
+    get_filename_component(_name "${_abs}" NAME)
+    string(APPEND _table "CLOG_FILE_DEF(${_id}, \"${_name}\")\n")
+    string(APPEND _map "${_id}\t${_abs}\n")
+  endforeach()
+
+  # written through configure_file so an unchanged table does not trigger a rebuild
+  set(_out "${CMAKE_CURRENT_BINARY_DIR}/clog-files-${target}")
+  file(WRITE "${_out}.c.in" "${_table}")
+  configure_file("${_out}.c.in" "${_out}.c" COPYONLY)
+  file(WRITE "${_out}.map" "${_map}")
+  target_sources(${target} PRIVATE "${_out}.c")
+  set_target_properties(${target} PROPERTIES CLOG_FILE_IDS ON)
+endfunction()
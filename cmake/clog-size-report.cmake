@@ -0,0 +1,60 @@
+# Usage: cmake -DSIZE_TOOL=<size> -DSITES=<n> -DPLAIN=<obj> -DCOLD=<obj> [-DIDS=<obj>] -P clog-size-report.cmake
+# Prints hot .text bytes per log call site with plain calls vs. cold outlined call sites, and the .rodata a
+# translation unit saves when its sites use a file id (CLOG_FILE_ID) instead of __FILE__.
+
+function(clog_section_sizes obj out_hot out_cold)
+  execute_process(
+    COMMAND ${SIZE_TOOL} -A ${obj}
+    OUTPUT_VARIABLE _out
+    RESULT_VARIABLE _rc)
+  if(NOT _rc EQUAL 0)
+    message(FATAL_ERROR "${SIZE_TOOL} failed on ${obj}")
+  endif()
+  set(_hot 0)
+  set(_cold 0)
+  string(REPLACE "\n" ";" _lines "${_out}")
+  foreach(_l IN LISTS _lines)
+    if(_l MATCHES "^\\.text\\.unlikely[^ \t]*[ \t]+([0-9]+)")
+      math(EXPR _cold "${_cold} + ${CMAKE_MATCH_1}")
+    elseif(_l MATCHES "^\\.text[^ \t]*[ \t]+([0-9]+)")
+      math(EXPR _hot "${_hot} + ${CMAKE_MATCH_1}")
+    elseif(_l MATCHES "^__text[ \t]+([0-9]+)")
+      math(EXPR _hot "${_hot} + ${CMAKE_MATCH_1}")
+    endif()
+  endforeach()
+  set(${out_hot} ${_hot} PARENT_SCOPE)
+  set(${out_cold} ${_cold} PARENT_SCOPE)
+endfunction()
+
+function(clog_rodata_size obj out)
+  execute_process(
+    COMMAND ${SIZE_TOOL} -A ${obj}
+    OUTPUT_VARIABLE _out
+    RESULT_VARIABLE _rc)
+  if(NOT _rc EQUAL 0)
+    message(FATAL_ERROR "${SIZE_TOOL} failed on ${obj}")
+  endif()
+  set(_ro 0)
+  string(REPLACE "\n" ";" _lines "${_out}")
+  foreach(_l IN LISTS _lines)
+    if(_l MATCHES "^(\\.rodata[^ \t]*|__cstring|__const)[ \t]+([0-9]+)")
+      math(EXPR _ro "${_ro} + ${CMAKE_MATCH_2}")
+    endif()
+  endforeach()
+  set(${out} ${_ro} PARENT_SCOPE)
+endfunction()
+
+clog_section_sizes(${PLAIN} _plain_hot _plain_cold)
+clog_section_sizes(${COLD} _cold_hot _cold_cold)
+math(EXPR _plain_per "${_plain_hot} / ${SITES}")
+math(EXPR _cold_per "${_cold_hot} / ${SITES}")
+
+message(STATUS "c-log size report (${SITES} call sites)")
+message(STATUS "  plain calls       : .text ${_plain_hot} B (${_plain_per} B/site), .text.unlikely ${_plain_cold} B")
+message(STATUS "  CLOG_COLD_SITES=1 : .text ${_cold_hot} B (${_cold_per} B/site), .text.unlikely ${_cold_cold} B")
+if(IDS)
+  clog_rodata_size(${COLD} _ro_path)
+  clog_rodata_size(${IDS} _ro_ids)
+  math(EXPR _ro_saved "${_ro_path} - ${_ro_ids}")
+  message(STATUS "  .rodata           : ${_ro_path} B with __FILE__, ${_ro_ids} B with CLOG_FILE_ID (${_ro_saved} B saved per TU)")
+endif()
@@ -0,0 +1,29 @@
+// Built with -finstrument-functions and linked with c_log_trace_hooks: every call below lands in the trace rings,
+// and the dump written at exit ($CLOG_TRACE_FILE) is read back with c-log-trace.
+#include <pthread.h>
+
+#include "c-log.h"
+
+static unsigned fib(unsigned n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+
+static unsigned checksum(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+static void *worker(void *arg) {
+    unsigned *out = arg;
+    for (int i = 0; i < 3; i++) *out ^= checksum("the quick brown fox");
+    return NULL;
+}
+
+int main(void) {
+    pthread_t t;
+    unsigned  h = 0;
+    if (pthread_create(&t, NULL, worker, &h) != 0) return 1;
+    unsigned f = fib(10);
+    pthread_join(t, NULL);
+    log_info("fib(10) = %u, checksum %08x", f, h);
+    return 0;
+}
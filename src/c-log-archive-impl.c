@@ -0,0 +1,2 @@
+#define CLOG_ARCHIVE_IMPLEMENTATION
+#include "c-log-archive.h"
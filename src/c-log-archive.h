@@ -0,0 +1,846 @@
+// c-log-archive.h — columnar archive of c-log text output, for analytics over long retention.
+// Single-header like c-log.h: include everywhere; in ONE .c file #define CLOG_ARCHIVE_IMPLEMENTATION before
+// including. The CMake build compiles it in src/c-log-archive-impl.c (target c_log_archive, POSIX).
+//
+// File layout (integers little endian; varint = LEB128, zz = zigzag varint):
+//
+//   "CLOGCOL1"
+//   row group...     dictionaries, then one chunk per column
+//   footer           u32 groups, then per group: u64 offset, u32 size, u32 msg_off, u32 rows,
+//                    i64 min_ts, i64 max_ts, u8 min_level, u8 max_level
+//   u64 footer offset, "CLOGCOL1"
+//
+// A row group starts with three dictionaries (file, group, tid: varint count, then varint length + bytes each)
+// followed by the column chunks ts, level, tid, file, line, group, msg_len and msg. Every chunk is u8 codec
+// (0 raw, 1 deflate), varint raw size, varint stored size, then the bytes:
+//   ts                the first value as zz, then zz deltas (milliseconds)
+//   level tid file group
+//                     runs of (varint length, varint value); level is the clog_level, the rest dictionary indices
+//   line msg_len      one varint per row
+//   msg               the message bytes back to back; deflated when built with zlib (CLOG_ARCHIVE_ZLIB)
+// A query decides from the footer (time range, levels) and then from the dictionaries whether a group can hold a
+// match before decoding its columns, and reads the message chunk (the bulk of the file, at msg_off) only when a
+// row of that group matched.
+
+#ifndef CLOG_ARCHIVE_H
+#define CLOG_ARCHIVE_H
+
+#include "c-log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(CLOG_ARCHIVE_ZLIB)
+#    define CLOG_ARCHIVE_ZLIB 0  // 1 => deflate the message chunks (link zlib)
+#endif
+#if !defined(CLOG_ARCHIVE_ROWS)
+#    define CLOG_ARCHIVE_ROWS 65536  // default rows per row group
+#endif
+
+typedef struct clog_archive clog_archive;
+
+/* One record. Strings are NUL-terminated except msg; they stay valid for the duration of the callback. */
+typedef struct {
+    int64_t     ts_ms;  // time as written (civil, no zone): ms since 1970-01-01 00:00:00.000
+    clog_level  level;
+    const char *tid;  // "tid:4242" or "t#00abcd" as printed, "" when absent
+    const char *file;  // basename from <file:line>
+    unsigned    line;
+    const char *group;  // "" when the record has no group
+    const char *msg;  // continuation lines are joined with '\n'
+    size_t      msg_len;
+} clog_archive_row;
+
+typedef struct {
+    int64_t     since_ms, until_ms;  // inclusive bounds
+    clog_level  min_level;
+    const char *group;  // glob, or NULL for any
+    const char *file;  // glob, or NULL for any
+    const char *tid;  // thread id as printed ("4242", or the hex of CLOG_TID_SHORT), or NULL for any
+} clog_archive_query;
+
+typedef struct {
+    uint64_t groups, groups_read, blobs_read;  // row groups in the file / with columns decoded / messages read
+    uint64_t rows, matches;
+} clog_archive_stats;
+
+/* rows_per_group 0 => CLOG_ARCHIVE_ROWS. NULL on error (errno set). */
+clog_archive *clog_archive_create(const char *path, unsigned rows_per_group, bool compress);
+/* One line of c-log output without its newline. Lines that do not start with a record prefix continue the previous
+   record's message (leading ones are dropped). Returns 1 for a new record, 0 otherwise, -1 on error. */
+int clog_archive_add_line(clog_archive *a, const char *line, size_t len);
+/* Writes the last row group and the footer. Returns 0 on success; a is freed either way. */
+int clog_archive_close(clog_archive *a, clog_archive_stats *st);
+
+void clog_archive_query_init(clog_archive_query *q);
+/* Calls fn for each matching row in file order; a nonzero return from fn stops the scan and is returned. With fn
+   NULL only st->matches is computed and no message chunk is read. Returns 0 when done, -1 on I/O errors or a
+   malformed file. */
+int clog_archive_scan(const char *path, const clog_archive_query *q,
+                      int (*fn)(void *ud, const clog_archive_row *row), void *ud, clog_archive_stats *st);
+
+/* "YYYY-MM-DD[ HH[:MM[:SS[.mmm]]]]" -> ms; until=true gives the last ms at that precision. -1 if malformed. */
+int64_t clog_archive_parse_time(const char *s, bool until);
+/* ms -> "YYYY-MM-DD HH:MM:SS.mmm" */
+void clog_archive_format_time(int64_t ms, char out[24]);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ===================================================== */
+/* ================== IMPLEMENTATION =================== */
+/* ===================================================== */
+#ifdef CLOG_ARCHIVE_IMPLEMENTATION
+
+#    include <errno.h>
+#    include <stdlib.h>
+#    include <string.h>
+#    if CLOG_ARCHIVE_ZLIB
+#        include <zlib.h>
+#    endif
+
+#    define CLOG_AR_MAGIC_ "CLOGCOL1"
+#    define CLOG_AR_NCOLS_ 8
+#    define CLOG_AR_TS_LEN_ 23 /* "YYYY-MM-DD HH:MM:SS.mmm" */
+#    define CLOG_AR_FOOT_ENT_ 38
+
+enum { CLOG_AR_TS_, CLOG_AR_LVL_, CLOG_AR_TID_, CLOG_AR_FILE_, CLOG_AR_LINE_, CLOG_AR_GRP_, CLOG_AR_MLEN_, CLOG_AR_MSG_ };
+
+// ---------- byte buffers and varints ----------
+
+typedef struct {
+    unsigned char *p;
+    size_t         len, cap;
+} clog_ar_buf_;
+
+static bool clog_ar_reserve_(clog_ar_buf_ *b, size_t n) {
+    if (b->len + n <= b->cap) return true;
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->len + n) cap *= 2;
+    unsigned char *np = (unsigned char *)realloc(b->p, cap);
+    if (!np) return false;
+    b->p   = np;
+    b->cap = cap;
+    return true;
+}
+
+static bool clog_ar_put_(clog_ar_buf_ *b, const void *p, size_t n) {
+    if (!clog_ar_reserve_(b, n)) return false;
+    if (n) memcpy(b->p + b->len, p, n);
+    b->len += n;
+    return true;
+}
+
+static bool clog_ar_put_var_(clog_ar_buf_ *b, uint64_t v) {
+    if (!clog_ar_reserve_(b, 10)) return false;
+    while (v >= 0x80) {
+        b->p[b->len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    b->p[b->len++] = (unsigned char)v;
+    return true;
+}
+
+static bool clog_ar_put_le_(clog_ar_buf_ *b, uint64_t v, unsigned n) {
+    unsigned char tmp[8];
+    for (unsigned i = 0; i < n; i++) tmp[i] = (unsigned char)(v >> (8 * i));
+    return clog_ar_put_(b, tmp, n);
+}
+
+static uint64_t clog_ar_zz_(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t  clog_ar_unzz_(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+typedef struct {
+    const unsigned char *p, *end;
+    bool                 bad;
+} clog_ar_cur_;
+
+static uint64_t clog_ar_get_var_(clog_ar_cur_ *c) {
+    uint64_t v = 0;
+    for (unsigned s = 0; s < 64; s += 7) {
+        if (c->p >= c->end) break;
+        unsigned char b = *c->p++;
+        v |= (uint64_t)(b & 0x7F) << s;
+        if (!(b & 0x80)) return v;
+    }
+    c->bad = true;
+    return 0;
+}
+
+static uint64_t clog_ar_get_le_(const unsigned char *p, unsigned n) {
+    uint64_t v = 0;
+    for (unsigned i = 0; i < n; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// ---------- civil time ----------
+
+static int64_t clog_ar_days_(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t  era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+int64_t clog_archive_parse_time(const char *s, bool until) {
+    int f[7] = {0, 1, 1, 0, 0, 0, 0}, n = 0;
+    static const char seps[] = "-- ::.";
+    const char       *p      = s;
+    while (n < 7) {
+        if (*p < '0' || *p > '9') return -1;
+        int v = 0;
+        while (*p >= '0' && *p <= '9' && v < 100000) v = v * 10 + (*p++ - '0');
+        f[n++] = v;
+        if (!*p || n == 7 || *p != seps[n - 1]) break;
+        ++p;
+    }
+    if (*p || n < 3 || f[1] < 1 || f[1] > 12 || f[2] < 1 || f[2] > 31) return -1;
+    static const int64_t unit[8] = {0, 0, 0, 86400000, 3600000, 60000, 1000, 1};
+    int64_t ms = clog_ar_days_(f[0], (unsigned)f[1], (unsigned)f[2]) * 86400000 +
+                 (int64_t)f[3] * 3600000 + (int64_t)f[4] * 60000 + (int64_t)f[5] * 1000 + f[6];
+    return until ? ms + unit[n] - 1 : ms;
+}
+
+void clog_archive_format_time(int64_t ms, char out[24]) {
+    int64_t  z   = (ms >= 0 ? ms : ms - 86399999) / 86400000;
+    int64_t  rem = ms - z * 86400000;
+    int64_t  era;
+    unsigned doe, yoe, doy, mp, d, m;
+    z += 719468;
+    era = (z >= 0 ? z : z - 146096) / 146097;
+    doe = (unsigned)(z - era * 146097);
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp  = (5 * doy + 2) / 153;
+    d   = doy - (153 * mp + 2) / 5 + 1;
+    m   = mp < 10 ? mp + 3 : mp - 9;
+    char tmp[64];
+    snprintf(tmp, sizeof tmp, "%04d-%02u-%02u %02d:%02d:%02d.%03d", (int)((int64_t)yoe + era * 400 + (m <= 2)), m, d,
+             (int)(rem / 3600000), (int)(rem / 60000 % 60), (int)(rem / 1000 % 60), (int)(rem % 1000));
+    memcpy(out, tmp, 23);
+    out[23] = '\0';
+}
+
+// ---------- record prefix ----------
+
+typedef struct {
+    int64_t     ts;
+    int         lvl;
+    const char *tid, *file, *group, *msg;
+    size_t      tid_len, file_len, group_len, msg_len;
+    unsigned    line;
+} clog_ar_rec_;
+
+static const char *const k_clog_ar_levels_[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+static const char *clog_ar_skip_ansi_(const char *p, const char *e) {
+    while (p < e && *p == '\x1b') {
+        while (p < e && *p != 'm') ++p;
+        if (p < e) ++p;
+    }
+    return p;
+}
+
+static int clog_ar_num_(const char *p, int n) {
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9') return -1;
+        v = v * 10 + (p[i] - '0');
+    }
+    return v;
+}
+
+/* Same prefix grammar as c-log-grep: YYYY-MM-DD HH:MM:SS.mmm [LEVEL]\t[build:x] (tid:N) #seq <file:line> [group] */
+static bool clog_ar_parse_(const char *p, const char *e, clog_ar_rec_ *r) {
+    if (e - p < CLOG_AR_TS_LEN_ + 4 || p[4] != '-' || p[7] != '-' || p[10] != ' ' || p[13] != ':' || p[16] != ':' ||
+        p[19] != '.')
+        return false;
+    int y = clog_ar_num_(p, 4), mo = clog_ar_num_(p + 5, 2), d = clog_ar_num_(p + 8, 2), h = clog_ar_num_(p + 11, 2),
+        mi = clog_ar_num_(p + 14, 2), s = clog_ar_num_(p + 17, 2), ms = clog_ar_num_(p + 20, 3);
+    if (y < 0 || mo < 1 || mo > 12 || d < 1 || d > 31 || h < 0 || mi < 0 || s < 0 || ms < 0) return false;
+    r->ts = clog_ar_days_(y, (unsigned)mo, (unsigned)d) * 86400000 + (int64_t)h * 3600000 + (int64_t)mi * 60000 +
+            (int64_t)s * 1000 + ms;
+    p += CLOG_AR_TS_LEN_;
+    if (*p++ != ' ' || *p++ != '[') return false;
+    p      = clog_ar_skip_ansi_(p, e);
+    r->lvl = -1;
+    for (int i = 0; i < 6; i++) {
+        size_t n = strlen(k_clog_ar_levels_[i]);
+        if ((size_t)(e - p) > n && memcmp(p, k_clog_ar_levels_[i], n) == 0 && (p[n] == ']' || p[n] == '\x1b')) {
+            r->lvl = i;
+            p += n;
+            break;
+        }
+    }
+    if (r->lvl < 0) return false;
+    p = clog_ar_skip_ansi_(p, e);
+    if (p >= e || *p++ != ']') return false;
+    if (p < e && *p == '\t') ++p;
+    if (e - p > 7 && memcmp(p, "[build:", 7) == 0) {
+        const char *c = (const char *)memchr(p, ']', (size_t)(e - p));
+        if (!c) return false;
+        p = c + (c + 1 < e && c[1] == ' ' ? 2 : 1);
+    }
+    r->tid     = p;
+    r->tid_len = 0;
+    if (p < e && *p == '(') {
+        const char *c = (const char *)memchr(p, ')', (size_t)(e - p));
+        if (!c) return false;
+        r->tid     = p + 1;
+        r->tid_len = (size_t)(c - p - 1);
+        p          = c + (c + 1 < e && c[1] == ' ' ? 2 : 1);
+    }
+    if (p < e && *p == '#') { /* CLOG_WITH_SEQ: not archived */
+        const char *c = (const char *)memchr(p, ' ', (size_t)(e - p));
+        if (!c) return false;
+        p = c + 1;
+    }
+    if (p >= e || *p != '<') return false;
+    const char *c = (const char *)memchr(p, '>', (size_t)(e - p));
+    if (!c) return false;
+    const char *colon = c;
+    while (colon > p && *colon != ':') --colon;
+    r->file     = p + 1;
+    r->file_len = (size_t)((colon > p ? colon : c) - r->file);
+    r->line     = colon > p ? (unsigned)strtoul(colon + 1, NULL, 10) : 0;
+    p           = c + (c + 1 < e && c[1] == ' ' ? 2 : 1);
+    r->group     = p;
+    r->group_len = 0;
+    if (p < e && *p == '[') {
+        c = (const char *)memchr(p, ']', (size_t)(e - p));
+        if (c && c + 1 < e && c[1] == ' ') {
+            r->group     = p + 1;
+            r->group_len = (size_t)(c - p - 1);
+            p            = c + 2;
+        }
+    }
+    r->msg     = p;
+    r->msg_len = (size_t)(e - p);
+    return true;
+}
+
+// ---------- writer ----------
+
+/* per-group string dictionary: bytes in pool, open-addressed index of (hash, id) */
+typedef struct {
+    clog_ar_buf_ pool;  // varint length + bytes per entry, as written to the file
+    uint32_t    *slots;  // id + 1, 0 = empty
+    uint32_t    *offs;  // entry -> offset of its bytes in pool
+    uint32_t     n, cap;
+} clog_ar_dict_;
+
+typedef struct {
+    uint64_t val, len;
+} clog_ar_run_;
+
+struct clog_archive {
+    FILE         *f;
+    unsigned      rows_max;
+    bool          compress, err, pending;
+    uint64_t      off;
+    clog_ar_buf_  col[CLOG_AR_NCOLS_];
+    clog_ar_run_  run[CLOG_AR_NCOLS_];
+    clog_ar_dict_ dict[3];  // file, group, tid
+    clog_ar_buf_  foot, out;
+    uint32_t      rows, groups;
+    int64_t       prev_ts, min_ts, max_ts;
+    int           min_lvl, max_lvl;
+    size_t        pending_len;
+    uint64_t      total_rows;
+};
+
+static uint32_t clog_ar_hash_(const char *s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+static int64_t clog_ar_dict_id_(clog_ar_dict_ *d, const char *s, size_t n) {
+    if (d->n * 2 >= d->cap) {
+        uint32_t  cap   = d->cap ? d->cap * 2 : 64;
+        uint32_t *slots = (uint32_t *)calloc(cap, sizeof *slots);
+        uint32_t *offs  = (uint32_t *)realloc(d->offs, cap / 2 * sizeof *offs);
+        if (!slots || !offs) {
+            free(slots);
+            if (offs) d->offs = offs;
+            return -1;
+        }
+        d->offs = offs;
+        for (uint32_t i = 0; i < d->cap; i++) {
+            if (!d->slots[i]) continue;
+            clog_ar_cur_ c   = {d->pool.p + d->offs[d->slots[i] - 1], d->pool.p + d->pool.len, false};
+            size_t       len = (size_t)clog_ar_get_var_(&c);
+            uint32_t     j   = clog_ar_hash_((const char *)c.p, len) & (cap - 1);
+            while (slots[j]) j = (j + 1) & (cap - 1);
+            slots[j] = d->slots[i];
+        }
+        free(d->slots);
+        d->slots = slots;
+        d->cap   = cap;
+    }
+    uint32_t j = clog_ar_hash_(s, n) & (d->cap - 1);
+    for (; d->slots[j]; j = (j + 1) & (d->cap - 1)) {
+        clog_ar_cur_ c   = {d->pool.p + d->offs[d->slots[j] - 1], d->pool.p + d->pool.len, false};
+        size_t       len = (size_t)clog_ar_get_var_(&c);
+        if (len == n && memcmp(c.p, s, n) == 0) return d->slots[j] - 1;
+    }
+    d->offs[d->n] = (uint32_t)d->pool.len;
+    if (!clog_ar_put_var_(&d->pool, n) || !clog_ar_put_(&d->pool, s, n)) return -1;
+    d->slots[j] = ++d->n;
+    return d->n - 1;
+}
+
+static void clog_ar_dict_reset_(clog_ar_dict_ *d) {
+    if (d->slots) memset(d->slots, 0, d->cap * sizeof *d->slots);
+    d->pool.len = 0;
+    d->n        = 0;
+}
+
+static bool clog_ar_run_flush_(clog_archive *a, int col) {
+    clog_ar_run_ *r = &a->run[col];
+    if (!r->len) return true;
+    bool ok = clog_ar_put_var_(&a->col[col], r->len) && clog_ar_put_var_(&a->col[col], r->val);
+    r->len  = 0;
+    return ok;
+}
+
+static bool clog_ar_run_add_(clog_archive *a, int col, uint64_t v) {
+    clog_ar_run_ *r = &a->run[col];
+    if (r->len && r->val == v) {
+        r->len++;
+        return true;
+    }
+    if (!clog_ar_run_flush_(a, col)) return false;
+    r->val = v;
+    r->len = 1;
+    return true;
+}
+
+static bool clog_ar_write_(clog_archive *a, const void *p, size_t n) {
+    if (n && fwrite(p, 1, n, a->f) != n) return false;
+    a->off += n;
+    return true;
+}
+
+/* codec, raw size, stored size, bytes */
+static bool clog_ar_chunk_(clog_archive *a, clog_ar_buf_ *dst, const clog_ar_buf_ *src, bool deflate) {
+#    if CLOG_ARCHIVE_ZLIB
+    if (deflate && src->len) {
+        uLongf zn = compressBound((uLong)src->len);
+        a->out.len = 0;
+        if (!clog_ar_reserve_(&a->out, zn)) return false;
+        if (compress2(a->out.p, &zn, src->p, (uLong)src->len, Z_DEFAULT_COMPRESSION) == Z_OK && zn < src->len) {
+            return clog_ar_put_var_(dst, 1) && clog_ar_put_var_(dst, src->len) && clog_ar_put_var_(dst, zn) &&
+                   clog_ar_put_(dst, a->out.p, zn);
+        }
+    }
+#    else
+    (void)a;
+    (void)deflate;
+#    endif
+    return clog_ar_put_var_(dst, 0) && clog_ar_put_var_(dst, src->len) && clog_ar_put_var_(dst, src->len) &&
+           clog_ar_put_(dst, src->p, src->len);
+}
+
+static bool clog_ar_flush_group_(clog_archive *a) {
+    if (!a->rows) return true;
+    if (a->pending && !clog_ar_put_var_(&a->col[CLOG_AR_MLEN_], a->pending_len)) return false;
+    a->pending = false;
+    for (int c = CLOG_AR_LVL_; c <= CLOG_AR_GRP_; c++)
+        if (c != CLOG_AR_LINE_ && !clog_ar_run_flush_(a, c)) return false;
+
+    /* dictionaries and every column but msg go into one buffer, msg after it at msg_off */
+    clog_ar_buf_ g = {NULL, 0, 0};
+    bool         ok = true;
+    for (int i = 0; i < 3 && ok; i++)
+        ok = clog_ar_put_var_(&g, a->dict[i].n) && clog_ar_put_(&g, a->dict[i].pool.p, a->dict[i].pool.len);
+    for (int c = 0; c < CLOG_AR_MSG_ && ok; c++) ok = clog_ar_chunk_(a, &g, &a->col[c], false);
+    size_t msg_off = g.len;
+    ok             = ok && clog_ar_chunk_(a, &g, &a->col[CLOG_AR_MSG_], a->compress);
+    uint64_t at    = a->off;
+    ok             = ok && g.len <= UINT32_MAX && clog_ar_write_(a, g.p, g.len);
+    ok = ok && clog_ar_put_le_(&a->foot, at, 8) && clog_ar_put_le_(&a->foot, g.len, 4) &&
+         clog_ar_put_le_(&a->foot, msg_off, 4) && clog_ar_put_le_(&a->foot, a->rows, 4) &&
+         clog_ar_put_le_(&a->foot, (uint64_t)a->min_ts, 8) && clog_ar_put_le_(&a->foot, (uint64_t)a->max_ts, 8) &&
+         clog_ar_put_le_(&a->foot, (uint64_t)a->min_lvl, 1) && clog_ar_put_le_(&a->foot, (uint64_t)a->max_lvl, 1);
+    free(g.p);
+
+    a->groups++;
+    a->rows = 0;
+    for (int c = 0; c < CLOG_AR_NCOLS_; c++) a->col[c].len = 0;
+    for (int i = 0; i < 3; i++) clog_ar_dict_reset_(&a->dict[i]);
+    return ok;
+}
+
+clog_archive *clog_archive_create(const char *path, unsigned rows_per_group, bool compress) {
+    clog_archive *a = (clog_archive *)calloc(1, sizeof *a);
+    if (!a) return NULL;
+    a->f = fopen(path, "wb");
+    if (!a->f) {
+        free(a);
+        return NULL;
+    }
+    a->rows_max = rows_per_group ? rows_per_group : CLOG_ARCHIVE_ROWS;
+    a->compress = compress;
+    if (!clog_ar_write_(a, CLOG_AR_MAGIC_, 8)) a->err = true;
+    return a;
+}
+
+int clog_archive_add_line(clog_archive *a, const char *line, size_t len) {
+    if (a->err) return -1;
+    clog_ar_rec_ r;
+    if (!clog_ar_parse_(line, line + len, &r)) {
+        if (!a->pending) return 0;
+        /* continuation of the previous record */
+        if (!clog_ar_put_(&a->col[CLOG_AR_MSG_], "\n", 1) || !clog_ar_put_(&a->col[CLOG_AR_MSG_], line, len)) {
+            a->err = true;
+            return -1;
+        }
+        a->pending_len += len + 1;
+        return 0;
+    }
+    if (a->rows == a->rows_max && !clog_ar_flush_group_(a)) {
+        a->err = true;
+        return -1;
+    }
+    if (a->pending && !clog_ar_put_var_(&a->col[CLOG_AR_MLEN_], a->pending_len)) a->err = true;
+    if (!a->rows) {
+        a->prev_ts = 0;
+        a->min_ts = a->max_ts = r.ts;
+        a->min_lvl = a->max_lvl = r.lvl;
+    }
+    if (r.ts < a->min_ts) a->min_ts = r.ts;
+    if (r.ts > a->max_ts) a->max_ts = r.ts;
+    if (r.lvl < a->min_lvl) a->min_lvl = r.lvl;
+    if (r.lvl > a->max_lvl) a->max_lvl = r.lvl;
+
+    int64_t file = clog_ar_dict_id_(&a->dict[0], r.file, r.file_len);
+    int64_t grp  = clog_ar_dict_id_(&a->dict[1], r.group, r.group_len);
+    int64_t tid  = clog_ar_dict_id_(&a->dict[2], r.tid, r.tid_len);
+    if (file < 0 || grp < 0 || tid < 0 || !clog_ar_put_var_(&a->col[CLOG_AR_TS_], clog_ar_zz_(r.ts - a->prev_ts)) ||
+        !clog_ar_run_add_(a, CLOG_AR_LVL_, (uint64_t)r.lvl) || !clog_ar_run_add_(a, CLOG_AR_TID_, (uint64_t)tid) ||
+        !clog_ar_run_add_(a, CLOG_AR_FILE_, (uint64_t)file) || !clog_ar_put_var_(&a->col[CLOG_AR_LINE_], r.line) ||
+        !clog_ar_run_add_(a, CLOG_AR_GRP_, (uint64_t)grp) || !clog_ar_put_(&a->col[CLOG_AR_MSG_], r.msg, r.msg_len))
+        a->err = true;
+    if (a->err) return -1;
+    a->prev_ts     = r.ts;
+    a->pending     = true;
+    a->pending_len = r.msg_len;
+    a->rows++;
+    a->total_rows++;
+    return 1;
+}
+
+int clog_archive_close(clog_archive *a, clog_archive_stats *st) {
+    bool ok = !a->err && clog_ar_flush_group_(a);
+    if (ok) {
+        clog_ar_buf_ tail = {NULL, 0, 0};
+        uint64_t     at   = a->off;
+        ok = clog_ar_put_le_(&tail, a->groups, 4) && clog_ar_put_(&tail, a->foot.p, a->foot.len) &&
+             clog_ar_put_le_(&tail, at, 8) && clog_ar_put_(&tail, CLOG_AR_MAGIC_, 8) &&
+             clog_ar_write_(a, tail.p, tail.len);
+        free(tail.p);
+    }
+    if (fclose(a->f) != 0) ok = false;
+    if (st) {
+        memset(st, 0, sizeof *st);
+        st->groups = a->groups;
+        st->rows   = a->total_rows;
+    }
+    for (int c = 0; c < CLOG_AR_NCOLS_; c++) free(a->col[c].p);
+    for (int i = 0; i < 3; i++) {
+        free(a->dict[i].pool.p);
+        free(a->dict[i].slots);
+        free(a->dict[i].offs);
+    }
+    free(a->foot.p);
+    free(a->out.p);
+    free(a);
+    return ok ? 0 : -1;
+}
+
+// ---------- reader ----------
+
+void clog_archive_query_init(clog_archive_query *q) {
+    memset(q, 0, sizeof *q);
+    q->since_ms  = INT64_MIN;
+    q->until_ms  = INT64_MAX;
+    q->min_level = CLOG_TRACE;
+}
+
+static bool clog_ar_glob_(const char *pat, const char *s) {
+    const char *star = NULL, *ss = s;
+    while (*s) {
+        if (*pat == '?' || (*pat && *pat == *s)) {
+            ++pat;
+            ++s;
+        } else if (*pat == '*') {
+            star = pat++;
+            ss   = s;
+        } else if (star) {
+            pat = star + 1;
+            s   = ++ss;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') ++pat;
+    return *pat == '\0';
+}
+
+static bool clog_ar_tid_match_(const char *want, const char *tid) {
+    if (strncmp(tid, "tid:", 4) == 0) tid += 4;
+    else if (strncmp(tid, "t#", 2) == 0) tid += 2;
+    return strcmp(want, tid) == 0;
+}
+
+/* reads a dictionary into NUL-terminated strings (in place: the length varint is overwritten) and marks the
+   entries the filter accepts; returns the number accepted */
+static uint32_t clog_ar_read_dict_(clog_ar_cur_ *c, char ***out, bool **ok, uint32_t *n, const char *glob,
+                                   bool tid) {
+    uint64_t cnt = clog_ar_get_var_(c);
+    if (c->bad || cnt > (uint64_t)(c->end - c->p)) {
+        c->bad = true;
+        return 0;
+    }
+    *n          = (uint32_t)cnt;
+    *out        = (char **)malloc((cnt ? cnt : 1) * sizeof **out);
+    *ok         = (bool *)malloc(cnt ? cnt : 1);
+    uint32_t hit = 0;
+    if (!*out || !*ok) {
+        c->bad = true;
+        return 0;
+    }
+    for (uint32_t i = 0; i < cnt; i++) {
+        unsigned char *at  = (unsigned char *)(uintptr_t)c->p;
+        uint64_t       len = clog_ar_get_var_(c);
+        if (c->bad || len > (uint64_t)(c->end - c->p)) {
+            c->bad = true;
+            return 0;
+        }
+        memmove(at, c->p, (size_t)len);
+        at[len]   = '\0';
+        (*out)[i] = (char *)at;
+        c->p += len;
+        (*ok)[i] = !glob || (tid ? clog_ar_tid_match_(glob, (*out)[i]) : clog_ar_glob_(glob, (*out)[i]));
+        hit += (*ok)[i];
+    }
+    return hit;
+}
+
+/* chunk header at c; returns the raw bytes (pointing into the file buffer or into scratch) */
+static const unsigned char *clog_ar_read_chunk_(clog_ar_cur_ *c, clog_ar_buf_ *scratch, size_t *raw_len) {
+    uint64_t codec = clog_ar_get_var_(c), raw = clog_ar_get_var_(c), stored = clog_ar_get_var_(c);
+    if (c->bad || stored > (uint64_t)(c->end - c->p) || (codec == 0 && raw != stored)) {
+        c->bad = true;
+        return NULL;
+    }
+    const unsigned char *p = c->p;
+    c->p += stored;
+    *raw_len = (size_t)raw;
+    if (codec == 0) return p;
+#    if CLOG_ARCHIVE_ZLIB
+    uLongf n     = (uLongf)raw;
+    scratch->len = 0;
+    if (codec == 1 && clog_ar_reserve_(scratch, raw ? (size_t)raw : 1) &&
+        uncompress(scratch->p, &n, p, (uLong)stored) == Z_OK && n == raw)
+        return scratch->p;
+#    else
+    (void)scratch;
+#    endif
+    c->bad = true;
+    return NULL;
+}
+
+/* expands a run-length column into one value per row */
+static bool clog_ar_runs_(const unsigned char *p, size_t n, uint32_t *dst, uint32_t rows, uint64_t limit) {
+    clog_ar_cur_ c = {p, p + n, false};
+    uint32_t     i = 0;
+    while (i < rows) {
+        uint64_t len = clog_ar_get_var_(&c), v = clog_ar_get_var_(&c);
+        if (c.bad || !len || len > rows - i || v >= limit) return false;
+        for (uint64_t k = 0; k < len; k++) dst[i++] = (uint32_t)v;
+    }
+    return c.p == c.end;
+}
+
+typedef struct {
+    clog_ar_buf_ head, blob, scratch;
+    char       **dict[3];
+    bool        *ok[3];
+    uint32_t     n[3];
+    int64_t     *ts;
+    uint32_t    *lvl, *tid, *file, *grp, *line;
+    uint64_t    *mlen;
+    bool        *match;
+} clog_ar_scan_;
+
+static bool clog_ar_pread_(FILE *f, clog_ar_buf_ *b, uint64_t off, size_t n) {
+    b->len = 0;
+    if (!clog_ar_reserve_(b, n + 1) || fseeko(f, (off_t)off, SEEK_SET) != 0 || fread(b->p, 1, n, f) != n)
+        return false;
+    b->len = n;
+    return true;
+}
+
+/* 0 = done with this group, 1 = callback stopped, -1 = error */
+static int clog_ar_scan_group_(FILE *f, const unsigned char *ent, const clog_archive_query *q, clog_ar_scan_ *s,
+                               int (*fn)(void *, const clog_archive_row *), void *ud, clog_archive_stats *st,
+                               int *stop) {
+    uint64_t off = clog_ar_get_le_(ent, 8);
+    size_t   size = (size_t)clog_ar_get_le_(ent + 8, 4), msg_off = (size_t)clog_ar_get_le_(ent + 12, 4);
+    uint32_t rows = (uint32_t)clog_ar_get_le_(ent + 16, 4);
+    int64_t  min_ts = (int64_t)clog_ar_get_le_(ent + 20, 8), max_ts = (int64_t)clog_ar_get_le_(ent + 28, 8);
+    int      max_lvl = ent[37];
+    st->rows += rows;
+    if (max_ts < q->since_ms || min_ts > q->until_ms || max_lvl < (int)q->min_level || !rows) return 0;
+    if (msg_off > size || !clog_ar_pread_(f, &s->head, off, msg_off)) return -1;
+
+    clog_ar_cur_ c        = {s->head.p, s->head.p + s->head.len, false};
+    const char  *globs[3] = {q->file, q->group, q->tid};
+    bool         any      = true;
+    for (int i = 0; i < 3; i++) {
+        free(s->dict[i]);
+        free(s->ok[i]);
+        s->dict[i] = NULL;
+        s->ok[i]   = NULL;
+        if (!clog_ar_read_dict_(&c, &s->dict[i], &s->ok[i], &s->n[i], globs[i], i == 2)) any = false;
+        if (c.bad) return -1;
+    }
+    if (!any) return 0; /* a filtered column has no acceptable value in this group */
+    st->groups_read++;
+
+    /* s->ts etc. hold CLOG_AR_MSG_ arrays of rows entries, sized by the caller for the largest group */
+    const unsigned char *col[CLOG_AR_MSG_];
+    size_t               len[CLOG_AR_MSG_];
+    for (int i = 0; i < CLOG_AR_MSG_; i++) {
+        col[i] = clog_ar_read_chunk_(&c, &s->scratch, &len[i]);
+        if (c.bad) return -1;
+    }
+    clog_ar_cur_ tc = {col[CLOG_AR_TS_], col[CLOG_AR_TS_] + len[CLOG_AR_TS_], false};
+    clog_ar_cur_ lc = {col[CLOG_AR_LINE_], col[CLOG_AR_LINE_] + len[CLOG_AR_LINE_], false};
+    clog_ar_cur_ mc = {col[CLOG_AR_MLEN_], col[CLOG_AR_MLEN_] + len[CLOG_AR_MLEN_], false};
+    int64_t      ts = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        ts += clog_ar_unzz_(clog_ar_get_var_(&tc));
+        s->ts[i]   = ts;
+        s->line[i] = (uint32_t)clog_ar_get_var_(&lc);
+        s->mlen[i] = clog_ar_get_var_(&mc);
+    }
+    if (tc.bad || lc.bad || mc.bad || !clog_ar_runs_(col[CLOG_AR_LVL_], len[CLOG_AR_LVL_], s->lvl, rows, 6) ||
+        !clog_ar_runs_(col[CLOG_AR_TID_], len[CLOG_AR_TID_], s->tid, rows, s->n[2]) ||
+        !clog_ar_runs_(col[CLOG_AR_FILE_], len[CLOG_AR_FILE_], s->file, rows, s->n[0]) ||
+        !clog_ar_runs_(col[CLOG_AR_GRP_], len[CLOG_AR_GRP_], s->grp, rows, s->n[1]))
+        return -1;
+
+    uint32_t hits = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        s->match[i] = s->ts[i] >= q->since_ms && s->ts[i] <= q->until_ms && s->lvl[i] >= (uint32_t)q->min_level &&
+                      s->ok[0][s->file[i]] && s->ok[1][s->grp[i]] && s->ok[2][s->tid[i]];
+        hits += s->match[i];
+    }
+    if (!hits) return 0;
+    if (!fn) {
+        st->matches += hits;
+        return 0;
+    }
+
+    /* only now touch the message chunk */
+    st->blobs_read++;
+    if (!clog_ar_pread_(f, &s->blob, off + msg_off, size - msg_off)) return -1;
+    clog_ar_cur_         bc = {s->blob.p, s->blob.p + s->blob.len, false};
+    size_t               msg_len;
+    const unsigned char *msg = clog_ar_read_chunk_(&bc, &s->scratch, &msg_len);
+    if (bc.bad) return -1;
+    size_t at = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        if (s->mlen[i] > msg_len - at) return -1;
+        if (s->match[i]) {
+            clog_archive_row row;
+            row.ts_ms   = s->ts[i];
+            row.level   = (clog_level)s->lvl[i];
+            row.tid     = s->dict[2][s->tid[i]];
+            row.file    = s->dict[0][s->file[i]];
+            row.line    = s->line[i];
+            row.group   = s->dict[1][s->grp[i]];
+            row.msg     = (const char *)msg + at;
+            row.msg_len = (size_t)s->mlen[i];
+            st->matches++;
+            if ((*stop = fn(ud, &row)) != 0) return 1;
+        }
+        at += (size_t)s->mlen[i];
+    }
+    return 0;
+}
+
+int clog_archive_scan(const char *path, const clog_archive_query *q,
+                      int (*fn)(void *ud, const clog_archive_row *row), void *ud, clog_archive_stats *st) {
+    clog_archive_stats dummy;
+    if (!st) st = &dummy;
+    memset(st, 0, sizeof *st);
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    clog_ar_scan_ s;
+    memset(&s, 0, sizeof s);
+    clog_ar_buf_  foot = {NULL, 0, 0};
+    unsigned char tail[16];
+    int           rc = -1, stop = 0;
+    uint32_t      groups, max_rows = 0;
+    uint64_t      foot_off, size;
+    size_t        n;
+    if (fseeko(f, 0, SEEK_END) != 0 || (size = (uint64_t)ftello(f)) < 28 || fseeko(f, -16, SEEK_END) != 0 ||
+        fread(tail, 1, 16, f) != 16 || memcmp(tail + 8, CLOG_AR_MAGIC_, 8) != 0)
+        goto out;
+    foot_off = clog_ar_get_le_(tail, 8);
+    if (foot_off < 8 || foot_off > size - 20 || !clog_ar_pread_(f, &s.head, foot_off, (size_t)(size - 16 - foot_off)))
+        goto out;
+
+    /* the footer is small; keep our own copy since s.head is reused per group */
+    if (!clog_ar_put_(&foot, s.head.p, s.head.len)) goto out;
+    groups = (uint32_t)clog_ar_get_le_(foot.p, 4);
+    if ((uint64_t)groups * CLOG_AR_FOOT_ENT_ + 4 != foot.len) goto out;
+    for (uint32_t g = 0; g < groups; g++) {
+        uint32_t r = (uint32_t)clog_ar_get_le_(foot.p + 4 + g * CLOG_AR_FOOT_ENT_ + 16, 4);
+        if (r > max_rows) max_rows = r;
+    }
+    n        = max_rows ? max_rows : 1;
+    s.ts     = (int64_t *)malloc(n * sizeof *s.ts);
+    s.mlen   = (uint64_t *)malloc(n * sizeof *s.mlen);
+    s.lvl    = (uint32_t *)malloc(n * 5 * sizeof *s.lvl);
+    s.match  = (bool *)malloc(n);
+    if (!s.ts || !s.mlen || !s.lvl || !s.match) goto out;
+    s.tid  = s.lvl + n;
+    s.file = s.tid + n;
+    s.grp  = s.file + n;
+    s.line = s.grp + n;
+
+    st->groups = groups;
+    rc         = 0;
+    for (uint32_t g = 0; g < groups && rc == 0; g++)
+        rc = clog_ar_scan_group_(f, foot.p + 4 + g * CLOG_AR_FOOT_ENT_, q, &s, fn, ud, st, &stop);
+    rc = rc < 0 ? -1 : stop;
+out:
+    free(foot.p);
+    for (int i = 0; i < 3; i++) {
+        free(s.dict[i]);
+        free(s.ok[i]);
+    }
+    free(s.head.p);
+    free(s.blob.p);
+    free(s.scratch.p);
+    free(s.ts);
+    free(s.mlen);
+    free(s.lvl);
+    free(s.match);
+    fclose(f);
+    return rc;
+}
+
+#endif /* CLOG_ARCHIVE_IMPLEMENTATION */
+
+#endif /* CLOG_ARCHIVE_H */
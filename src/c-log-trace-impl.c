@@ -0,0 +1,2 @@
+#define CLOG_TRACE_IMPLEMENTATION
+#include "c-log-trace.h"
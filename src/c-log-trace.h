@@ -0,0 +1,255 @@
+// c-log-trace.h — function entry/exit tracing for code built with -finstrument-functions.
+// Single-header like c-log.h: include everywhere; in ONE .c file #define CLOG_TRACE_IMPLEMENTATION before
+// including. The CMake build compiles it in src/c-log-trace-impl.c (target c_log_trace_hooks, POSIX); linking that
+// library into a program whose sources are built with -finstrument-functions turns tracing on.
+//
+// Every __cyg_profile_func_enter/exit appends a 16-byte event (u64 monotonic ns from the c-log clock provider with
+// bit 63 set on exit, u64 function address) to a ring of CLOG_TRACE_RING events owned by the calling thread; no
+// lock, no formatting, no symbol lookup. Rings are mmapped on a thread's first event, keep the newest events, and
+// are reused by later threads once their thread has exited. clog_trace_dump writes every ring plus the executable
+// mappings of the process; tools/c-log-trace symbolizes the addresses offline from the ELF symbol tables.
+//
+// Dump layout (host byte order; read it on the same architecture):
+//
+//   "CLOGFTR1", u32 0x01020304, u32 maps, u32 threads, u32 ring size, u64 wall ns, u64 mono ns (same instant)
+//   per map       u64 start, u64 end, u64 file offset, u32 path length, path bytes
+//   per thread    u64 tid, u64 events ever written, u64 events that follow, then the events oldest first
+
+#ifndef CLOG_TRACE_H
+#define CLOG_TRACE_H
+
+#include "c-log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(CLOG_TRACE_RING)
+#    define CLOG_TRACE_RING 65536  // events per thread (power of two); 16 bytes each
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#    define CLOG_TRACE_NOINST __attribute__((no_instrument_function))
+#else
+#    define CLOG_TRACE_NOINST
+#endif
+
+#define CLOG_TRACE_MAGIC "CLOGFTR1"
+#define CLOG_TRACE_EXIT  (UINT64_C(1) << 63)
+
+typedef struct {
+    uint64_t ts; /* monotonic ns; CLOG_TRACE_EXIT set on exit events */
+    uint64_t fn;
+} clog_trace_event;
+
+// Recording starts enabled when the library is loaded. Disabled hooks cost one relaxed load.
+void clog_trace_enable(bool on);
+bool clog_trace_enabled(void);
+
+// Writes a snapshot of every ring to fd. Threads keep recording meanwhile; events they overwrite during the copy
+// are left out, so the snapshot of a busy thread may start a little later than its ring did. Returns 0, or -1 with
+// errno set. At exit the rings are dumped to $CLOG_TRACE_FILE (default "c-log.<pid>.ftrace"; set it empty to skip).
+int clog_trace_dump(int fd);
+int clog_trace_dump_file(const char *path);
+
+void __cyg_profile_func_enter(void *fn, void *call_site) CLOG_TRACE_NOINST;
+void __cyg_profile_func_exit(void *fn, void *call_site) CLOG_TRACE_NOINST;
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef CLOG_TRACE_IMPLEMENTATION
+
+#    if (CLOG_TRACE_RING & (CLOG_TRACE_RING - 1)) || CLOG_TRACE_RING < 2
+#        error "CLOG_TRACE_RING must be a power of two"
+#    endif
+
+#    include <errno.h>
+#    include <fcntl.h>
+#    include <stdio.h>
+#    include <stdlib.h>
+#    include <string.h>
+#    include <sys/mman.h>
+
+typedef struct clog_trace_ring_ {
+    struct clog_trace_ring_ *next; /* rings are never unmapped; the list only grows */
+    int                      free; /* owner exited; a new thread may claim it */
+    uint64_t                 tid;
+    uint64_t                 head; /* events ever written; the owner publishes it with release */
+    clog_trace_event         ev[CLOG_TRACE_RING];
+} clog_trace_ring_;
+
+static int                                g_trace_on    = 1;
+static clog_trace_ring_                  *g_trace_rings = NULL;
+static pthread_key_t                      g_trace_key;
+static pthread_once_t                     g_trace_once = PTHREAD_ONCE_INIT;
+static CLOG_THREADLOCAL clog_trace_ring_ *g_trace_ring = NULL;
+static CLOG_THREADLOCAL int               g_trace_busy = 0; /* inside a hook, or the thread is exiting */
+
+CLOG_TRACE_NOINST static void clog_trace_thread_exit_(void *p) {
+    clog_trace_ring_ *r = p;
+    g_trace_busy        = 1; /* functions run from later destructors are not recorded */
+    g_trace_ring        = NULL;
+    __atomic_store_n(&r->free, 1, __ATOMIC_RELEASE);
+}
+
+CLOG_TRACE_NOINST static void clog_trace_key_init_(void) {
+    (void)pthread_key_create(&g_trace_key, clog_trace_thread_exit_);
+}
+
+/* first event on this thread: claim the ring of an exited thread, or map a new one */
+CLOG_TRACE_NOINST static clog_trace_ring_ *clog_trace_attach_(void) {
+    (void)pthread_once(&g_trace_once, clog_trace_key_init_); /* hooks may run before any constructor */
+    clog_trace_ring_ *r = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE);
+    for (; r; r = r->next) {
+        int one = 1;
+        if (__atomic_load_n(&r->free, __ATOMIC_RELAXED) &&
+            __atomic_compare_exchange_n(&r->free, &one, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+    if (!r) {
+        void *m = mmap(NULL, sizeof *r, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) return NULL;
+        r       = m;
+        r->next = __atomic_load_n(&g_trace_rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&g_trace_rings, &r->next, r, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    __atomic_store_n(&r->head, 0, __ATOMIC_RELEASE);
+    r->tid       = (uint64_t)clog_tid_();
+    g_trace_ring = r;
+    (void)pthread_setspecific(g_trace_key, r);
+    return r;
+}
+
+CLOG_TRACE_NOINST static inline void clog_trace_put_(void *fn, uint64_t kind) {
+    if (!__atomic_load_n(&g_trace_on, __ATOMIC_RELAXED) || g_trace_busy) return;
+    g_trace_busy        = 1; /* a user clock or the mmap above may be instrumented too */
+    clog_trace_ring_ *r = g_trace_ring;
+    if (CLOG_LIKELY(r) || (r = clog_trace_attach_()) != NULL) {
+        uint64_t          h = r->head;
+        clog_trace_event *e = &r->ev[h & (CLOG_TRACE_RING - 1)];
+        e->ts               = clog_now_ns_mono_() | kind;
+        e->fn               = (uint64_t)(uintptr_t)fn;
+        __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+    }
+    g_trace_busy = 0;
+}
+
+void __cyg_profile_func_enter(void *fn, void *call_site) {
+    (void)call_site;
+    clog_trace_put_(fn, 0);
+}
+void __cyg_profile_func_exit(void *fn, void *call_site) {
+    (void)call_site;
+    clog_trace_put_(fn, CLOG_TRACE_EXIT);
+}
+
+CLOG_TRACE_NOINST void clog_trace_enable(bool on) { __atomic_store_n(&g_trace_on, on ? 1 : 0, __ATOMIC_RELAXED); }
+CLOG_TRACE_NOINST bool clog_trace_enabled(void) { return __atomic_load_n(&g_trace_on, __ATOMIC_RELAXED) != 0; }
+
+CLOG_TRACE_NOINST static int clog_trace_put_all_(int fd, const void *p, size_t n) {
+    const char *c = p;
+    while (n) {
+        ssize_t w = write(fd, c, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        c += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/* executable file mappings: "start-end perms offset dev inode path" (Linux; elsewhere none are written) */
+CLOG_TRACE_NOINST static int clog_trace_put_maps_(int fd, uint32_t *count, bool write_them) {
+    *count = 0;
+#    if defined(__linux__)
+    FILE *f = fopen("/proc/self/maps", "r");
+    if (!f) return 0;
+    char line[4096 + 128];
+    int  rc = 0;
+    while (!rc && fgets(line, sizeof line, f)) {
+        unsigned long long lo, hi, off;
+        char               perms[8];
+        int                path_at = 0;
+        if (sscanf(line, "%llx-%llx %7s %llx %*s %*s %n", &lo, &hi, perms, &off, &path_at) != 4 || !path_at ||
+            perms[2] != 'x' || line[path_at] != '/')
+            continue;
+        char    *path = line + path_at;
+        uint32_t n    = (uint32_t)strcspn(path, "\n");
+        ++*count;
+        if (!write_them) continue;
+        uint64_t hdr[3] = {lo, hi, off};
+        if (clog_trace_put_all_(fd, hdr, sizeof hdr) || clog_trace_put_all_(fd, &n, sizeof n) ||
+            clog_trace_put_all_(fd, path, n))
+            rc = -1;
+    }
+    fclose(f);
+    return rc;
+#    else
+    (void)fd;
+    (void)write_them;
+    return 0;
+#    endif
+}
+
+CLOG_TRACE_NOINST int clog_trace_dump(int fd) {
+    int saved    = g_trace_busy;
+    g_trace_busy = 1; /* libc calls below may be instrumented in static builds */
+    uint32_t          threads = 0, maps = 0;
+    clog_trace_ring_ *rings   = __atomic_load_n(&g_trace_rings, __ATOMIC_ACQUIRE);
+    for (clog_trace_ring_ *r = rings; r; r = r->next) ++threads;
+    (void)clog_trace_put_maps_(fd, &maps, false);
+
+    clog_trace_event *copy = malloc(sizeof(clog_trace_event) * CLOG_TRACE_RING);
+    uint32_t          hdr[4] = {0x01020304u, maps, threads, CLOG_TRACE_RING};
+    uint64_t          t0[2]  = {clog_now_ns_wall_(), clog_now_ns_mono_()};
+    int               rc     = copy ? 0 : -1;
+    if (!rc && (clog_trace_put_all_(fd, CLOG_TRACE_MAGIC, 8) || clog_trace_put_all_(fd, hdr, sizeof hdr) ||
+                clog_trace_put_all_(fd, t0, sizeof t0)))
+        rc = -1;
+    /* the map count was taken above; a library loaded in between would make the header lie */
+    uint32_t again = 0;
+    if (!rc && (clog_trace_put_maps_(fd, &again, true) || again != maps)) rc = -1;
+
+    for (clog_trace_ring_ *r = rings; r && !rc; r = r->next) {
+        uint64_t h1    = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t first = h1 > CLOG_TRACE_RING ? h1 - CLOG_TRACE_RING : 0;
+        for (uint64_t i = first; i < h1; i++) copy[(size_t)(i - first)] = r->ev[i & (CLOG_TRACE_RING - 1)];
+        /* slots the owner reached while we copied (plus the one it may be writing) are not trustworthy */
+        uint64_t h2 = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t ok = h2 + 1 > CLOG_TRACE_RING ? h2 + 1 - CLOG_TRACE_RING : 0;
+        uint64_t from = ok > first ? (ok < h1 ? ok : h1) : first;
+        uint64_t th[3] = {r->tid, h1, h1 - from};
+        if (clog_trace_put_all_(fd, th, sizeof th) ||
+            clog_trace_put_all_(fd, copy + (size_t)(from - first), sizeof(clog_trace_event) * (size_t)(h1 - from)))
+            rc = -1;
+    }
+    free(copy);
+    g_trace_busy = saved;
+    return rc;
+}
+
+CLOG_TRACE_NOINST int clog_trace_dump_file(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    int rc = clog_trace_dump(fd);
+    if (close(fd) != 0) rc = -1;
+    return rc;
+}
+
+__attribute__((destructor)) CLOG_TRACE_NOINST static void clog_trace_fini_(void) {
+    clog_trace_enable(false);
+    const char *path = getenv("CLOG_TRACE_FILE");
+    char        def[48];
+    if (!path) {
+        (void)snprintf(def, sizeof def, "c-log.%ld.ftrace", (long)getpid());
+        path = def;
+    }
+    if (*path && clog_trace_dump_file(path) != 0)
+        fprintf(stderr, "c-log-trace: cannot write %s: %s\n", path, strerror(errno));
+}
+
+#endif  // CLOG_TRACE_IMPLEMENTATION
+#endif  // CLOG_TRACE_H
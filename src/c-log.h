@@ -28,6 +28,63 @@ extern "C" {
 #if !defined(CLOG_TIMERS_MAX)
 #    define CLOG_TIMERS_MAX 16
 #endif
+#if !defined(CLOG_BLOCK_MAX)
+#    define CLOG_BLOCK_MAX 8192  // per-thread buffer for clog_block_*; must be >= CLOG_LINE_MAX
+#endif
+#if !defined(CLOG_CAPTURE_MAX)
+#    define CLOG_CAPTURE_MAX 16384  // per-thread buffer for clog_capture_*
+#endif
+#if !defined(CLOG_STATS_THREADS)
+#    define CLOG_STATS_THREADS 16  // per-thread call-site tables for clog_stats_*; 0 compiles them out
+#endif
+#if !defined(CLOG_STATS_SITES)
+#    define CLOG_STATS_SITES 256  // call sites tracked per thread (power of two)
+#endif
+#if !defined(CLOG_RECORD)
+#    define CLOG_RECORD 0  // 1 builds the clog_record_* workload recorder for c-log-replay (~100 KB of buffers)
+#endif
+#if !defined(CLOG_RECORD_SITES)
+#    define CLOG_RECORD_SITES 1024  // distinct call sites per trace (power of two)
+#endif
+#if !defined(CLOG_LOCKSTAT_THREADS)
+#    define CLOG_LOCKSTAT_THREADS 16  // per-thread label tables for CLOG_MUTEX_*; 0 compiles the timing out
+#endif
+#if !defined(CLOG_LOCKSTAT_LABELS)
+#    define CLOG_LOCKSTAT_LABELS 32  // lock labels tracked per thread (power of two)
+#endif
+#if !defined(CLOG_COUNTERS_MAX)
+#    define CLOG_COUNTERS_MAX 64  // distinct clog_counter_add names; 0 compiles counters out
+#endif
+#if !defined(CLOG_COUNTER_NAME_MAX)
+#    define CLOG_COUNTER_NAME_MAX 48  // bytes per counter name, NUL included; names are copied into a fixed pool
+#endif
+#if !defined(CLOG_COUNTER_THREADS)
+#    define CLOG_COUNTER_THREADS 32  // live threads with their own counter slots; others share a locked set
+#endif
+#if !defined(CLOG_SINKS_MAX)
+#    define CLOG_SINKS_MAX 8  // clog_sink_add callbacks; 0 compiles sinks out
+#endif
+#if !defined(CLOG_TSC_CALIBRATE_MS)
+#    define CLOG_TSC_CALIBRATE_MS 10  // clog_set_clock(CLOG_CLOCK_TSC): time spent measuring the TSC rate
+#endif
+#if !defined(CLOG_SHARED_CHUNK)
+#    define CLOG_SHARED_CHUNK 4096  // clog_open_shared: largest single write(); longer records go out in chunks
+#endif
+#if !defined(CLOG_LOCKSTAT_WAIT_NS)
+#    define CLOG_LOCKSTAT_WAIT_NS 1000000  // default wait outlier threshold (1 ms)
+#endif
+#if !defined(CLOG_LOCKSTAT_HOLD_NS)
+#    define CLOG_LOCKSTAT_HOLD_NS 10000000  // default hold outlier threshold (10 ms)
+#endif
+#if !defined(CLOG_SHED_STEP_MS)
+#    define CLOG_SHED_STEP_MS 50  // min time between two shedding steps up
+#endif
+#if !defined(CLOG_SHED_HOLD_MS)
+#    define CLOG_SHED_HOLD_MS 1000  // pressure must stay low this long before each step down
+#endif
+#if !defined(CLOG_CAPTURE_LEVEL)
+#    define CLOG_CAPTURE_LEVEL CLOG_LVL_DEBUG  // lowest level kept while capturing
+#endif
 #if !defined(CLOG_COLOR)
 #    define CLOG_COLOR 1
 #endif
@@ -46,6 +103,12 @@ extern "C" {
 #if !defined(CLOG_TID_SHORT)
 #    define CLOG_TID_SHORT 0  // 1 => print low 24 bits hex as (t#XXXXXX)
 #endif
+#if !defined(CLOG_WITH_SEQ)
+#    define CLOG_WITH_SEQ 0  // 1 => process-wide record sequence number "#N" after the tid
+#endif
+#if !defined(CLOG_SEQ_LEASE)
+#    define CLOG_SEQ_LEASE 256  // numbers a thread takes from the global counter at a time
+#endif
 #if !defined(CLOG_TIME_UTC)
 #    define CLOG_TIME_UTC 0
 #endif
@@ -67,6 +130,20 @@ extern "C" {
 #ifndef CLOG_FORMAT_CHECK
 #    define CLOG_FORMAT_CHECK 0
 #endif
+/* V-level module overrides: fixed table, no heap */
+#if !defined(CLOG_VMODULE_MAX)
+#    define CLOG_VMODULE_MAX 16
+#endif
+#if !defined(CLOG_VMODULE_PAT_MAX)
+#    define CLOG_VMODULE_PAT_MAX 64
+#endif
+/* clog_set_filter: compiled program size (predicates plus operators) and string pool; 0 ops compiles it out */
+#if !defined(CLOG_FILTER_OPS)
+#    define CLOG_FILTER_OPS 32
+#endif
+#if !defined(CLOG_FILTER_STR)
+#    define CLOG_FILTER_STR 256
+#endif
 
 // printf-style format checking
 #if CLOG_FORMAT_CHECK && (defined(__GNUC__) || defined(__clang__))
@@ -75,6 +152,53 @@ extern "C" {
 #    define CLOG_PRINTF(A, B)
 #endif
 
+/* Cold call sites (default on): log macros test the level inline and keep the call behind an unlikely
+   branch; the front-ends are cold/noinline so the compiler moves argument marshalling out of hot code.
+   -DCLOG_COLD_SITES=0 restores plain calls. */
+#if !defined(CLOG_COLD_SITES)
+#    define CLOG_COLD_SITES 1
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#    define CLOG_LIKELY(x)   __builtin_expect(!!(x), 1)
+#    define CLOG_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#    define CLOG_LIKELY(x)   (x)
+#    define CLOG_UNLIKELY(x) (x)
+#endif
+/* Only with the inline gate: a cold callee reached unconditionally would make the whole caller cold. */
+#if CLOG_COLD_SITES && (defined(__GNUC__) || defined(__clang__))
+#    define CLOG_COLD __attribute__((cold, noinline))
+#else
+#    define CLOG_COLD
+#endif
+/* USDT probes (sys/sdt.h compatible, vendored below): provider "clog". Every log macro fires clog:log before the
+   level check, so bpftrace/perf can watch suppressed sites without lowering the level. With no tracer attached
+   a probe is one nop plus its operands. Default on for Linux x86-64/AArch64 with GCC/Clang. */
+#if !defined(CLOG_USDT)
+#    if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)) && (defined(__GNUC__) || defined(__clang__))
+#        define CLOG_USDT 1
+#    else
+#        define CLOG_USDT 0
+#    endif
+#endif
+/* Per-call-site prefix cache (default on with GCC/Clang): each log macro expansion owns a zero-initialized static
+   slot (.bss) that keeps the rendered "[LEVEL]\t[build] " piece (plain and colored) and "<file:line> [group] " after
+   first use, so a prefix is timestamp + tid + memcpy. The slot lives in a GNU statement expression, so the macros
+   stay expressions; other compilers default to -DCLOG_PREFIX_CACHE=0, which renders every piece on every call. */
+#if !defined(CLOG_PREFIX_CACHE)
+#    if defined(__GNUC__) || defined(__clang__)
+#        define CLOG_PREFIX_CACHE 1
+#    else
+#        define CLOG_PREFIX_CACHE 0
+#    endif
+#endif
+#if CLOG_PREFIX_CACHE && !(defined(__GNUC__) || defined(__clang__))
+#    error "CLOG_PREFIX_CACHE needs GNU statement expressions (GCC or Clang)"
+#endif
+#if !defined(CLOG_PREFIX_CACHE_MAX)
+#    define CLOG_PREFIX_CACHE_MAX 160 /* bytes per site; sites whose pieces do not fit are rendered */
+#endif
+
 #if !defined(CLOG_LOCK_KIND)
 // 0 = none (not safe), 1 = spin (atomic_flag), 2 = mutex (pthread/SRWLOCK)
 #    define CLOG_LOCK_KIND 2
@@ -102,7 +226,7 @@ extern "C" {
 #    define CLOG_FD_STDERR   2
 #    define CLOG_THREADLOCAL __declspec(thread)
 static inline unsigned long clog_tid_(void) { return (unsigned long)GetCurrentThreadId(); }
-static inline void          clog_localtime_parts_(int *Y, int *m, int *d, int *H, int *M, int *S, int *ms) {
+static inline void          clog_sys_localtime_parts_(int *Y, int *m, int *d, int *H, int *M, int *S, int *ms) {
     SYSTEMTIME st;
 #    if CLOG_TIME_UTC
     GetSystemTime(&st);
@@ -117,7 +241,34 @@ static inline void          clog_localtime_parts_(int *Y, int *m, int *d, int *H
     *S  = st.wSecond;
     *ms = st.wMilliseconds;
 }
-static inline uint64_t clog_now_ns_mono_(void) {
+/* wall clock as ns since the Unix epoch, and its calendar split (used when rendering is deferred) */
+static inline uint64_t clog_sys_wall_ns_(void) {
+    FILETIME ft;
+    GetSystemTimePreciseAsFileTime(&ft);
+    ULARGE_INTEGER u;
+    u.LowPart  = ft.dwLowDateTime;
+    u.HighPart = ft.dwHighDateTime;
+    return (u.QuadPart - 116444736000000000ULL) * 100ULL;
+}
+static inline void clog_wall_parts_(uint64_t ns, int *Y, int *m, int *d, int *H, int *M, int *S, int *ms) {
+    ULARGE_INTEGER u;
+    u.QuadPart  = ns / 100ULL + 116444736000000000ULL;
+    FILETIME ft = {u.LowPart, u.HighPart};
+    SYSTEMTIME st;
+    FileTimeToSystemTime(&ft, &st);
+#    if !CLOG_TIME_UTC
+    SYSTEMTIME lt;
+    if (SystemTimeToTzSpecificLocalTime(NULL, &st, &lt)) st = lt;
+#    endif
+    *Y  = st.wYear;
+    *m  = st.wMonth;
+    *d  = st.wDay;
+    *H  = st.wHour;
+    *M  = st.wMinute;
+    *S  = st.wSecond;
+    *ms = st.wMilliseconds;
+}
+static inline uint64_t clog_sys_mono_ns_(void) {
     static LARGE_INTEGER freq = {0};
     LARGE_INTEGER        c;
     if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
@@ -161,10 +312,14 @@ static inline unsigned long clog_tid_(void) {
     return (unsigned long)(uintptr_t)pthread_self();
 #    endif
 }
-static inline void clog_localtime_parts_(int *Y, int *m, int *d, int *H, int *M, int *S, int *ms) {
+/* wall clock as ns since the Unix epoch, and its calendar split (used when rendering is deferred) */
+static inline uint64_t clog_sys_wall_ns_(void) {
     struct timespec ts;
     clock_gettime(CLOCK_REALTIME, &ts);
-    time_t    sec = ts.tv_sec;
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+static inline void clog_wall_parts_(uint64_t ns, int *Y, int *m, int *d, int *H, int *M, int *S, int *ms) {
+    time_t    sec = (time_t)(ns / 1000000000ull);
     struct tm tmv;
 #    if CLOG_TIME_UTC
     gmtime_r(&sec, &tmv);
@@ -177,9 +332,9 @@ static inline void clog_localtime_parts_(int *Y, int *m, int *d, int *H, int *M,
     *H  = tmv.tm_hour;
     *M  = tmv.tm_min;
     *S  = tmv.tm_sec;
-    *ms = (int)(ts.tv_nsec / 1000000);
+    *ms = (int)((ns / 1000000ull) % 1000ull);
 }
-static inline uint64_t clog_now_ns_mono_(void) {
+static inline uint64_t clog_sys_mono_ns_(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
@@ -189,6 +344,35 @@ static inline int clog_isatty_fd_(int fd) { return isatty(fd); }
 #    endif
 #endif
 
+// Clock provider (clog_set_clock): while it is CLOG_CLOCK_SYSTEM the clocks above are read inline; any other
+// provider is one call into the library. Every time the library reads (prefixes, timers, shedding, lock timing)
+// goes through these two.
+extern int clog_clock_kind_;
+uint64_t   clogp_clock_wall_(void);
+uint64_t   clogp_clock_mono_(void);
+#if defined(__GNUC__) || defined(__clang__)
+#    define CLOG_CLOCK_LOAD_()   __atomic_load_n(&clog_clock_kind_, __ATOMIC_ACQUIRE)
+#    define CLOG_CLOCK_STORE_(v) __atomic_store_n(&clog_clock_kind_, (v), __ATOMIC_RELEASE)
+#else
+#    define CLOG_CLOCK_LOAD_()   (*(volatile int *)&clog_clock_kind_)
+#    define CLOG_CLOCK_STORE_(v) (*(volatile int *)&clog_clock_kind_ = (v))
+#endif
+static inline uint64_t clog_now_ns_wall_(void) {
+    return CLOG_LIKELY(CLOG_CLOCK_LOAD_() == 0) ? clog_sys_wall_ns_() : clogp_clock_wall_();
+}
+static inline uint64_t clog_now_ns_mono_(void) {
+    return CLOG_LIKELY(CLOG_CLOCK_LOAD_() == 0) ? clog_sys_mono_ns_() : clogp_clock_mono_();
+}
+static inline void clog_localtime_parts_(int *Y, int *m, int *d, int *H, int *M, int *S, int *ms) {
+#if defined(_WIN32)
+    if (CLOG_LIKELY(CLOG_CLOCK_LOAD_() == 0)) {
+        clog_sys_localtime_parts_(Y, m, d, H, M, S, ms);
+        return;
+    }
+#endif
+    clog_wall_parts_(clog_now_ns_wall_(), Y, m, d, H, M, S, ms);
+}
+
 // ---------- Levels ----------
 typedef enum {
     CLOG_TRACE = CLOG_LVL_TRACE,
@@ -224,78 +408,569 @@ clog_level clog_get_level(void);
 int        clog_get_fd(void);
 void       clog_set_fd(int fd);
 
+// Clock provider for timestamps, timers and every other time the library reads. CLOG_CLOCK_SYSTEM (default) is
+// clock_gettime(CLOCK_REALTIME / CLOCK_MONOTONIC), served from the vDSO on Linux. COARSE reads the _COARSE clocks
+// (tick resolution, a few ns per read). TSC scales rdtsc by a rate measured against the monotonic clock during the
+// call (CLOG_TSC_CALIBRATE_MS; x86-64 with an invariant TSC); its wall clock is anchored then and does not follow
+// later NTP steps. USER calls clk, e.g. a virtual clock for simulations and deterministic tests. Returns 0, or -1
+// with errno set when the kind is not available here (the clock is unchanged). Select it at init, before other
+// threads log: a timer started under one clock must not end under another.
+typedef enum { CLOG_CLOCK_SYSTEM, CLOG_CLOCK_COARSE, CLOG_CLOCK_TSC, CLOG_CLOCK_USER } clog_clock_kind;
+typedef struct {
+    uint64_t (*wall_ns)(void *ud); /* ns since the Unix epoch */
+    uint64_t (*mono_ns)(void *ud); /* ns from any fixed origin, never decreasing */
+    void *ud;
+} clog_clock;
+int             clog_set_clock(clog_clock_kind kind, const clog_clock *user);
+clog_clock_kind clog_get_clock(void);
+
+// Sinks: callbacks that see every record written to the fd (log_*, log_raw, timers, capture commits, block lines)
+// as a view into the logging thread's buffers; nothing is copied and the view is valid only during the call.
+// Rules: a sink runs on the logging thread with the write lock held, right after the record's write (block lines
+// as they are added), so sinks never run concurrently and see records in fd order. It must return quickly and
+// must not log: records logged from inside a sink are dropped. Add/remove take the lock; once clog_sink_remove
+// returns the sink is not running and will not be called again. Calls into the API from a sink (remove, counters,
+// dumps) run under the lock the thread already holds instead of deadlocking on it. Returns -1 when
+// CLOG_SINKS_MAX are registered (add) or the pair is not registered (remove).
+typedef struct {
+    clog_level    level;
+    uint64_t      ts_ns; /* wall clock the prefix shows, ns since the Unix epoch (capture: time of the call) */
+    unsigned long tid;
+    const char   *file; /* as the site passed it (a path, or a basename under CLOG_FILE_ID) */
+    int           line;
+    const char   *group; /* NULL when none */
+    const char   *prefix; /* rendered prefix with its trailing space, color codes included when on */
+    size_t        prefix_len;
+    const char   *msg; /* message without the trailing '\n'; a raw record's payload is the caller's buffer */
+    size_t        msg_len;
+} clog_record;
+typedef void (*clog_sink_fn)(const clog_record *r, void *ud);
+int clog_sink_add(clog_sink_fn fn, void *ud);
+int clog_sink_remove(clog_sink_fn fn, void *ud);
+
+// Per-thread threshold: lowers the level for the calling thread only (min of it and the global level). The shared
+// inline gate is not lowered: while any thread has an override, a call below the gate also compares against its own
+// thread's override (one thread-local load), so other threads' calls still stop inline. An override left set is
+// cleared when its thread exits.
+void       clog_thread_set_level(clog_level lvl);
+void       clog_thread_clear_level(void);
+clog_level clog_thread_get_level(void);  // effective level for this thread
+int        clog_thread_swap_level_(int lvl);
+#define CLOG_LVL_NONE_ (CLOG_LVL_FATAL + 1)
+
+// Adaptive load shedding: when the average lock wait + write time per record exceeds high_ns, TRACE, then DEBUG,
+// then INFO are dropped; each level comes back after the average stays below low_ns for CLOG_SHED_HOLD_MS.
+// One summary line reports what was dropped. high_ns == 0 disables it (default; no clock reads on the write path).
+void       clog_set_shedding(int high_ns, int low_ns);
+clog_level clog_get_shed_level(void);  // lowest level currently let through by shedding (CLOG_TRACE when idle)
+
+// File ids: a translation unit compiled with -DCLOG_FILE_ID=<n> names its log sites by clog_file_<n>_, a basename
+// defined once in a generated table (CLOG_FILE_DEF), instead of embedding its __FILE__ path. clog_file_ids() in
+// cmake/clog-file-ids.cmake assigns the ids and writes the table plus an "id<TAB>path" map for offline tools.
+// Output is unchanged since prefixes print the basename anyway; a site inside a header reports the including file.
+#define CLOG_FILE_SYM_(id)   CLOG_FILE_SYM_I_(id)
+#define CLOG_FILE_SYM_I_(id) clog_file_##id##_
+#if defined(_MSC_VER)
+#    define CLOG_FILE_DEF(id, name) __declspec(selectany) const char CLOG_FILE_SYM_(id)[] = name;
+#else
+#    define CLOG_FILE_DEF(id, name) __attribute__((weak)) const char CLOG_FILE_SYM_(id)[] = name;
+#endif
+#if defined(CLOG_FILE_ID)
+#    define CLOG_FILE_ CLOG_FILE_SYM_(CLOG_FILE_ID)
+extern const char CLOG_FILE_[];
+#else
+#    define CLOG_FILE_ __FILE__
+#endif
+
 // timers — call-site aware wrappers
 void clogp_timer_start_(const char *file, int line, const char *label);
 void clogp_timer_end_(const char *file, int line, const char *label);
-#define clog_start_time(label) clogp_timer_start_(__FILE__, __LINE__, (label))
-#define clog_end_time(label)   clogp_timer_end_(__FILE__, __LINE__, (label))
+#define clog_start_time(label) clogp_timer_start_(CLOG_FILE_, __LINE__, (label))
+#define clog_end_time(label)   clogp_timer_end_(CLOG_FILE_, __LINE__, (label))
 
 void clog_banner(void);
 
+// Multi-line blocks: lines accumulate per thread and are written contiguously under one lock acquisition.
+// A block larger than CLOG_BLOCK_MAX is written in contiguous chunks. A filter sees the file:line of clog_block_begin.
+void clog_block_begin_(clog_level lvl, const char *file, int line, const char *group);
+void clog_block_end(void);
+void clog_block_line_(const char *file, int line, const char *fmt, ...) CLOG_PRINTF(3, 4);
+#define clog_block_begin(lvl, group) clog_block_begin_((lvl), CLOG_FILE_, __LINE__, (group))
+#define clog_block_line(...)         clog_block_line_(CLOG_FILE_, __LINE__, __VA_ARGS__)
+
+// Request-scoped capture (tail sampling): while a capture is open on this thread, records below the runtime
+// level but >= CLOG_CAPTURE_LEVEL are kept in a bounded per-thread buffer instead of being dropped.
+// commit writes them out (original timestamps), discard throws them away. Formatting is deferred to commit.
+// A capture still open when its thread exits is discarded.
+void clog_capture_begin(void);
+void clog_capture_commit(void);
+void clog_capture_discard(void);
+
+// Sparse time index: while an index fd is set, the write path appends {wall ns, log offset} entries (16 bytes,
+// native byte order, after a "CLOGIDX1" header) for the first record of every second and, if every_records > 0,
+// every N records. The log fd must be seekable. clog_index_seek returns an offset at or before the first record
+// stamped >= wall_ns (0 if none is indexed earlier), or -1 on error.
+void    clog_set_index_fd(int fd, unsigned every_records);  // fd < 0 disables
+int64_t clog_index_seek(int index_fd, uint64_t wall_ns);
+
+// Record framing for crash forensics: while on, every write to the log fd (a record, a raw record, a block chunk,
+// a line of a stats or lock dump) is preceded by CLOG_FRAME_HDR bytes: CLOG_FRAME_MARK, the payload length and the
+// payload's CRC32C (both u32 little endian). The file is no longer plain text; c-log-recover validates it, skips
+// torn or corrupt spans and prints the intact records. clog_crc32c uses SSE4.2 / ARMv8 CRC instructions when
+// available (crc = 0 to start).
+#define CLOG_FRAME_MARK 0x1E
+#define CLOG_FRAME_HDR  9
+void     clog_set_framing(bool on);
+uint32_t clog_crc32c(uint32_t crc, const void *buf, size_t len);
+
+// Multi-process append: clog_open_shared opens path with O_APPEND (created 0644) and makes it the log fd, so any
+// number of processes can log to one file. Every write is a single write() of at most CLOG_SHARED_CHUNK bytes; a
+// longer record (a big block or raw payload) goes out as chunk records, each CLOG_SHARED_MARK "<pid>.<id>.<k>/<n>.
+// <len> " + len bytes + '\n', that c-log-merge puts back together. With shm_seq (needs CLOG_WITH_SEQ) the "#N"
+// leases come from a counter mapped from "<path>.seq", so numbers are unique across all writers and c-log-merge -s
+// can restore each thread's order. Returns the fd (the caller closes it), or -1 with errno set. clog_set_fd ends
+// the mode; the counter stays mapped for the life of the process.
+#define CLOG_SHARED_MARK 0x1F
+int clog_open_shared(const char *path, bool shm_seq);
+
+// Top talkers: per-call-site records / bytes / suppressed counters (keyed by file:line), kept in per-thread
+// tables and merged on dump. Off by default; up to CLOG_STATS_THREADS threads are tracked at a time (a table is
+// reused, counts kept, once its thread exits). While on, the inline gate stays at TRACE so calls below the level
+// reach the front-end to be counted as suppressed: every log_* call then costs a function call. Calls compiled out
+// by CLOG_MIN_LEVEL and log_v calls below their V-level are not seen.
+void clog_stats_enable(bool on);
+void clog_stats_dump(int top_n);          // sorted by bytes, one write per line to the current fd (framed if on)
+void clog_stats_dump_at_exit(int top_n);  // atexit() hook, registered once
+
+// Workload recorder: while on, every log_* / log_v call (emitted or not) appends a compact entry to fd: call site,
+// level, thread, inter-arrival time and argument sizes, never argument contents. Replay with c-log-replay.
+int      clog_record_start(int fd);  // -1 if fd < 0 or a recording is already running
+unsigned clog_record_stop(void);     // flushes; returns calls dropped because the site table was full
+
+// Lock instrumentation: CLOG_MUTEX_LOCK / CLOG_MUTEX_UNLOCK (below) time the wait for an application mutex and how
+// long it is held. Per-label counts and log2 histograms live in per-thread tables (CLOG_LOCKSTAT_THREADS of them,
+// passed on when a thread exits); a wait or hold above its threshold is logged at WARN in group "lock".
+void clog_lockstat_set_outliers(uint64_t wait_ns, uint64_t hold_ns);  // 0 disables that check
+void clog_lockstat_dump(void);  // merged per label, one write per line to the current fd (framed if on)
+void clogp_lock_acquired_(const char *file, int line, const char *label, uint64_t t0);
+void clogp_lock_release_(const char *file, int line, const char *label);
+
+// Named counters: clog_counter_add("cache.miss", 1) instead of a log line per event. Each call site registers its
+// name once and caches the handle; every thread adds into its own slots, so an add is one thread-local increment.
+// Reads sum the slots of all threads. A flush writes one INFO line in group "counters" with the changes since the
+// previous flush ("2.00 s: cache.hit=98 cache.miss=12"), through the normal prefix and fd; a flush the level or
+// filter would drop leaves the changes for the next one.
+int     clog_counter_register(const char *name);  // handle; same name => same handle; -1 if full or name too long
+int64_t clog_counter_get(const char *name);       // summed over threads (approximate while threads add)
+void    clog_counters_set_interval(int ms);       // flush when an add or a record finds ms elapsed; 0 = on demand
+void    clogp_counter_add_(int id, int64_t delta, const char *file, int line);
+void    clogp_counters_flush_(const char *file, int line);
+
 // internal front-ends
-void clog_log_file_line_(
+CLOG_COLD void clog_log_file_line_(
     clog_level lvl, const char *file, int line, const char *group, const char *fmt, ...
 ) CLOG_PRINTF(5, 6);
-void clog_vlog_file_line_(clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap);
+CLOG_COLD void clog_vlog_file_line_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap
+);
+
+/* Prefix cache slot, one per macro expansion, all zero until first use (file and line come with each call, so
+   nothing needs an initializer). `state` goes 0 -> 2 (ready) or 3 (does not fit) once, under the write lock; frag
+   holds the plain head, the colored head and the tail back to back, rendered for level `lvl` (log_raw takes the
+   level at run time: a call at another level renders its prefix). `filt` memoizes the clog_set_filter verdict as
+   (generation << 4 | lvl << 1 | pass) for the group pointer in `filt_group`. */
+typedef struct clog_psite_ {
+    int           state;
+    unsigned char lvl, n_plain, n_color, n_where, n_group;
+    char          frag[CLOG_PREFIX_CACHE_MAX];
+    int           filt;
+    const char   *filt_group;
+} clog_psite_;
+CLOG_COLD void clog_log_site_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group, const char *fmt, ...
+) CLOG_PRINTF(6, 7);
+CLOG_COLD void clog_log_raw_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group, const void *buf, size_t len
+);
+
+// Effective runtime threshold read by the macros before any argument is evaluated (relaxed, may lag a store).
+extern int clog_lvl_gate_;
+#if defined(__GNUC__) || defined(__clang__)
+#    define CLOG_GATE_LOAD_()   __atomic_load_n(&clog_lvl_gate_, __ATOMIC_RELAXED)
+#    define CLOG_GATE_STORE_(v) __atomic_store_n(&clog_lvl_gate_, (v), __ATOMIC_RELAXED)
+#else
+#    define CLOG_GATE_LOAD_()   (*(volatile int *)&clog_lvl_gate_)
+#    define CLOG_GATE_STORE_(v) (*(volatile int *)&clog_lvl_gate_ = (v))
+#endif
+
+// ---------- USDT probes ----------
+/* Minimal stapsdt note (the same layout <sys/sdt.h> emits, without semaphores): a nop at the probe address and
+   a .note.stapsdt entry naming provider, probe and "size@operand" argument specs (negative size = signed). */
+#if CLOG_USDT
+#    if !defined(__linux__) || !(defined(__x86_64__) || defined(__aarch64__))
+#        error "CLOG_USDT needs Linux on x86-64 or AArch64"
+#    endif
+#    define CLOG_SDT_ASM_(probe, args)                                        \
+        "990: nop\n"                                                          \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                          \
+        ".balign 4\n"                                                         \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                    \
+        "991: .asciz \"stapsdt\"\n"                                           \
+        "992: .balign 4\n"                                                    \
+        "993: .8byte 990b\n"                                                  \
+        ".8byte _.stapsdt.base\n"                                             \
+        ".8byte 0\n"                                                          \
+        ".asciz \"clog\"\n"                                                   \
+        ".asciz \"" probe "\"\n"                                               \
+        ".asciz \"" args "\"\n"                                                \
+        "994: .balign 4\n"                                                    \
+        ".popsection\n"                                                       \
+        ".ifndef _.stapsdt.base\n"                                            \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n"                                              \
+        ".hidden _.stapsdt.base\n"                                            \
+        "_.stapsdt.base: .space 1\n"                                          \
+        ".size _.stapsdt.base, 1\n"                                           \
+        ".popsection\n"                                                       \
+        ".endif\n"
+/* Expressions (GNU statement expression) so they also fit the expression-style log macros. The site probes run
+   before the level check, so the caller's level, group, format and length reach them only when they are
+   compile-time constants; anything else becomes -1 / NULL / 0 and is never evaluated by the probe. */
+#    define CLOG_PROBE_K_(x, alt) (__builtin_constant_p(x) ? (x) : (alt))
+#    define CLOG_PROBE_LOG_(lvl, file, line, group, fmt)                                                        \
+        __extension__({                                                                                       \
+            __asm__ __volatile__(CLOG_SDT_ASM_("log", "-4@%[a1] 8@%[a2] -4@%[a3] 8@%[a4] 8@%[a5]")             \
+                                 :                                                                            \
+                                 : [a1] "nor"(CLOG_PROBE_K_((int)(lvl), -1)), [a2] "nor"((const char *)(file)),  \
+                                   [a3] "nor"((int)(line)),                                                   \
+                                   [a4] "nor"((const char *)CLOG_PROBE_K_(group, (const char *)0)),           \
+                                   [a5] "nor"((const char *)CLOG_PROBE_K_(fmt, (const char *)0)));            \
+        })
+#    define CLOG_PROBE_RAW_(lvl, file, line, group, len)                                                        \
+        __extension__({                                                                                       \
+            __asm__ __volatile__(CLOG_SDT_ASM_("raw", "-4@%[a1] 8@%[a2] -4@%[a3] 8@%[a4] 8@%[a5]")             \
+                                 :                                                                            \
+                                 : [a1] "nor"(CLOG_PROBE_K_((int)(lvl), -1)), [a2] "nor"((const char *)(file)),  \
+                                   [a3] "nor"((int)(line)),                                                   \
+                                   [a4] "nor"((const char *)CLOG_PROBE_K_(group, (const char *)0)),           \
+                                   [a5] "nor"((size_t)CLOG_PROBE_K_(len, 0)));                                \
+        })
+#    define CLOG_PROBE_TIMER_(probe, file, line, label, ns)                                                     \
+        __extension__({                                                                                       \
+            __asm__ __volatile__(CLOG_SDT_ASM_(probe, "8@%[a1] -4@%[a2] 8@%[a3] 8@%[a4]")                      \
+                                 :                                                                            \
+                                 : [a1] "nor"((const char *)(file)), [a2] "nor"((int)(line)),                  \
+                                   [a3] "nor"((const char *)(label)), [a4] "nor"((uint64_t)(ns)));             \
+        })
+#else
+#    define CLOG_PROBE_LOG_(lvl, file, line, group, fmt)    ((void)0)
+#    define CLOG_PROBE_RAW_(lvl, file, line, group, len)    ((void)0)
+#    define CLOG_PROBE_TIMER_(probe, file, line, label, ns) ((void)0)
+#endif
+/* format string = first of the macro's variadic arguments */
+#define CLOG_FIRST_(...)       CLOG_FIRST_I_(__VA_ARGS__, 0)
+#define CLOG_FIRST_I_(a, ...)  a
+#define CLOG_PROBE_SITE_(lvl, g, ...) CLOG_PROBE_LOG_((lvl), CLOG_FILE_, __LINE__, (g), CLOG_FIRST_(__VA_ARGS__))
+
+/* This thread's override (CLOG_LVL_NONE_ => none). While any thread has one, the gate word is the level minus
+   CLOG_GATE_TLS_: every level passes the inline compare, and the branch it guards checks the real gate and this
+   thread's override before calling the front-end. With no override anywhere the disabled path is the one compare. */
+extern CLOG_THREADLOCAL int clog_thread_lvl_;
+#define CLOG_GATE_TLS_ 16
+static inline int clog_gate_tls_(int lvl) {
+    int gate = CLOG_GATE_LOAD_();
+    return gate >= 0 || lvl >= gate + CLOG_GATE_TLS_ || lvl >= clog_thread_lvl_;
+}
+
+#if CLOG_COLD_SITES
+#    define CLOG_GATE_(lvl) (CLOG_UNLIKELY((int)(lvl) >= CLOG_GATE_LOAD_()) && clog_gate_tls_((int)(lvl)))
+#else
+#    define CLOG_GATE_(lvl) 1
+#endif
+
+#if CLOG_PREFIX_CACHE
+#    define CLOG_LOG_(lvl, g, ...)                                                                             \
+        __extension__({                                                                                        \
+            static clog_psite_ CLOG_CAT(_clog_ps_, __LINE__);                                                  \
+            CLOG_PROBE_SITE_(lvl, g, __VA_ARGS__);                                                             \
+            if (CLOG_GATE_(lvl))                                                                               \
+                clog_log_site_(&CLOG_CAT(_clog_ps_, __LINE__), (lvl), CLOG_FILE_, __LINE__, (g), __VA_ARGS__); \
+            (void)0;                                                                                           \
+        })
+#elif CLOG_COLD_SITES
+#    define CLOG_LOG_(lvl, g, ...)                 \
+        (CLOG_PROBE_SITE_(lvl, g, __VA_ARGS__),    \
+         CLOG_GATE_(lvl) ? clog_log_file_line_((lvl), CLOG_FILE_, __LINE__, (g), __VA_ARGS__) : (void)0)
+#else
+#    define CLOG_LOG_(lvl, g, ...) \
+        (CLOG_PROBE_SITE_(lvl, g, __VA_ARGS__), clog_log_file_line_((lvl), CLOG_FILE_, __LINE__, (g), __VA_ARGS__))
+#endif
 
 #if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_TRACE
-#    define log_trace(...)          clog_log_file_line_(CLOG_TRACE, __FILE__, __LINE__, NULL, __VA_ARGS__)
-#    define log_trace_group(g, ...) clog_log_file_line_(CLOG_TRACE, __FILE__, __LINE__, (g), __VA_ARGS__)
+#    define log_trace(...)          CLOG_LOG_(CLOG_TRACE, NULL, __VA_ARGS__)
+#    define log_trace_group(g, ...) CLOG_LOG_(CLOG_TRACE, (g), __VA_ARGS__)
 #else
 #    define log_trace(...)          ((void)0)
 #    define log_trace_group(g, ...) ((void)0)
 #endif
 
 #if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_DEBUG
-#    define log_debug(...)          clog_log_file_line_(CLOG_DEBUG, __FILE__, __LINE__, NULL, __VA_ARGS__)
-#    define log_debug_group(g, ...) clog_log_file_line_(CLOG_DEBUG, __FILE__, __LINE__, (g), __VA_ARGS__)
+#    define log_debug(...)          CLOG_LOG_(CLOG_DEBUG, NULL, __VA_ARGS__)
+#    define log_debug_group(g, ...) CLOG_LOG_(CLOG_DEBUG, (g), __VA_ARGS__)
 #else
 #    define log_debug(...)          ((void)0)
 #    define log_debug_group(g, ...) ((void)0)
 #endif
 
 #if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_INFO
-#    define log_info(...)          clog_log_file_line_(CLOG_INFO, __FILE__, __LINE__, NULL, __VA_ARGS__)
-#    define log_info_group(g, ...) clog_log_file_line_(CLOG_INFO, __FILE__, __LINE__, (g), __VA_ARGS__)
+#    define log_info(...)          CLOG_LOG_(CLOG_INFO, NULL, __VA_ARGS__)
+#    define log_info_group(g, ...) CLOG_LOG_(CLOG_INFO, (g), __VA_ARGS__)
 #else
 #    define log_info(...)          ((void)0)
 #    define log_info_group(g, ...) ((void)0)
 #endif
 
 #if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_WARN
-#    define log_warn(...)          clog_log_file_line_(CLOG_WARN, __FILE__, __LINE__, NULL, __VA_ARGS__)
-#    define log_warn_group(g, ...) clog_log_file_line_(CLOG_WARN, __FILE__, __LINE__, (g), __VA_ARGS__)
+#    define log_warn(...)          CLOG_LOG_(CLOG_WARN, NULL, __VA_ARGS__)
+#    define log_warn_group(g, ...) CLOG_LOG_(CLOG_WARN, (g), __VA_ARGS__)
 #else
 #    define log_warn(...)          ((void)0)
 #    define log_warn_group(g, ...) ((void)0)
 #endif
 
 #if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_ERROR
-#    define log_error(...)          clog_log_file_line_(CLOG_ERROR, __FILE__, __LINE__, NULL, __VA_ARGS__)
-#    define log_error_group(g, ...) clog_log_file_line_(CLOG_ERROR, __FILE__, __LINE__, (g), __VA_ARGS__)
+#    define log_error(...)          CLOG_LOG_(CLOG_ERROR, NULL, __VA_ARGS__)
+#    define log_error_group(g, ...) CLOG_LOG_(CLOG_ERROR, (g), __VA_ARGS__)
 #else
 #    define log_error(...)          ((void)0)
 #    define log_error_group(g, ...) ((void)0)
 #endif
 
 #if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_FATAL
-#    define log_fatal(...)          clog_log_file_line_(CLOG_FATAL, __FILE__, __LINE__, NULL, __VA_ARGS__)
-#    define log_fatal_group(g, ...) clog_log_file_line_(CLOG_FATAL, __FILE__, __LINE__, (g), __VA_ARGS__)
+#    define log_fatal(...)          CLOG_LOG_(CLOG_FATAL, NULL, __VA_ARGS__)
+#    define log_fatal_group(g, ...) CLOG_LOG_(CLOG_FATAL, (g), __VA_ARGS__)
 #else
 #    define log_fatal(...)          ((void)0)
 #    define log_fatal_group(g, ...) ((void)0)
 #endif
 
-// Scope timer helper (times a block; emits at DEBUG)
+// ---------- Per-group compile-time floors ----------
+/* log_<level>_g(name, ...) takes the group as a bare identifier and logs under "name". Its floor comes from
+   -DCLOG_GROUP_MIN_<name>=LEVEL (CLOG_TRACE .. CLOG_FATAL, TRACE .. FATAL, 0 .. 5, or OFF) and falls back to
+   CLOG_COMPILETIME_MIN_LEVEL, so `-DCLOG_MIN_LEVEL=DEBUG -DCLOG_GROUP_MIN_net=TRACE` keeps TRACE in `net` only.
+   The decision is made by the preprocessor: below the floor the statement is ((void)0) and neither the format
+   string nor the arguments reach the compiler. */
+#define log_trace_g(g, ...) CLOG_GLOG_(0, CLOG_TRACE, CLOG_GROUP_MIN_##g, #g, __VA_ARGS__)
+#define log_debug_g(g, ...) CLOG_GLOG_(1, CLOG_DEBUG, CLOG_GROUP_MIN_##g, #g, __VA_ARGS__)
+#define log_info_g(g, ...)  CLOG_GLOG_(2, CLOG_INFO, CLOG_GROUP_MIN_##g, #g, __VA_ARGS__)
+#define log_warn_g(g, ...)  CLOG_GLOG_(3, CLOG_WARN, CLOG_GROUP_MIN_##g, #g, __VA_ARGS__)
+#define log_error_g(g, ...) CLOG_GLOG_(4, CLOG_ERROR, CLOG_GROUP_MIN_##g, #g, __VA_ARGS__)
+#define log_fatal_g(g, ...) CLOG_GLOG_(5, CLOG_FATAL, CLOG_GROUP_MIN_##g, #g, __VA_ARGS__)
+
+/* floor token -> digit: a known value expands to "~, N" and shifts N into second place, anything else
+   (an undefined CLOG_GROUP_MIN_<name>) leaves the default there */
+#define CLOG_GMIN_V_CLOG_TRACE ~, 0
+#define CLOG_GMIN_V_CLOG_DEBUG ~, 1
+#define CLOG_GMIN_V_CLOG_INFO  ~, 2
+#define CLOG_GMIN_V_CLOG_WARN  ~, 3
+#define CLOG_GMIN_V_CLOG_ERROR ~, 4
+#define CLOG_GMIN_V_CLOG_FATAL ~, 5
+#define CLOG_GMIN_V_TRACE      ~, 0
+#define CLOG_GMIN_V_DEBUG      ~, 1
+#define CLOG_GMIN_V_INFO       ~, 2
+#define CLOG_GMIN_V_WARN       ~, 3
+#define CLOG_GMIN_V_ERROR      ~, 4
+#define CLOG_GMIN_V_FATAL      ~, 5
+#define CLOG_GMIN_V_OFF        ~, 6
+#define CLOG_GMIN_V_0          ~, 0
+#define CLOG_GMIN_V_1          ~, 1
+#define CLOG_GMIN_V_2          ~, 2
+#define CLOG_GMIN_V_3          ~, 3
+#define CLOG_GMIN_V_4          ~, 4
+#define CLOG_GMIN_V_5          ~, 5
+#define CLOG_GMIN_V_6          ~, 6
+
+/* per floor: is level 0 .. 5 kept? */
+#define CLOG_GMASK_0 1, 1, 1, 1, 1, 1
+#define CLOG_GMASK_1 0, 1, 1, 1, 1, 1
+#define CLOG_GMASK_2 0, 0, 1, 1, 1, 1
+#define CLOG_GMASK_3 0, 0, 0, 1, 1, 1
+#define CLOG_GMASK_4 0, 0, 0, 0, 1, 1
+#define CLOG_GMASK_5 0, 0, 0, 0, 0, 1
+#define CLOG_GMASK_6 0, 0, 0, 0, 0, 0
+
+#define CLOG_GX_(x)                x /* MSVC's traditional preprocessor passes __VA_ARGS__ as one argument */
+#define CLOG_GSECOND_(...)         CLOG_GX_(CLOG_GSECOND_I_(__VA_ARGS__))
+#define CLOG_GSECOND_I_(a, b, ...) b
+#define CLOG_GLOOKUP_(x, d)        CLOG_GLOOKUP_I_(x, d)
+#define CLOG_GLOOKUP_I_(x, d)      CLOG_GSECOND_(CLOG_GMIN_V_##x, d, ~)
+#define CLOG_GFLOOR_(x)            CLOG_GLOOKUP_(x, CLOG_GLOOKUP_(CLOG_COMPILETIME_MIN_LEVEL, ~))
+
+#define CLOG_GPICK_(l, f)                   CLOG_GPICK_I_(l, f)
+#define CLOG_GPICK_I_(l, f)                 CLOG_GPICK_J_(l, CLOG_GMASK_##f)
+#define CLOG_GPICK_J_(l, ...)               CLOG_GX_(CLOG_GPICK_##l##_(__VA_ARGS__))
+#define CLOG_GPICK_0_(a, ...)               a
+#define CLOG_GPICK_1_(a, b, ...)            b
+#define CLOG_GPICK_2_(a, b, c, ...)         c
+#define CLOG_GPICK_3_(a, b, c, d, ...)      d
+#define CLOG_GPICK_4_(a, b, c, d, e, ...)   e
+#define CLOG_GPICK_5_(a, b, c, d, e, f)     f
+
+#define CLOG_GLOG_(l, lvl, x, gs, ...)    CLOG_GLOG_I_(CLOG_GPICK_(l, CLOG_GFLOOR_(x)), lvl, gs, __VA_ARGS__)
+#define CLOG_GLOG_I_(on, lvl, gs, ...)    CLOG_GLOG_J_(on, lvl, gs, __VA_ARGS__)
+#define CLOG_GLOG_J_(on, lvl, gs, ...)    CLOG_GLOG_##on##_(lvl, gs, __VA_ARGS__)
+#define CLOG_GLOG_0_(lvl, gs, ...)        ((void)0)
+#define CLOG_GLOG_1_(lvl, gs, ...)        CLOG_LOG_(lvl, gs, __VA_ARGS__)
+
+/* Prefix + caller's bytes in one writev: no copy into the line buffer, no format pass, no CLOG_LINE_MAX cap.
+   A '\n' is appended unless the payload ends with one. `lvl` is checked against the compile-time floor too. */
+#define CLOG_RAW_GATE_(lvl) ((int)(lvl) >= CLOG_COMPILETIME_MIN_LEVEL && CLOG_GATE_(lvl))
+#if CLOG_PREFIX_CACHE
+#    define log_raw(lvl, g, buf, len)                                                              \
+        __extension__({                                                                            \
+            static clog_psite_ CLOG_CAT(_clog_ps_, __LINE__);                                      \
+            CLOG_PROBE_RAW_((lvl), CLOG_FILE_, __LINE__, (g), (len));                              \
+            if (CLOG_RAW_GATE_(lvl))                                                               \
+                clog_log_raw_(                                                                     \
+                    &CLOG_CAT(_clog_ps_, __LINE__), (lvl), CLOG_FILE_, __LINE__, (g), (buf), (len) \
+                );                                                                                 \
+            (void)0;                                                                               \
+        })
+#else
+#    define log_raw(lvl, g, buf, len)                              \
+        (CLOG_PROBE_RAW_((lvl), CLOG_FILE_, __LINE__, (g), (len)), \
+         CLOG_RAW_GATE_(lvl) ? clog_log_raw_(NULL, (lvl), CLOG_FILE_, __LINE__, (g), (buf), (len)) : (void)0)
+#endif
+
 #define CLOG_CAT_(a, b) a##b
 #define CLOG_CAT(a, b)  CLOG_CAT_(a, b)
+
+// ---------- Verbosity (glog-style V-levels) ----------
+/* Each log_v expansion owns one static site. Its `v` starts at CLOG_V_UNRESOLVED_ so the first call
+   falls into clog_vsite_init_, which resolves the effective V (vmodule override or global V), links
+   the site for later re-resolution and returns the real answer. After that a disabled site costs
+   a single compare. `file` is stored last with release; a caller that sees it set re-reads `v`,
+   since the `v` it compared first may still have been CLOG_V_UNRESOLVED_. */
+typedef struct clog_vsite_ {
+    int                 v;
+    const char         *file; /* NULL until resolved */
+    const char         *group;
+    struct clog_vsite_ *next;
+} clog_vsite_;
+
+#define CLOG_V_UNRESOLVED_ 0x7fffffff
+#if defined(__GNUC__) || defined(__clang__)
+#    define CLOG_VSITE_V_(s)    __atomic_load_n(&(s).v, __ATOMIC_RELAXED)
+#    define CLOG_VSITE_FILE_(s) __atomic_load_n(&(s).file, __ATOMIC_ACQUIRE)
+#else
+#    define CLOG_VSITE_V_(s)    (*(volatile int *)&(s).v)
+#    define CLOG_VSITE_FILE_(s) (*(const char *volatile *)&(s).file)
+#endif
+#define CLOG_VSITE_ON_(s, n, g)                                                   \
+    (CLOG_UNLIKELY(CLOG_VSITE_V_(s) >= (n)) &&                                    \
+     (CLOG_VSITE_FILE_(s) ? CLOG_VSITE_V_(s) >= (n) : clog_vsite_init_(&(s), CLOG_FILE_, (g), (n))))
+
+void clog_set_v(int v);
+int  clog_get_v(void);
+// "pattern=N[,pattern=N...]"; patterns are globs (* ?) matched against the file stem or the group.
+// First match wins. NULL or "" clears all overrides. Returns 0 on success, -1 on a bad spec.
+int  clog_set_vmodule(const char *spec);
+bool clog_vsite_init_(clog_vsite_ *site, const char *file, const char *group, int n);
+// Admits records below the level threshold when the expression holds for their call site, e.g.
+//   level>=debug && group~"db*" && file="pool.c"
+// Fields: level (trace..fatal or 0-5), line, file (basename), group; operators = == != < <= > >= on level and line,
+// = != ~ (glob with * ?) on file and group; combine with && || ! and parentheses. The expression is compiled once,
+// and each call site remembers its verdict until the next clog_set_filter. NULL or "" removes the filter.
+// Returns 0 on success, -1 on a syntax error (the previous filter stays).
+int  clog_set_filter(const char *expr);
+
+#if CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_INFO && CLOG_PREFIX_CACHE
+#    define log_v_group(n, g, ...)                                                                        \
+        do {                                                                                              \
+            static clog_vsite_ CLOG_CAT(_clog_vs_, __LINE__) = {CLOG_V_UNRESOLVED_, NULL, NULL, NULL};    \
+            static clog_psite_ CLOG_CAT(_clog_ps_, __LINE__);                                             \
+            CLOG_PROBE_SITE_(CLOG_INFO, g, __VA_ARGS__);                                                  \
+            if (CLOG_VSITE_ON_(CLOG_CAT(_clog_vs_, __LINE__), n, g))                                      \
+                clog_log_site_(                                                                           \
+                    &CLOG_CAT(_clog_ps_, __LINE__), CLOG_INFO, CLOG_FILE_, __LINE__, (g), __VA_ARGS__     \
+                );                                                                                        \
+        } while (0)
+#elif CLOG_COMPILETIME_MIN_LEVEL <= CLOG_LVL_INFO
+#    define log_v_group(n, g, ...)                                                                        \
+        do {                                                                                              \
+            static clog_vsite_ CLOG_CAT(_clog_vs_, __LINE__) = {CLOG_V_UNRESOLVED_, NULL, NULL, NULL};    \
+            CLOG_PROBE_SITE_(CLOG_INFO, g, __VA_ARGS__);                                                  \
+            if (CLOG_VSITE_ON_(CLOG_CAT(_clog_vs_, __LINE__), n, g))                                      \
+                clog_log_file_line_(CLOG_INFO, CLOG_FILE_, __LINE__, (g), __VA_ARGS__);                   \
+        } while (0)
+#else
+#    define log_v_group(n, g, ...) ((void)0)
+#endif
+#define log_v(n, ...) log_v_group(n, NULL, __VA_ARGS__)
+
+// Scope timer helper (times a block; emits at DEBUG)
 #define CLOG_SCOPE_TIME(label)                                                                                \
     for (int CLOG_CAT(_clog_once_, __LINE__) = (clog_start_time(label), 0); !CLOG_CAT(_clog_once_, __LINE__); \
          (clog_end_time(label), CLOG_CAT(_clog_once_, __LINE__) = 1))
 
+// Scope level helper (lowers this thread's level for a block, restores the previous override after it)
+#define CLOG_SCOPE_LEVEL(lvl)                                                                               \
+    for (int CLOG_CAT(_clog_tl_prev_, __LINE__) = clog_thread_swap_level_((int)(lvl)),                      \
+             CLOG_CAT(_clog_tl_once_, __LINE__) = 0;                                                        \
+         !CLOG_CAT(_clog_tl_once_, __LINE__);                                                               \
+         (clog_thread_swap_level_(CLOG_CAT(_clog_tl_prev_, __LINE__)), CLOG_CAT(_clog_tl_once_, __LINE__) = 1))
+
+// Counters: the name is registered (copied) on the site's first call, so it must be the same string on every call
+// from that site (use clog_counter_register + clog_counter_add_id for computed names).
+#define CLOG_COUNTER_UNSET_ (-2)
+#define clog_counter_add(name, delta)                                                               \
+    do {                                                                                            \
+        static int CLOG_CAT(_clog_ctr_, __LINE__) = CLOG_COUNTER_UNSET_;                            \
+        if (CLOG_UNLIKELY(CLOG_CAT(_clog_ctr_, __LINE__) == CLOG_COUNTER_UNSET_))                   \
+            CLOG_CAT(_clog_ctr_, __LINE__) = clog_counter_register(name);                           \
+        clogp_counter_add_(CLOG_CAT(_clog_ctr_, __LINE__), (int64_t)(delta), CLOG_FILE_, __LINE__); \
+    } while (0)
+#define clog_counter_add_id(id, delta) clogp_counter_add_((id), (int64_t)(delta), CLOG_FILE_, __LINE__)
+#define clog_counters_flush()          clogp_counters_flush_(CLOG_FILE_, __LINE__)
+
+// Timed application locks. The label must be a string literal (or otherwise outlive the process' last dump); the
+// same label names one lock class, and each thread holds at most one lock of a class at a time. Override
+// CLOG_MUTEX_LOCK_FN / CLOG_MUTEX_UNLOCK_FN for other lock types.
+#if !defined(CLOG_MUTEX_LOCK_FN)
+#    if defined(_WIN32)
+#        define CLOG_MUTEX_LOCK_FN(m)   AcquireSRWLockExclusive(m)
+#        define CLOG_MUTEX_UNLOCK_FN(m) ReleaseSRWLockExclusive(m)
+#    else
+#        define CLOG_MUTEX_LOCK_FN(m)   pthread_mutex_lock(m)
+#        define CLOG_MUTEX_UNLOCK_FN(m) pthread_mutex_unlock(m)
+#    endif
+#endif
+#if CLOG_LOCKSTAT_THREADS > 0
+#    define CLOG_MUTEX_LOCK(m, label)                                             \
+        do {                                                                      \
+            uint64_t clog_lock_t0_ = clog_now_ns_mono_();                         \
+            (void)CLOG_MUTEX_LOCK_FN(m);                                          \
+            clogp_lock_acquired_(CLOG_FILE_, __LINE__, (label), clog_lock_t0_);   \
+        } while (0)
+#    define CLOG_MUTEX_UNLOCK(m, label)                               \
+        do {                                                          \
+            clogp_lock_release_(CLOG_FILE_, __LINE__, (label));       \
+            (void)CLOG_MUTEX_UNLOCK_FN(m);                            \
+        } while (0)
+#else
+#    define CLOG_MUTEX_LOCK(m, label)   ((void)(label), (void)CLOG_MUTEX_LOCK_FN(m))
+#    define CLOG_MUTEX_UNLOCK(m, label) ((void)(label), (void)CLOG_MUTEX_UNLOCK_FN(m))
+#endif
+
 #ifdef CLOG_IMPLEMENTATION
 #    include <errno.h>
+#    include <stdlib.h>
 #    include <string.h>
+#    if !defined(_WIN32)
+#        include <fcntl.h>
+#        include <sys/mman.h>
+#        include <sys/uio.h>
+#    endif
 
 // --- Atomics shim for state (dedupe) ---
 #    ifndef CLOG_HAVE_ATOMICS
@@ -316,7 +991,15 @@ using clog_atomic_int_ = std::atomic<int>;
 #            define CLOG_STATE_INT(name, init)                                                             \
                 static clog_atomic_int_ name{(init)};                                                      \
                 static inline int       name##_load(void) { return name.load(std::memory_order_relaxed); } \
-                static inline void      name##_store(int v) { name.store(v, std::memory_order_relaxed); }
+                static inline void      name##_store(int v) { name.store(v, std::memory_order_relaxed); } \
+                static inline int       name##_add(int v) { return name.fetch_add(v, std::memory_order_relaxed); }
+#            define CLOG_STATE_U64(name, init)                                                                \
+                static std::atomic<uint64_t> name{(init)};                                                    \
+                static inline uint64_t name##_load(void) { return name.load(std::memory_order_relaxed); }     \
+                static inline void     name##_store(uint64_t v) { name.store(v, std::memory_order_relaxed); } \
+                static inline uint64_t name##_add(uint64_t v) {                                               \
+                    return name.fetch_add(v, std::memory_order_relaxed);                                      \
+                }
 #        else
 /* --- C11 path: use <stdatomic.h> --- */
 #            include <stdatomic.h>
@@ -328,24 +1011,86 @@ typedef atomic_int clog_atomic_int_;
 #            define CLOG_STATE_INT(name, init)                                                                       \
                 static clog_atomic_int_ name = ATOMIC_VAR_INIT(init);                                                \
                 static inline int  name##_load(void) { return atomic_load_explicit(&(name), memory_order_relaxed); } \
-                static inline void name##_store(int v) { atomic_store_explicit(&(name), v, memory_order_relaxed); }
+                static inline void name##_store(int v) { atomic_store_explicit(&(name), v, memory_order_relaxed); } \
+                static inline int  name##_add(int v) { return atomic_fetch_add_explicit(&(name), v, memory_order_relaxed); }
+#            define CLOG_STATE_U64(name, init)                                          \
+                static _Atomic uint64_t name = ATOMIC_VAR_INIT(init);                   \
+                static inline uint64_t  name##_load(void) {                             \
+                    return atomic_load_explicit(&(name), memory_order_relaxed);         \
+                }                                                                       \
+                static inline void name##_store(uint64_t v) {                           \
+                    atomic_store_explicit(&(name), v, memory_order_relaxed);            \
+                }                                                                       \
+                static inline uint64_t name##_add(uint64_t v) {                         \
+                    return atomic_fetch_add_explicit(&(name), v, memory_order_relaxed); \
+                }
 #        endif
 #    else
 /* --- Fallback: non-atomic ints --- */
 #        define CLOG_STATE_INT(name, init)                        \
             static int         name = (init);                     \
             static inline int  name##_load(void) { return name; } \
-            static inline void name##_store(int v) { name = v; }
+            static inline void name##_store(int v) { name = v; }  \
+            static inline int  name##_add(int v) {                \
+                int old = name;                                   \
+                name += v;                                        \
+                return old;                                       \
+            }
+/* 64-bit counters take the write lock to add (only used off the per-record path); loads and stores are plain */
+#        define CLOG_STATE_U64(name, init)                                \
+            static uint64_t        name = (init);                         \
+            static inline uint64_t name##_load(void) { return name; }     \
+            static inline void     name##_store(uint64_t v) { name = v; } \
+            static inline uint64_t name##_add(uint64_t v) {               \
+                clog_lock_();                                             \
+                uint64_t old = name;                                      \
+                name += v;                                                \
+                clog_unlock_();                                           \
+                return old;                                               \
+            }
 #    endif
 
 CLOG_STATE_INT(g_lvl, CLOG_DEFAULT_LEVEL)
 CLOG_STATE_INT(g_fd, CLOG_FD_STDERR)
+CLOG_STATE_INT(g_sinks_n, 0) /* registered sinks; the table itself is guarded by the write lock */
+int clog_lvl_gate_ = CLOG_DEFAULT_LEVEL;
+CLOG_STATE_INT(g_shed_high_ns, 0)
+CLOG_STATE_INT(g_shed_low_ns, 0)
+CLOG_STATE_INT(g_shed, CLOG_LVL_TRACE) /* records below this are shed */
+CLOG_STATE_INT(g_shed_drop_trace, 0)
+CLOG_STATE_INT(g_shed_drop_debug, 0)
+CLOG_STATE_INT(g_shed_drop_info, 0)
 
 static inline int  clog_lvl_load_(void) { return g_lvl_load(); }
 static inline void clog_lvl_store_(int v) { g_lvl_store(v); }
 static inline int  clog_fd_load_(void) { return g_fd_load(); }
 static inline void clog_fd_store_(int v) { g_fd_store(v); }
 
+/* Threads that want records below g_lvl (captures) register here; the gate is the lowest of g_lvl and every
+   registered level, so their macros still reach the front-end. Thread level overrides are only counted: while
+   there are any, the word is biased by -CLOG_GATE_TLS_ instead of lowered. Everything below is guarded by the lock. */
+static int g_gate_want[CLOG_LVL_FATAL + 1];
+static int g_thread_overrides = 0;
+
+static void clog_gate_refresh_(void) {
+    int gate = clog_lvl_load_();
+    for (int l = 0; l < gate; l++)
+        if (g_gate_want[l]) {
+            gate = l;
+            break;
+        }
+    CLOG_GATE_STORE_(g_thread_overrides ? gate - CLOG_GATE_TLS_ : gate);
+}
+
+/* Sinks run on the writing thread with the write lock held. An API call made from inside a sink (clog_sink_remove,
+   clog_counter_get, a dump, ...) finds the lock already owned by its thread and does not take it again. */
+#    if CLOG_SINKS_MAX > 0
+static CLOG_THREADLOCAL bool g_in_sink = false;
+#        define CLOG_LOCK_OWNED_() CLOG_UNLIKELY(g_in_sink)
+#    else
+#        define CLOG_LOCK_OWNED_() 0
+#    endif
+
 #    if CLOG_THREAD_SAFE
 /* Spinlock (bounded) — requires atomics */
 #        if CLOG_LOCK_KIND == 1
@@ -359,6 +1104,7 @@ static inline void clog_fd_store_(int v) { g_fd_store(v); }
 #                include <atomic>
 static std::atomic_flag g_lock = ATOMIC_FLAG_INIT;
 static inline void      clog_lock_(void) {
+    if (CLOG_LOCK_OWNED_()) return;
     int spins = 0;
     while (g_lock.test_and_set(std::memory_order_acquire)) {
         if (++spins >= CLOG_SPIN_ITERS) {
@@ -371,13 +1117,16 @@ static inline void      clog_lock_(void) {
         }
     }
 }
-static inline void clog_unlock_(void) { g_lock.clear(std::memory_order_release); }
+static inline void clog_unlock_(void) {
+    if (!CLOG_LOCK_OWNED_()) g_lock.clear(std::memory_order_release);
+}
 
 /* C (C11): use <stdatomic.h> and atomic_flag */
 #            elif !defined(__STDC_NO_ATOMICS__)
 #                include <stdatomic.h>
 static atomic_flag g_lock = ATOMIC_FLAG_INIT;
 static inline void clog_lock_(void) {
+    if (CLOG_LOCK_OWNED_()) return;
     int spins = 0;
     while (atomic_flag_test_and_set_explicit(&g_lock, memory_order_acquire)) {
         if (++spins >= CLOG_SPIN_ITERS) {
@@ -390,7 +1139,9 @@ static inline void clog_lock_(void) {
         }
     }
 }
-static inline void clog_unlock_(void) { atomic_flag_clear_explicit(&g_lock, memory_order_release); }
+static inline void clog_unlock_(void) {
+    if (!CLOG_LOCK_OWNED_()) atomic_flag_clear_explicit(&g_lock, memory_order_release);
+}
 
 /* No atomics available in C: refuse spinlock to avoid UB */
 #            else
@@ -402,12 +1153,20 @@ static inline void clog_unlock_(void) { atomic_flag_clear_explicit(&g_lock, memo
 #        elif CLOG_LOCK_KIND == 2
 #            ifdef _WIN32
 static SRWLOCK     g_lock = SRWLOCK_INIT;
-static inline void clog_lock_(void) { AcquireSRWLockExclusive(&g_lock); }
-static inline void clog_unlock_(void) { ReleaseSRWLockExclusive(&g_lock); }
+static inline void clog_lock_(void) {
+    if (!CLOG_LOCK_OWNED_()) AcquireSRWLockExclusive(&g_lock);
+}
+static inline void clog_unlock_(void) {
+    if (!CLOG_LOCK_OWNED_()) ReleaseSRWLockExclusive(&g_lock);
+}
 #            else
 static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
-static inline void     clog_lock_(void) { (void)pthread_mutex_lock(&g_lock); }
-static inline void     clog_unlock_(void) { (void)pthread_mutex_unlock(&g_lock); }
+static inline void     clog_lock_(void) {
+    if (!CLOG_LOCK_OWNED_()) (void)pthread_mutex_lock(&g_lock);
+}
+static inline void clog_unlock_(void) {
+    if (!CLOG_LOCK_OWNED_()) (void)pthread_mutex_unlock(&g_lock);
+}
 #            endif
 
 /* No locking */
@@ -424,6 +1183,13 @@ static inline void clog_unlock_(void) {}
 // Per-thread scratch (no heap)
 static CLOG_THREADLOCAL char g_buf[CLOG_LINE_MAX];
 
+/* Per-thread level override (CLOG_LVL_NONE_ => none). The effective level is the lower of it and g_lvl. */
+CLOG_THREADLOCAL int clog_thread_lvl_ = CLOG_LVL_NONE_;
+static inline int    clog_eff_lvl_(void) {
+    int g = clog_lvl_load_();
+    return clog_thread_lvl_ < g ? clog_thread_lvl_ : g;
+}
+
 /* Timers (per-thread fixed slots) */
 typedef struct {
     uint64_t key, t0;
@@ -491,55 +1257,139 @@ static inline uint64_t clog_hash64_(const char *s) {
     return h;
 }
 
-static inline size_t clog_write_prefix_(
-    char *dst, size_t cap, clog_level lvl, const char *file, int line, const char *group
-) {
+typedef struct {
     int Y, m, d, H, M, S, ms;
-    clog_localtime_parts_(&Y, &m, &d, &H, &M, &S, &ms);
+} clog_tm_;
 
-    const char *fname = clog_basename_(file);
+/* snprintf result -> bytes actually in dst (excluding the NUL) */
+static inline size_t clog_snlen_(int n, size_t cap) {
+    if (n < 0 || !cap) return 0;
+    return (size_t)n >= cap ? cap - 1 : (size_t)n;
+}
 
-    /* Optional pieces are built once into tiny buffers. Empty strings when disabled. */
-    const char *col_open  = "";
-    const char *col_close = "";
-#    if CLOG_COLOR
-    if (clog_color_enabled_()) {
-        col_open  = clog_level_color_(lvl);
-        col_close = CLOG_ANSI_RESET;
-    }
-#    endif
+/* "[LEVEL]\t[build:...] " with or without color */
+static inline size_t clog_prefix_head_(char *dst, size_t cap, clog_level lvl, int color) {
+    const char *col_open  = color ? clog_level_color_(lvl) : "";
+    const char *col_close = color ? CLOG_ANSI_RESET : "";
 
-    char where[64];
-#    if CLOG_WITH_LINE
-    snprintf(where, sizeof where, "<%s:%d> ", fname, line);
-#    else
-    snprintf(where, sizeof where, "<%s> ", fname);
+    char buildbuf[48]     = "";
+#    if CLOG_WITH_BUILD_IN_PREFIX
+#        ifdef CLOG_BUILD
+    snprintf(buildbuf, sizeof buildbuf, "[build:%s] ", CLOG_BUILD);
+#        endif
 #    endif
+    return clog_snlen_(snprintf(dst, cap, "[%s%s%s]\t%s", col_open, clog_level_name_(lvl), col_close, buildbuf), cap);
+}
 
-    char tidbuf[32] = "";
+static inline size_t clog_prefix_tid_(char *dst, size_t cap) {
 #    if CLOG_WITH_TID
 #        if CLOG_TID_SHORT
-    snprintf(tidbuf, sizeof tidbuf, "(t#%06lx) ", clog_tid_() & 0xFFFFFFul);
+    return clog_snlen_(snprintf(dst, cap, "(t#%06lx) ", clog_tid_() & 0xFFFFFFul), cap);
 #        else
-    snprintf(tidbuf, sizeof tidbuf, "(tid:%lu) ", clog_tid_());
+    return clog_snlen_(snprintf(dst, cap, "(tid:%lu) ", clog_tid_()), cap);
 #        endif
+#    else
+    if (cap) dst[0] = '\0';
+    return 0;
 #    endif
+}
 
-    char buildbuf[48] = "";
-#    if CLOG_WITH_BUILD_IN_PREFIX
-#        ifdef CLOG_BUILD
-    snprintf(buildbuf, sizeof buildbuf, "[build:%s] ", CLOG_BUILD);
+// record sequence numbers: each thread leases CLOG_SEQ_LEASE numbers at a time from one process-wide counter,
+// so stamping a record is a thread-local increment. A lease block [k*L, (k+1)*L) belongs to a single thread and
+// is used in order; only the unused tail of a thread's last block is a gap that does not mean a lost record.
+// With clog_open_shared(path, true) the leases come from a counter shared by every process writing the file; a
+// thread drops its current lease when the counter it was taken from changes. A forked child drops the lease it
+// inherits (the parent keeps using it); without the shared counter its later leases still repeat the parent's.
+#    if CLOG_WITH_SEQ
+#        define CLOG_SEQ_MAX_ 22 /* "#" + 20 digits + " " */
+#        if !defined(_WIN32) && (defined(__GNUC__) || defined(__clang__))
+#            define CLOG_SEQ_SHM_ 1
+#        else
+#            define CLOG_SEQ_SHM_ 0
 #        endif
+CLOG_STATE_U64(g_seq_next, 0)
+static CLOG_THREADLOCAL uint64_t g_seq_cur = 0, g_seq_end = 0;
+#        if CLOG_SEQ_SHM_
+static uint64_t                   *g_seq_shm = NULL; /* published once mapped, never unmapped */
+static CLOG_THREADLOCAL uint64_t *g_seq_src = NULL;
+#        endif
+#        if defined(_WIN32)
+#            define CLOG_SEQ_FORK_ARM_() ((void)0)
+#        else
+/* only the forking thread exists in the child: its lease is the one to drop */
+static void           clog_seq_atfork_child_(void) { g_seq_cur = g_seq_end = 0; }
+static void           clog_seq_fork_register_(void) { (void)pthread_atfork(NULL, NULL, clog_seq_atfork_child_); }
+static pthread_once_t g_seq_fork_once = PTHREAD_ONCE_INIT;
+#            define CLOG_SEQ_FORK_ARM_() (void)pthread_once(&g_seq_fork_once, clog_seq_fork_register_)
+#        endif
+
+static inline uint64_t clog_seq_take_(void) {
+#        if CLOG_SEQ_SHM_
+    uint64_t *shm = __atomic_load_n(&g_seq_shm, __ATOMIC_ACQUIRE);
+    if (CLOG_UNLIKELY(g_seq_cur == g_seq_end || shm != g_seq_src)) {
+        CLOG_SEQ_FORK_ARM_();
+        g_seq_src = shm;
+        g_seq_cur = shm ? __atomic_fetch_add(shm, (uint64_t)CLOG_SEQ_LEASE, __ATOMIC_RELAXED)
+                        : g_seq_next_add(CLOG_SEQ_LEASE);
+        g_seq_end = g_seq_cur + CLOG_SEQ_LEASE;
+    }
+#        else
+    if (CLOG_UNLIKELY(g_seq_cur == g_seq_end)) {
+        CLOG_SEQ_FORK_ARM_();
+        g_seq_cur = g_seq_next_add(CLOG_SEQ_LEASE);
+        g_seq_end = g_seq_cur + CLOG_SEQ_LEASE;
+    }
+#        endif
+    return g_seq_cur++;
+}
+#    else
+#        define CLOG_SEQ_MAX_ 0
+#        define CLOG_SEQ_SHM_ 0
+#    endif
+
+/* takes the next number: call once per written record */
+static inline size_t clog_prefix_seq_(char *dst, size_t cap) {
+#    if CLOG_WITH_SEQ
+    return clog_snlen_(snprintf(dst, cap, "#%llu ", (unsigned long long)clog_seq_take_()), cap);
+#    else
+    if (cap) dst[0] = '\0';
+    return 0;
+#    endif
+}
+
+static inline size_t clog_prefix_where_(char *dst, size_t cap, const char *file, int line) {
+    const char *fname = clog_basename_(file);
+#    if CLOG_WITH_LINE
+    return clog_snlen_(snprintf(dst, cap, "<%s:%d> ", fname, line), cap);
+#    else
+    (void)line;
+    return clog_snlen_(snprintf(dst, cap, "<%s> ", fname), cap);
 #    endif
+}
+
+static inline size_t clog_prefix_group_(char *dst, size_t cap, const char *group) {
+    if (!group || !*group) {
+        if (cap) dst[0] = '\0';
+        return 0;
+    }
+    return clog_snlen_(snprintf(dst, cap, "[%s] ", group), cap);
+}
 
-    char groupbuf[64] = "";
-    if (group && *group) snprintf(groupbuf, sizeof groupbuf, "[%s] ", group);
+static inline size_t clog_write_prefix_tm_(
+    char *dst, size_t cap, const clog_tm_ *t, clog_level lvl, const char *file, int line, const char *group
+) {
+    /* Optional pieces are built once into tiny buffers. Empty strings when disabled. */
+    char head[96], tidbuf[32], seqbuf[CLOG_SEQ_MAX_ + 2], where[64], groupbuf[64];
+    (void)clog_prefix_head_(head, sizeof head, lvl, clog_color_enabled_());
+    (void)clog_prefix_tid_(tidbuf, sizeof tidbuf);
+    (void)clog_prefix_seq_(seqbuf, sizeof seqbuf);
+    (void)clog_prefix_where_(where, sizeof where, file, line);
+    (void)clog_prefix_group_(groupbuf, sizeof groupbuf, group);
 
     /* One shot. Truncation is fine; caller will add newline and [TRUNC]/... if needed. */
-    const char *lvlname = clog_level_name_(lvl);
-    int         n       = snprintf(
-        dst, cap, "%04d-%02d-%02d %02d:%02d:%02d.%03d [%s%s%s]\t%s%s%s%s", Y, m, d, H, M, S, ms, col_open, lvlname,
-        col_close, buildbuf, tidbuf, where, groupbuf
+    int n = snprintf(
+        dst, cap, "%04d-%02d-%02d %02d:%02d:%02d.%03d %s%s%s%s%s", t->Y, t->m, t->d, t->H, t->M, t->S, t->ms, head,
+        tidbuf, seqbuf, where, groupbuf
     );
 
     if (n < 0) return 0;
@@ -547,6 +1397,132 @@ static inline size_t clog_write_prefix_(
     return nn >= cap ? cap : nn;
 }
 
+/* With sinks registered the prefix time is read as ns and kept for the record view; the calendar split is the
+   same either way */
+static CLOG_THREADLOCAL uint64_t g_prefix_ns = 0;
+
+static inline void clog_prefix_time_(clog_tm_ *t) {
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load())) {
+        g_prefix_ns = clog_now_ns_wall_();
+        clog_wall_parts_(g_prefix_ns, &t->Y, &t->m, &t->d, &t->H, &t->M, &t->S, &t->ms);
+        return;
+    }
+    clog_localtime_parts_(&t->Y, &t->m, &t->d, &t->H, &t->M, &t->S, &t->ms);
+}
+
+static inline size_t clog_write_prefix_(
+    char *dst, size_t cap, clog_level lvl, const char *file, int line, const char *group
+) {
+    clog_tm_ t;
+    clog_prefix_time_(&t);
+    return clog_write_prefix_tm_(dst, cap, &t, lvl, file, line, group);
+}
+
+// per-call-site prefix cache
+#    if defined(__GNUC__) || defined(__clang__)
+#        define CLOG_PSITE_LOAD_(s)       __atomic_load_n(&(s)->state, __ATOMIC_ACQUIRE)
+#        define CLOG_PSITE_PUBLISH_(s, v) __atomic_store_n(&(s)->state, (v), __ATOMIC_RELEASE)
+#    else
+#        define CLOG_PSITE_LOAD_(s)       (*(volatile int *)&(s)->state)
+#        define CLOG_PSITE_PUBLISH_(s, v) (*(volatile int *)&(s)->state = (v))
+#    endif
+#    define CLOG_PSITE_READY_   2
+#    define CLOG_PSITE_NOFIT_   3
+
+/* "YYYY-MM-DD HH:MM:SS.mmm " without a format string */
+static inline void clog_put_dec_(char *p, int v, int width) {
+    for (int i = width - 1; i >= 0; --i, v /= 10) p[i] = (char)('0' + v % 10);
+}
+static inline void clog_put_ts_(char *p, const clog_tm_ *t) {
+    clog_put_dec_(p, t->Y, 4);
+    p[4] = '-';
+    clog_put_dec_(p + 5, t->m, 2);
+    p[7] = '-';
+    clog_put_dec_(p + 8, t->d, 2);
+    p[10] = ' ';
+    clog_put_dec_(p + 11, t->H, 2);
+    p[13] = ':';
+    clog_put_dec_(p + 14, t->M, 2);
+    p[16] = ':';
+    clog_put_dec_(p + 17, t->S, 2);
+    p[19] = '.';
+    clog_put_dec_(p + 20, t->ms, 3);
+    p[23] = ' ';
+}
+
+/* Renders the site's pieces once; the first group seen is the cached one. Returns the final state. */
+static int clog_psite_build_(clog_psite_ *s, clog_level lvl, const char *file, int line, const char *group) {
+    char   plain[96], color[96], where[64], groupbuf[64];
+    size_t np = clog_prefix_head_(plain, sizeof plain, lvl, 0);
+    size_t nc = clog_prefix_head_(color, sizeof color, lvl, 1);
+    size_t nw = clog_prefix_where_(where, sizeof where, file, line);
+    size_t ng = clog_prefix_group_(groupbuf, sizeof groupbuf, group);
+    /* a clipped group could not be matched back against the caller's string */
+    bool   fit = np + nc + nw + ng <= sizeof s->frag && !(ng && ng + 1 == sizeof groupbuf);
+
+    clog_lock_();
+    int st = CLOG_PSITE_LOAD_(s);
+    if (!st) {
+        if (fit) {
+            memcpy(s->frag, plain, np);
+            memcpy(s->frag + np, color, nc);
+            memcpy(s->frag + np + nc, where, nw);
+            memcpy(s->frag + np + nc + nw, groupbuf, ng);
+            s->lvl     = (unsigned char)lvl;
+            s->n_plain = (unsigned char)np;
+            s->n_color = (unsigned char)nc;
+            s->n_where = (unsigned char)nw;
+            s->n_group = (unsigned char)ng;
+        }
+        st = fit ? CLOG_PSITE_READY_ : CLOG_PSITE_NOFIT_;
+        CLOG_PSITE_PUBLISH_(s, st);
+    }
+    clog_unlock_();
+    return st;
+}
+
+/* cached "[name] " equals what group would render to */
+static inline bool clog_psite_group_ok_(const clog_psite_ *s, const char *group) {
+    if (!group || !*group) return s->n_group == 0;
+    if (s->n_group < 3) return false;
+    size_t      len = (size_t)s->n_group - 3;
+    const char *g   = s->frag + s->n_plain + s->n_color + s->n_where + 1;
+    return strncmp(group, g, len) == 0 && group[len] == '\0';
+}
+
+/* Same bytes as clog_write_prefix_, but only the timestamp and tid are rendered per call. */
+static inline size_t clog_write_prefix_site_(
+    char *dst, size_t cap, clog_level lvl, clog_psite_ *s, const char *file, int line, const char *group
+) {
+    int st = CLOG_PSITE_LOAD_(s);
+    if (CLOG_UNLIKELY(!st)) st = clog_psite_build_(s, lvl, file, line, group);
+    if (st != CLOG_PSITE_READY_ || s->lvl != (unsigned char)lvl || !clog_psite_group_ok_(s, group))
+        return clog_write_prefix_(dst, cap, lvl, file, line, group);
+
+    char        tidbuf[32];
+    size_t      nt    = clog_prefix_tid_(tidbuf, sizeof tidbuf);
+    bool        color = clog_color_enabled_() != 0;
+    const char *head  = s->frag + (color ? s->n_plain : 0);
+    size_t      nh    = color ? s->n_color : s->n_plain;
+    const char *tail  = s->frag + s->n_plain + s->n_color;
+    size_t      ntl   = (size_t)s->n_where + s->n_group;
+    if (24 + nh + nt + CLOG_SEQ_MAX_ + ntl >= cap) return clog_write_prefix_(dst, cap, lvl, file, line, group);
+
+    clog_tm_ t;
+    clog_prefix_time_(&t);
+    clog_put_ts_(dst, &t);
+    char *p = dst + 24;
+    memcpy(p, head, nh);
+    p += nh;
+    memcpy(p, tidbuf, nt);
+    p += nt;
+    p += clog_prefix_seq_(p, CLOG_SEQ_MAX_ + 1);
+    memcpy(p, tail, ntl);
+    p += ntl;
+    *p = '\0';
+    return (size_t)(p - dst);
+}
+
 static inline int clog_write_all_(int fd, const char *p, size_t n) {
     size_t left = n;
     while (left) {
@@ -569,11 +1545,46 @@ static inline int clog_write_all_(int fd, const char *p, size_t n) {
     return 0;
 }
 
-/* ensure trailing '\n', then write [0..len) */
-static inline void clog_flush_line_(int fd, char *buf, size_t len) {
-    size_t cap = CLOG_LINE_MAX;
-    size_t off = len;
+#    if defined(_WIN32)
+typedef struct {
+    void  *iov_base;
+    size_t iov_len;
+} clog_iov_;
+#    else
+typedef struct iovec clog_iov_;
+#    endif
+
+/* all of iov[0..cnt) in order; iov is consumed. One writev per round on POSIX, one write per piece on Windows. */
+static inline int clog_writev_all_(int fd, clog_iov_ *iov, int cnt) {
+#    if defined(_WIN32)
+    for (int i = 0; i < cnt; i++)
+        if (clog_write_all_(fd, (const char *)iov[i].iov_base, iov[i].iov_len) != 0) return -1;
+    return 0;
+#    else
+    while (cnt > 0) {
+        ssize_t r = writev(fd, iov, cnt);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        size_t done = (size_t)r;
+        while (cnt > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    return 0;
+#    endif
+}
 
+/* ensure trailing '\n' within buf[0..cap); returns the new length */
+static inline size_t clog_terminate_line_(char *buf, size_t len, size_t cap) {
+    size_t off = len;
     if (off == 0 || buf[off - 1] != '\n') {
         if (off + 1 < cap) {
             buf[off++] = '\n';
@@ -584,94 +1595,2555 @@ static inline void clog_flush_line_(int fd, char *buf, size_t len) {
             off          = cap - 1;
         }
     }
+    return off;
+}
 
-#    if CLOG_THREAD_SAFE
-    clog_lock_();
-    (void)clog_write_all_(fd, buf, off);
-    clog_unlock_();
-#    else
-    (void)clog_write_all_(fd, buf, off);
+/* buf[0..cap - 1) was filled by a clipped render: end it with "..." and leave room for clog_terminate_line_'s '\n' */
+static inline size_t clog_mark_truncated_(char *buf, size_t cap) {
+    if (cap < 6) return cap ? cap - 1 : 0;
+    memcpy(buf + cap - 5, "...", 3);
+    buf[cap - 2] = '\0';
+    return cap - 2;
+}
+
+// CRC32C (Castagnoli): SSE4.2 crc32 on x86 (checked at run time), the ARMv8 CRC extension when the target has it,
+// slicing-by-8 otherwise
+#    if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#        include <nmmintrin.h>
+#        define CLOG_CRC_HW_X86_ 1
+#        define CLOG_CRC_TARGET_ __attribute__((target("sse4.2")))
+static inline bool clog_crc_hw_ok_(void) { return __builtin_cpu_supports("sse4.2"); }
+#    elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#        include <intrin.h>
+#        include <nmmintrin.h>
+#        define CLOG_CRC_HW_X86_ 1
+#        define CLOG_CRC_TARGET_
+static inline bool clog_crc_hw_ok_(void) {
+    int r[4];
+    __cpuid(r, 1);
+    return (r[2] >> 20) & 1;
+}
+#    elif defined(__ARM_FEATURE_CRC32)
+#        include <arm_acle.h>
+#        define CLOG_CRC_HW_ARM_ 1
+#    endif
+
+static uint32_t g_crc_tab[8][256];
+CLOG_STATE_INT(g_crc_hw, -1) /* -1 unknown, 0 software, 1 instructions */
+
+/* filled once; the once-primitive orders the table stores before any caller that returns from it */
+static void clog_crc_init_(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+        g_crc_tab[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+        for (int t = 1; t < 8; t++)
+            g_crc_tab[t][i] = (g_crc_tab[t - 1][i] >> 8) ^ g_crc_tab[0][g_crc_tab[t - 1][i] & 0xff];
+}
+#    if defined(_WIN32)
+static INIT_ONCE     g_crc_once = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK clog_crc_init_once_(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+    (void)once;
+    (void)param;
+    (void)ctx;
+    clog_crc_init_();
+    return TRUE;
+}
+#        define CLOG_CRC_TAB_INIT_() (void)InitOnceExecuteOnce(&g_crc_once, clog_crc_init_once_, NULL, NULL)
+#    else
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+#        define CLOG_CRC_TAB_INIT_() (void)pthread_once(&g_crc_once, clog_crc_init_)
+#    endif
+
+static uint32_t clog_crc_sw_(uint32_t c, const unsigned char *p, size_t n) {
+    CLOG_CRC_TAB_INIT_();
+    for (; n && ((uintptr_t)p & 7); --n) c = (c >> 8) ^ g_crc_tab[0][(c ^ *p++) & 0xff];
+    for (; n >= 8; n -= 8, p += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+#    if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#    endif
+        lo ^= c;
+        c = g_crc_tab[7][lo & 0xff] ^ g_crc_tab[6][(lo >> 8) & 0xff] ^ g_crc_tab[5][(lo >> 16) & 0xff] ^
+            g_crc_tab[4][lo >> 24] ^ g_crc_tab[3][hi & 0xff] ^ g_crc_tab[2][(hi >> 8) & 0xff] ^
+            g_crc_tab[1][(hi >> 16) & 0xff] ^ g_crc_tab[0][hi >> 24];
+    }
+    for (; n; --n) c = (c >> 8) ^ g_crc_tab[0][(c ^ *p++) & 0xff];
+    return c;
+}
+
+#    if defined(CLOG_CRC_HW_X86_)
+CLOG_CRC_TARGET_ static uint32_t clog_crc_hw_(uint32_t c, const unsigned char *p, size_t n) {
+    for (; n && ((uintptr_t)p & 7); --n) c = _mm_crc32_u8(c, *p++);
+#        if defined(__x86_64__) || defined(_M_X64)
+    uint64_t c64 = c;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c64 = _mm_crc32_u64(c64, v);
+    }
+    c = (uint32_t)c64;
+#        endif
+    for (; n >= 4; n -= 4, p += 4) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        c = _mm_crc32_u32(c, v);
+    }
+    for (; n; --n) c = _mm_crc32_u8(c, *p++);
+    return c;
+}
+#    elif defined(CLOG_CRC_HW_ARM_)
+static inline bool clog_crc_hw_ok_(void) { return true; }
+static uint32_t    clog_crc_hw_(uint32_t c, const unsigned char *p, size_t n) {
+    for (; n && ((uintptr_t)p & 7); --n) c = __crc32cb(c, *p++);
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = __crc32cd(c, v);
+    }
+    for (; n; --n) c = __crc32cb(c, *p++);
+    return c;
+}
+#    endif
+
+uint32_t clog_crc32c(uint32_t crc, const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char *)buf;
+    uint32_t             c = ~crc;
+#    if defined(CLOG_CRC_HW_X86_) || defined(CLOG_CRC_HW_ARM_)
+    int hw = g_crc_hw_load();
+    if (CLOG_UNLIKELY(hw < 0)) g_crc_hw_store(hw = clog_crc_hw_ok_() ? 1 : 0);
+    if (hw) return ~clog_crc_hw_(c, p, len);
+#    endif
+    return ~clog_crc_sw_(c, p, len);
+}
+
+CLOG_STATE_INT(g_framing, 0)
+
+static inline void clog_put_le32_(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+/* frame header for the concatenation of iov[0..cnt) */
+static inline void clog_frame_hdr_(unsigned char *hdr, const clog_iov_ *iov, int cnt) {
+    uint32_t crc = 0;
+    size_t   len = 0;
+    for (int i = 0; i < cnt; i++) {
+        crc = clog_crc32c(crc, iov[i].iov_base, iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+    hdr[0] = CLOG_FRAME_MARK;
+    clog_put_le32_(hdr + 1, (uint32_t)len);
+    clog_put_le32_(hdr + 5, crc);
+}
+
+void clog_set_framing(bool on) { g_framing_store(on ? 1 : 0); }
+
+// multi-process append (clog_open_shared); chunked records are numbered under the write lock
+#    if CLOG_SHARED_CHUNK < 256
+#        error "CLOG_SHARED_CHUNK must be at least 256"
+#    endif
+#    define CLOG_SHARED_HDR_MAX_ 80 /* mark + "<pid>.<id>.<k>/<n>.<len> " */
+CLOG_STATE_INT(g_shared, 0)
+static unsigned g_shared_id = 0;
+
+static inline long clog_pid_(void) {
+#    if defined(_WIN32)
+    return (long)GetCurrentProcessId();
+#    else
+    return (long)getpid();
+#    endif
+}
+
+/* called with the lock held: iov[0..cnt) in one write() when it fits in CLOG_SHARED_CHUNK, else as chunk records
+   of one write() each; other processes' writes can land between chunks but never inside one */
+static int clog_write_shared_(int fd, const clog_iov_ *iov, int cnt) {
+    size_t total = 0;
+    for (int i = 0; i < cnt; i++) total += iov[i].iov_len;
+    if (cnt == 1 && total <= CLOG_SHARED_CHUNK) return clog_write_all_(fd, (const char *)iov->iov_base, total);
+
+    char buf[CLOG_SHARED_CHUNK], *p = buf;
+    if (total <= CLOG_SHARED_CHUNK) {
+        for (int i = 0; i < cnt; i++) {
+            memcpy(p, iov[i].iov_base, iov[i].iov_len);
+            p += iov[i].iov_len;
+        }
+        return clog_write_all_(fd, buf, total);
+    }
+    size_t   room = CLOG_SHARED_CHUNK - CLOG_SHARED_HDR_MAX_ - 1, off = 0;
+    unsigned n = (unsigned)((total + room - 1) / room), id = g_shared_id++;
+    long     pid = clog_pid_();
+    for (unsigned k = 0; k < n; k++) {
+        size_t take = total < room ? total : room;
+        total -= take;
+        int h = snprintf(buf, CLOG_SHARED_HDR_MAX_, "%c%ld.%u.%u/%u.%zu ", CLOG_SHARED_MARK, pid, id, k, n, take);
+        if (h <= 0 || h >= CLOG_SHARED_HDR_MAX_) return -1;
+        p = buf + h;
+        while (take) {
+            size_t m = iov->iov_len - off;
+            if (m > take) m = take;
+            memcpy(p, (const char *)iov->iov_base + off, m);
+            p += m;
+            take -= m;
+            if ((off += m) == iov->iov_len) {
+                ++iov;
+                off = 0;
+            }
+        }
+        *p++ = '\n';
+        if (clog_write_all_(fd, buf, (size_t)(p - buf)) != 0) return -1;
+    }
+    return 0;
+}
+
+/* called with the lock held; consumes iov */
+static inline int clog_write_iov_(int fd, clog_iov_ *iov, int cnt) {
+    if (CLOG_UNLIKELY(g_shared_load())) return clog_write_shared_(fd, iov, cnt);
+    return cnt == 1 ? clog_write_all_(fd, (const char *)iov->iov_base, iov->iov_len) : clog_writev_all_(fd, iov, cnt);
+}
+
+#    if CLOG_SEQ_SHM_
+/* maps the 64-byte "<path>.seq" (created zeroed; an existing counter keeps counting) */
+static int clog_seq_map_(const char *path) {
+    char name[4096];
+    int  n = snprintf(name, sizeof name, "%s.seq", path);
+    if (n < 0 || (size_t)n >= sizeof name) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    struct stat sb;
+    void       *m = MAP_FAILED;
+    if (fstat(fd, &sb) == 0 && (sb.st_size >= 64 || ftruncate(fd, 64) == 0))
+        m = mmap(NULL, 64, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int e = errno;
+    close(fd);
+    if (m == MAP_FAILED) {
+        errno = e;
+        return -1;
+    }
+    __atomic_store_n(&g_seq_shm, (uint64_t *)m, __ATOMIC_RELEASE);
+    return 0;
+}
+#    endif
+
+int clog_open_shared(const char *path, bool shm_seq) {
+    if (!path) {
+        errno = EINVAL;
+        return -1;
+    }
+#    if !CLOG_WITH_SEQ
+    if (shm_seq) {
+        errno = EINVAL;
+        return -1;
+    }
+#    elif !CLOG_SEQ_SHM_
+    if (shm_seq) {
+        errno = ENOSYS;
+        return -1;
+    }
+#    endif
+#    if defined(_WIN32)
+    int fd = _open(path, _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#    else
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+#    endif
+    if (fd < 0) return -1;
+#    if CLOG_SEQ_SHM_
+    if (shm_seq && clog_seq_map_(path) != 0) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+#    endif
+    clog_fd_store_(fd);
+    g_shared_store(1);
+    return fd;
+}
+
+// load shedding (pressure state guarded by the write lock)
+static uint64_t g_shed_ewma_ns = 0, g_shed_changed_ns = 0, g_shed_hot_ns = 0, g_shed_since_ns = 0;
+
+static void clog_shed_count_(clog_level lvl) {
+    if (lvl == CLOG_TRACE) g_shed_drop_trace_add(1);
+    else if (lvl == CLOG_DEBUG) g_shed_drop_debug_add(1);
+    else g_shed_drop_info_add(1);
+#    if CLOG_WITH_SEQ
+    (void)clog_seq_take_(); /* a shed record leaves a gap downstream */
+#    endif
+}
+
+// sparse time index (state guarded by the write lock)
+static int      g_index_fd = -1, g_index_log_fd = -1;
+static unsigned g_index_every = 0, g_index_count = 0;
+static uint64_t g_index_sec   = 0;
+
+#    define CLOG_INDEX_MAGIC_ "CLOGIDX1"
+#    define CLOG_INDEX_HDR_   16
+
+static inline int64_t clog_fd_seek_(int fd, int64_t off, int whence) {
+#    if defined(_WIN32)
+    return (int64_t)_lseeki64(fd, off, whence);
+#    else
+    return (int64_t)lseek(fd, (off_t)off, whence);
+#    endif
+}
+
+/* called with the lock held before each write to the log fd: counts it, true if it gets an index entry (the first
+   of a new second, or every N) */
+static bool clog_index_due_(int fd, uint64_t *now) {
+    *now         = clog_now_ns_wall_();
+    uint64_t sec = *now / 1000000000ull;
+    if (fd != g_index_log_fd) {
+        g_index_log_fd = fd;
+        g_index_sec    = 0;
+    }
+    ++g_index_count;
+    return sec != g_index_sec || (g_index_every && g_index_count >= g_index_every);
+}
+
+/* off: where the write that was due landed */
+static void clog_index_put_(uint64_t now, int64_t off) {
+    if (off < 0) return; /* pipe/tty: nothing to index */
+    uint64_t e[2] = {now, (uint64_t)off};
+    (void)clog_write_all_(g_index_fd, (const char *)e, sizeof e);
+    g_index_sec   = now / 1000000000ull;
+    g_index_count = 0;
+}
+
+/* called with the lock held once shedding is over: one line summarizing the episode */
+static void clog_shed_summary_(int fd, uint64_t now) {
+    int t = g_shed_drop_trace_load(), d = g_shed_drop_debug_load(), i = g_shed_drop_info_load();
+    g_shed_drop_trace_add(-t);
+    g_shed_drop_debug_add(-d);
+    g_shed_drop_info_add(-i);
+    char line[160];
+    int  n = snprintf(line, sizeof line, "=== shed: dropped TRACE=%d DEBUG=%d INFO=%d over %.3f s ===\n", t, d, i,
+                      (double)(now - g_shed_since_ns) / 1e9);
+    if (n <= 0) return;
+    clog_iov_     iov[2];
+    unsigned char hdr[CLOG_FRAME_HDR];
+    int           framed = g_framing_load();
+    iov[1].iov_base      = line;
+    iov[1].iov_len       = (size_t)n < sizeof line ? (size_t)n : sizeof line - 1;
+    if (framed) {
+        clog_frame_hdr_(hdr, iov + 1, 1);
+        iov[0].iov_base = hdr;
+        iov[0].iov_len  = sizeof hdr;
+    }
+    (void)clog_write_iov_(fd, iov + 1 - framed, 1 + framed);
+}
+
+/* called with the lock held after each write; cost = lock wait + write. Steps up at most every CLOG_SHED_STEP_MS
+   while the average is above high; steps down once it has stayed below low for CLOG_SHED_HOLD_MS. */
+static void clog_shed_account_(int fd, uint64_t cost_ns, uint64_t now) {
+    int64_t diff   = (int64_t)cost_ns - (int64_t)g_shed_ewma_ns;
+    g_shed_ewma_ns = (uint64_t)((int64_t)g_shed_ewma_ns + diff / 8);
+
+    int shed       = g_shed_load();
+    if (g_shed_ewma_ns >= (uint64_t)g_shed_low_ns_load()) g_shed_hot_ns = now;
+    if (g_shed_ewma_ns > (uint64_t)g_shed_high_ns_load()) {
+        if (shed < CLOG_LVL_WARN && now - g_shed_changed_ns >= (uint64_t)CLOG_SHED_STEP_MS * 1000000u) {
+            if (shed == CLOG_LVL_TRACE) g_shed_since_ns = now;
+            g_shed_store(shed + 1);
+            g_shed_changed_ns = now;
+        }
+    } else if (shed > CLOG_LVL_TRACE) {
+        uint64_t last = g_shed_hot_ns > g_shed_changed_ns ? g_shed_hot_ns : g_shed_changed_ns;
+        if (now - last >= (uint64_t)CLOG_SHED_HOLD_MS * 1000000u) {
+            g_shed_store(shed - 1);
+            g_shed_changed_ns = now;
+            if (shed - 1 == CLOG_LVL_TRACE) clog_shed_summary_(fd, now);
+        }
+    }
+}
+
+// sinks (clog_sink_add); called with the write lock held
+#    if CLOG_SINKS_MAX > 0
+typedef struct {
+    clog_sink_fn fn;
+    void        *ud;
+} clog_sink_;
+static clog_sink_ g_sinks[CLOG_SINKS_MAX];
+static bool       g_sinks_removed = false; /* entries cleared by clog_sink_remove from inside a sink */
+
+static inline bool clog_in_sink_(void) { return g_in_sink; }
+
+/* Records written from inside a sink (a dump, a capture commit) are not passed on. Sinks added meanwhile start
+   with the next record; removed ones are skipped and compacted away afterwards. */
+static void clog_sinks_call_(const clog_record *r) {
+    if (g_in_sink) return;
+    g_in_sink = true;
+    for (int i = 0, n = g_sinks_n_load(); i < n; i++)
+        if (g_sinks[i].fn) g_sinks[i].fn(r, g_sinks[i].ud);
+    g_in_sink = false;
+    if (CLOG_UNLIKELY(g_sinks_removed)) {
+        int n = g_sinks_n_load(), k = 0;
+        for (int i = 0; i < n; i++)
+            if (g_sinks[i].fn) g_sinks[k++] = g_sinks[i];
+        g_sinks_n_store(k);
+        g_sinks_removed = false;
+    }
+}
+
+int clog_sink_add(clog_sink_fn fn, void *ud) {
+    if (!fn) return -1;
+    clog_lock_();
+    int n = g_sinks_n_load(), rc = -1;
+    if (n < CLOG_SINKS_MAX) {
+        g_sinks[n].fn = fn;
+        g_sinks[n].ud = ud;
+        g_sinks_n_store(n + 1);
+        rc = 0;
+    }
+    clog_unlock_();
+    return rc;
+}
+
+int clog_sink_remove(clog_sink_fn fn, void *ud) {
+    clog_lock_();
+    int n = g_sinks_n_load(), rc = -1;
+    for (int i = 0; i < n; i++) {
+        if (g_sinks[i].fn != fn || g_sinks[i].ud != ud) continue;
+        if (g_in_sink) { /* the loop in clog_sinks_call_ is walking the table */
+            g_sinks[i].fn   = NULL;
+            g_sinks_removed = true;
+        } else {
+            memmove(g_sinks + i, g_sinks + i + 1, (size_t)(n - i - 1) * sizeof *g_sinks);
+            g_sinks_n_store(n - 1);
+        }
+        rc = 0;
+        break;
+    }
+    clog_unlock_();
+    return rc;
+}
+#    else
+static inline bool clog_in_sink_(void) { return false; }
+static inline void clog_sinks_call_(const clog_record *r) { (void)r; }
+int clog_sink_add(clog_sink_fn fn, void *ud) {
+    (void)fn;
+    (void)ud;
+    return -1;
+}
+int clog_sink_remove(clog_sink_fn fn, void *ud) {
+    (void)fn;
+    (void)ud;
+    return -1;
+}
+#    endif
+
+/* the view of one rendered line buf[0..n) whose prefix is buf[0..prefix_len) */
+static inline void clog_record_view_(
+    clog_record *r, clog_level lvl, uint64_t ts_ns, const char *file, int line, const char *group, const char *buf,
+    size_t prefix_len, size_t n
+) {
+    if (prefix_len > n) prefix_len = n;
+    r->level      = lvl;
+    r->ts_ns      = ts_ns;
+    r->tid        = clog_tid_();
+    r->file       = file;
+    r->line       = line;
+    r->group      = group && *group ? group : NULL;
+    r->prefix     = buf;
+    r->prefix_len = prefix_len;
+    r->msg        = buf + prefix_len;
+    r->msg_len    = n - prefix_len - (n > prefix_len && buf[n - 1] == '\n' ? 1u : 0u);
+}
+
+/* most pieces the library hands to one write (log_raw: prefix, payload, '\n') */
+#    define CLOG_IOV_MAX_ 3
+
+/* framed write of iov[0..cnt) with the write lock held; the header takes one more slot on the stack */
+static inline void clog_writev_held_(int fd, clog_iov_ *iov, int cnt) {
+    clog_iov_     framed[CLOG_IOV_MAX_ + 1];
+    unsigned char hdr[CLOG_FRAME_HDR];
+    if (g_framing_load()) {
+        clog_frame_hdr_(hdr, iov, cnt);
+        if (cnt <= CLOG_IOV_MAX_) {
+            framed[0].iov_base = hdr;
+            framed[0].iov_len  = sizeof hdr;
+            memcpy(framed + 1, iov, (size_t)cnt * sizeof *iov);
+            iov = framed;
+            ++cnt;
+        } else {
+            /* not built by the library: the header goes out as a write of its own, still in front of its payload */
+            clog_iov_ h;
+            h.iov_base = hdr;
+            h.iov_len  = sizeof hdr;
+            (void)clog_write_iov_(fd, &h, 1);
+        }
+    }
+    uint64_t now = 0;
+    if (CLOG_LIKELY(g_index_fd < 0) || !clog_index_due_(fd, &now)) {
+        (void)clog_write_iov_(fd, iov, cnt);
+        return;
+    }
+    /* The offset is taken from the write itself: on an O_APPEND fd (shared mode, other writers) the data lands at
+       the end of file, not where this process last left its offset. A single write leaves the offset just past its
+       own bytes. A record split into chunk writes can have other processes' data between its chunks, so its entry
+       uses the size of the file before the first chunk, which is at or before it. */
+    size_t total = 0;
+    for (int i = 0; i < cnt; i++) total += iov[i].iov_len;
+    int64_t pre = g_shared_load() && total > CLOG_SHARED_CHUNK ? clog_fd_seek_(fd, 0, SEEK_END) : -1;
+    if (clog_write_iov_(fd, iov, cnt) != 0) return;
+    int64_t end = pre >= 0 ? -1 : clog_fd_seek_(fd, 0, SEEK_CUR);
+    clog_index_put_(now, pre >= 0 ? pre : end >= (int64_t)total ? end - (int64_t)total : -1);
+}
+
+/* called with the lock held: one line of a report (stats / lock dumps) through the framed path, clipped to
+   CLOG_LINE_MAX */
+static void clog_dump_printf_(int fd, const char *fmt, ...) CLOG_PRINTF(2, 3);
+static void clog_dump_printf_(int fd, const char *fmt, ...) {
+    char    line[CLOG_LINE_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(line, sizeof line, fmt, ap);
+    va_end(ap);
+    if (w <= 0) return;
+    clog_iov_ iov;
+    iov.iov_base = line;
+    iov.iov_len  = (size_t)w < sizeof line ? (size_t)w : sizeof line - 1;
+    clog_writev_held_(fd, &iov, 1);
+}
+
+/* rec: passed to the sinks after the write, NULL for lines that are not records */
+static inline void clog_writev_locked_(int fd, clog_iov_ *iov, int cnt, const clog_record *rec) {
+    uint64_t t0 = g_shed_high_ns_load() ? clog_now_ns_mono_() : 0;
+    clog_lock_();
+    clog_writev_held_(fd, iov, cnt);
+    if (t0) {
+        uint64_t now = clog_now_ns_mono_();
+        clog_shed_account_(fd, now - t0, now);
+    }
+    if (rec) clog_sinks_call_(rec);
+    clog_unlock_();
+}
+
+static inline void clog_write_locked_(int fd, const char *buf, size_t len) {
+    clog_iov_ iov;
+    iov.iov_base = (void *)(uintptr_t)buf;
+    iov.iov_len  = len;
+    clog_writev_locked_(fd, &iov, 1, NULL);
+}
+
+/* ensure trailing '\n', then write [0..len); returns the bytes written. With sinks registered and the record's
+   metadata given (file != NULL), the sinks see it as a record whose prefix is buf[0..prefix_len). */
+static inline size_t clog_flush_line_(
+    int fd, char *buf, size_t len, clog_level lvl, uint64_t ts_ns, const char *file, int line, const char *group,
+    size_t prefix_len
+) {
+    size_t    n = clog_terminate_line_(buf, len, CLOG_LINE_MAX);
+    clog_iov_ iov;
+    iov.iov_base = buf;
+    iov.iov_len  = n;
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load()) && file) {
+        clog_record r;
+        clog_record_view_(&r, lvl, ts_ns, file, line, group, buf, prefix_len, n);
+        clog_writev_locked_(fd, &iov, 1, &r);
+    } else {
+        clog_writev_locked_(fd, &iov, 1, NULL);
+    }
+    return n;
+}
+
+static inline void clog_sync_if_fatal_(int fd, clog_level lvl) {
+#    if defined(_WIN32)
+    if (lvl == CLOG_FATAL) { _commit(fd); }
+#    else
+    if (lvl == CLOG_FATAL) (void)fsync(fd);
+#    endif
+}
+
+static inline void clog_write_line_raw_(const char *s) {
+    int    fd  = clog_fd_load_();
+    char  *buf = g_buf;  // reuse per-thread buffer
+    size_t cap = CLOG_LINE_MAX;
+
+    size_t i   = 0;
+    if (s) {
+        for (; i + 1 < cap && s[i]; ++i) buf[i] = s[i];
+    }
+    clog_flush_line_(fd, buf, i, CLOG_INFO, 0, NULL, 0, NULL, 0);
+}
+
+/* prefix + message into buf[0..cap); "..." on truncation; no newline. *prefix_len: where the message starts */
+static inline size_t clog_format_record_(
+    char *buf, size_t cap, clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group,
+    const char *fmt, va_list ap, size_t *prefix_len
+) {
+    size_t off = site ? clog_write_prefix_site_(buf, cap, lvl, site, file, line, group)
+                      : clog_write_prefix_(buf, cap, lvl, file, line, group);
+    bool   truncated = false;
+    *prefix_len      = off;
+
+    if (off < cap) {
+        va_list ap2;
+        va_copy(ap2, ap);
+
+        size_t avail = cap - off;
+        /* macOS/Clang (and GCC) fortify headers warn on non-literal formats.
+        We intentionally allow non-literals here */
+#    if defined(__APPLE__)
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#    endif
+        int n = vsnprintf(buf + off, avail, fmt, ap2);
+#    if defined(__APPLE__)
+#        pragma GCC diagnostic pop
+#    endif
+        va_end(ap2);
+
+        if (n > 0) {
+            size_t nn = (size_t)n;
+            if (nn >= avail) {
+                truncated = true;
+            } else {
+                off += nn;
+            }
+        }
+    }
+    return truncated ? clog_mark_truncated_(buf, cap) : off;
+}
+
+// capture (per-thread, deferred formatting)
+/* Records keep fmt plus a compact copy of the arguments (strings copied, since the caller's buffers may be gone
+   by commit). Formats the serializer does not understand (positional args, %n, wide chars) are rendered eagerly. */
+enum { CLOG_ARG_INT_, CLOG_ARG_LONG_, CLOG_ARG_LLONG_, CLOG_ARG_IMAX_, CLOG_ARG_SIZE_, CLOG_ARG_PDIFF_,
+       CLOG_ARG_DBL_, CLOG_ARG_LDBL_, CLOG_ARG_STR_,  CLOG_ARG_PTR_,  CLOG_ARG_BAD_ };
+
+typedef union {
+    int         i;
+    long        l;
+    long long   ll;
+    intmax_t    j;
+    size_t      z;
+    ptrdiff_t   t;
+    double      d;
+    long double ld;
+    const void *p;
+} clog_arg_;
+
+typedef struct {
+    const char *start, *end; /* '%' .. one past the conversion char */
+    int         star_w, star_p, tag;
+    int         prec; /* literal precision, -1 if none or '*' */
+} clog_conv_;
+
+/* parse the conversion starting at p ('%'); conv.tag is CLOG_ARG_BAD_ for anything we can't replay */
+static const char *clog_conv_parse_(const char *p, clog_conv_ *c) {
+    c->start  = p++;
+    c->star_w = c->star_p = 0;
+    c->tag                = CLOG_ARG_BAD_;
+    c->prec               = -1;
+    while (*p && strchr("-+ #0", *p)) ++p;
+    if (*p == '*') {
+        c->star_w = 1;
+        ++p;
+    } else {
+        while (*p >= '0' && *p <= '9') ++p;
+        if (*p == '$') return p;
+    }
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') {
+            c->star_p = 1;
+            ++p;
+        } else {
+            for (c->prec = 0; *p >= '0' && *p <= '9'; ++p) {
+                if (c->prec < 100000000) c->prec = c->prec * 10 + (*p - '0');
+            }
+        }
+    }
+    int len = 0; /* 0 none, 1 l, 2 ll, 3 j, 4 z, 5 t, 6 L */
+    if (*p == 'h') {
+        p += p[1] == 'h' ? 2 : 1;
+    } else if (*p == 'l') {
+        len = p[1] == 'l' ? 2 : 1;
+        p += len;
+    } else if (*p == 'j' || *p == 'z' || *p == 't' || *p == 'L') {
+        len = *p == 'j' ? 3 : *p == 'z' ? 4 : *p == 't' ? 5 : 6;
+        ++p;
+    }
+    static const int int_tags[] = {CLOG_ARG_INT_,  CLOG_ARG_LONG_,  CLOG_ARG_LLONG_, CLOG_ARG_IMAX_,
+                                   CLOG_ARG_SIZE_, CLOG_ARG_PDIFF_, CLOG_ARG_BAD_};
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': c->tag = int_tags[len]; break;
+        case 'c': c->tag = len ? CLOG_ARG_BAD_ : CLOG_ARG_INT_; break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            c->tag = len == 6 ? CLOG_ARG_LDBL_ : len <= 1 ? CLOG_ARG_DBL_ : CLOG_ARG_BAD_;
+            break;
+        case 's': c->tag = len ? CLOG_ARG_BAD_ : CLOG_ARG_STR_; break;
+        case 'p': c->tag = CLOG_ARG_PTR_; break;
+        default: return *p ? p + 1 : p;
+    }
+    c->end = ++p;
+    return p;
+}
+
+static CLOG_THREADLOCAL unsigned char g_cap[CLOG_CAPTURE_MAX];
+static CLOG_THREADLOCAL size_t        g_cap_len     = 0;
+static CLOG_THREADLOCAL unsigned      g_cap_dropped = 0;
+static CLOG_THREADLOCAL bool          g_cap_on      = false;
+
+typedef struct {
+    size_t      size; /* header + payload */
+    uint64_t    wall_ns;
+    const char *file, *group, *fmt;
+    int         lvl, line;
+    bool        deferred;  /* payload: serialized args (true) or rendered message text (false) */
+    bool        truncated; /* rendered text clipped to the space that was left */
+} clog_cap_rec_;
+
+static bool clog_cap_put_(size_t *off, const void *p, size_t n) {
+    if (*off + n > CLOG_CAPTURE_MAX) return false;
+    memcpy(g_cap + *off, p, n);
+    *off += n;
+    return true;
+}
+
+/* serialize fmt's arguments after the header; false if the format can't be deferred or doesn't fit */
+static bool clog_cap_put_args_(size_t *off, const char *fmt, va_list ap) {
+    for (const char *p = fmt; (p = strchr(p, '%'));) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        clog_conv_ c;
+        p = clog_conv_parse_(p, &c);
+        if (c.tag == CLOG_ARG_BAD_) return false;
+        int prec = c.prec;
+        for (int k = 0; k < c.star_w + c.star_p; k++) {
+            int v = va_arg(ap, int);
+            if (!clog_cap_put_(off, &v, sizeof v)) return false;
+            if (k == c.star_w) prec = v; /* the precision star comes after the width's */
+        }
+        clog_arg_ a;
+        memset(&a, 0, sizeof a);
+        switch (c.tag) {
+            case CLOG_ARG_INT_: a.i = va_arg(ap, int); break;
+            case CLOG_ARG_LONG_: a.l = va_arg(ap, long); break;
+            case CLOG_ARG_LLONG_: a.ll = va_arg(ap, long long); break;
+            case CLOG_ARG_IMAX_: a.j = va_arg(ap, intmax_t); break;
+            case CLOG_ARG_SIZE_: a.z = va_arg(ap, size_t); break;
+            case CLOG_ARG_PDIFF_: a.t = va_arg(ap, ptrdiff_t); break;
+            case CLOG_ARG_DBL_: a.d = va_arg(ap, double); break;
+            case CLOG_ARG_LDBL_: a.ld = va_arg(ap, long double); break;
+            case CLOG_ARG_PTR_: a.p = va_arg(ap, void *); break;
+            case CLOG_ARG_STR_: {
+                const char *str = va_arg(ap, const char *);
+                if (!str) str = "(null)";
+                /* with a precision the argument need not be terminated: never read past it */
+                size_t len;
+                if (prec >= 0) {
+                    const char *z = memchr(str, '\0', (size_t)prec);
+                    len           = z ? (size_t)(z - str) : (size_t)prec;
+                } else {
+                    len = strlen(str);
+                }
+                size_t n = len + 1;
+                if (!clog_cap_put_(off, &n, sizeof n) || !clog_cap_put_(off, str, len) || !clog_cap_put_(off, "", 1))
+                    return false;
+                continue;
+            }
+            default: return false;
+        }
+        if (!clog_cap_put_(off, &a, sizeof a)) return false;
+    }
+    return true;
+}
+
+static void clog_capture_push_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap
+) {
+    clog_cap_rec_ r;
+    r.wall_ns = clog_now_ns_wall_();
+    r.file    = file;
+    r.group   = group;
+    r.fmt     = fmt;
+    r.lvl       = (int)lvl;
+    r.line      = line;
+    r.truncated = false;
+
+    size_t  start = g_cap_len, off = start + sizeof r;
+    va_list ap2;
+    va_copy(ap2, ap);
+    r.deferred = off <= CLOG_CAPTURE_MAX && clog_cap_put_args_(&off, fmt, ap2);
+    va_end(ap2);
+    if (!r.deferred) {
+        off = start + sizeof r;
+        if (off + 1 >= CLOG_CAPTURE_MAX) {
+            ++g_cap_dropped;
+            return;
+        }
+        /* no line shows more than CLOG_LINE_MAX; text that does not fit is kept clipped and marked */
+        size_t room = CLOG_CAPTURE_MAX - off < CLOG_LINE_MAX ? CLOG_CAPTURE_MAX - off : CLOG_LINE_MAX;
+        va_copy(ap2, ap);
+#    if defined(__APPLE__)
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#    endif
+        int n = vsnprintf((char *)g_cap + off, room, fmt, ap2);
+#    if defined(__APPLE__)
+#        pragma GCC diagnostic pop
+#    endif
+        va_end(ap2);
+        if (n < 0) {
+            ++g_cap_dropped;
+            return;
+        }
+        if ((size_t)n >= room) {
+            n           = (int)(room - 1);
+            r.truncated = true;
+        }
+        off += (size_t)n + 1;
+    }
+    r.size = off - start;
+    memcpy(g_cap + start, &r, sizeof r);
+    g_cap_len = off;
+}
+
+/* render one deferred message into dst[0..cap) by replaying each conversion with snprintf; *clipped is set if it
+   did not fit */
+#    if defined(__GNUC__) || defined(__clang__)
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#    endif
+static size_t clog_cap_render_(char *dst, size_t cap, const char *fmt, const unsigned char *args, bool *clipped) {
+    size_t      off = 0;
+    const char *p   = fmt;
+    while (*p && off + 1 < cap) {
+        if (*p != '%' || p[1] == '%') {
+            dst[off++] = *p;
+            p += *p == '%' ? 2 : 1;
+            continue;
+        }
+        clog_conv_ c;
+        p = clog_conv_parse_(p, &c);
+
+        char   spec[64];
+        size_t sn = 0;
+        for (const char *q = c.start; q < c.end && sn + 12 < sizeof spec; q++) {
+            if (*q != '*') {
+                spec[sn++] = *q;
+                continue;
+            }
+            int v;
+            memcpy(&v, args, sizeof v);
+            args += sizeof v;
+            if (v < 0 && sn && spec[sn - 1] == '.') {
+                --sn; /* negative precision: as if omitted */
+            } else {
+                int k = snprintf(spec + sn, sizeof spec - sn, "%d", v);
+                if (k > 0) sn += (size_t)k;
+            }
+        }
+        spec[sn] = '\0';
+
+        size_t avail = cap - off;
+        int    n;
+        if (c.tag == CLOG_ARG_STR_) {
+            size_t len;
+            memcpy(&len, args, sizeof len);
+            n = snprintf(dst + off, avail, spec, (const char *)(args + sizeof len));
+            args += sizeof len + len;
+        } else {
+            clog_arg_ a;
+            memcpy(&a, args, sizeof a);
+            args += sizeof a;
+            switch (c.tag) {
+                case CLOG_ARG_INT_: n = snprintf(dst + off, avail, spec, a.i); break;
+                case CLOG_ARG_LONG_: n = snprintf(dst + off, avail, spec, a.l); break;
+                case CLOG_ARG_LLONG_: n = snprintf(dst + off, avail, spec, a.ll); break;
+                case CLOG_ARG_IMAX_: n = snprintf(dst + off, avail, spec, a.j); break;
+                case CLOG_ARG_SIZE_: n = snprintf(dst + off, avail, spec, a.z); break;
+                case CLOG_ARG_PDIFF_: n = snprintf(dst + off, avail, spec, a.t); break;
+                case CLOG_ARG_DBL_: n = snprintf(dst + off, avail, spec, a.d); break;
+                case CLOG_ARG_LDBL_: n = snprintf(dst + off, avail, spec, a.ld); break;
+                default: n = snprintf(dst + off, avail, spec, a.p); break;
+            }
+        }
+        if (n < 0) break;
+        if ((size_t)n >= avail) {
+            off      = cap - 1;
+            *clipped = true;
+        } else {
+            off += (size_t)n;
+        }
+    }
+    if (*p && off + 1 >= cap) *clipped = true;
+    dst[off] = '\0';
+    return off;
+}
+#    if defined(__GNUC__) || defined(__clang__)
+#        pragma GCC diagnostic pop
+#    endif
+
+/* named counters (below): the flush interval is also polled after each written record */
+static void clog_counters_tick_(const char *file, int line);
+CLOG_STATE_INT(g_ctr_interval_ms, 0)
+
+// thread exit: a thread that leaves a level override set, a capture open or owns a stats, counter or lock table
+// registers a callback (pthread key destructor, FLS callback on Windows) that hands them back. Armed with the write
+// lock held.
+static void clog_stats_release_(void);
+static void clog_counters_release_(void);
+static void clog_lockstat_release_(void);
+static void clog_capture_end_(void);
+#    if defined(_WIN32)
+static DWORD        g_thr_exit_fls = FLS_OUT_OF_INDEXES;
+static VOID WINAPI  clog_thread_exit_(PVOID p) {
+    if (!p) return;
+    (void)clog_thread_swap_level_(CLOG_LVL_NONE_);
+    if (g_cap_on) clog_capture_end_(); /* discarded: nobody is left to commit it */
+    clog_stats_release_();
+    clog_counters_release_();
+    clog_lockstat_release_();
+}
+static void clog_thread_exit_arm_(void) {
+    if (g_thr_exit_fls == FLS_OUT_OF_INDEXES) g_thr_exit_fls = FlsAlloc(clog_thread_exit_);
+    if (g_thr_exit_fls != FLS_OUT_OF_INDEXES) (void)FlsSetValue(g_thr_exit_fls, (PVOID)1);
+}
+#    else
+static pthread_key_t g_thr_exit_key;
+static bool          g_thr_exit_key_ok = false;
+static void          clog_thread_exit_(void *p) {
+    (void)p;
+    (void)clog_thread_swap_level_(CLOG_LVL_NONE_);
+    if (g_cap_on) clog_capture_end_(); /* discarded: nobody is left to commit it */
+    clog_stats_release_();
+    clog_counters_release_();
+    clog_lockstat_release_();
+}
+static void clog_thread_exit_arm_(void) {
+    if (!g_thr_exit_key_ok) g_thr_exit_key_ok = pthread_key_create(&g_thr_exit_key, clog_thread_exit_) == 0;
+    if (g_thr_exit_key_ok) (void)pthread_setspecific(g_thr_exit_key, (void *)1);
+}
+#    endif
+
+// call-site stats: a fixed pool of per-thread tables, each written only by its owner thread.
+// Readers merge them without stopping writers, so a dump taken while threads log is approximate.
+#    if CLOG_STATS_THREADS > 0
+#        if CLOG_STATS_SITES & (CLOG_STATS_SITES - 1)
+#            error "CLOG_STATS_SITES must be a power of two"
+#        endif
+typedef struct {
+    const char *file; /* NULL => free slot */
+    int         line;
+    uint64_t    records, bytes, suppressed;
+} clog_site_stats_;
+
+typedef struct {
+    clog_site_stats_ sites[CLOG_STATS_SITES];
+    uint64_t         overflow; /* records whose site didn't fit */
+} clog_stats_tab_;
+
+static clog_stats_tab_                   g_stats[CLOG_STATS_THREADS];
+static bool                              g_stats_owned[CLOG_STATS_THREADS]; /* guarded by the write lock */
+static CLOG_THREADLOCAL clog_stats_tab_ *g_stats_tab = NULL;
+static CLOG_THREADLOCAL bool             g_stats_no_slot = false;
+CLOG_STATE_INT(g_stats_on, 0)
+CLOG_STATE_INT(g_stats_claimed, 0) /* tables ever handed out; dumps merge [0, claimed) */
+CLOG_STATE_INT(g_stats_no_table, 0) /* threads that found every table taken */
+
+/* this thread's table, claimed on first use while stats are on (takes the write lock). A table whose owner exited
+   is handed to the next thread with its counts kept: the dump merges by file:line anyway. */
+static clog_stats_tab_ *clog_stats_tab_get_(void) {
+    if (g_stats_tab || g_stats_no_slot || !g_stats_on_load()) return g_stats_tab;
+    clog_lock_();
+    int idx = 0;
+    while (idx < CLOG_STATS_THREADS && g_stats_owned[idx]) ++idx;
+    if (idx < CLOG_STATS_THREADS) {
+        g_stats_owned[idx] = true;
+        if (idx >= g_stats_claimed_load()) g_stats_claimed_store(idx + 1);
+        g_stats_tab = &g_stats[idx];
+        clog_thread_exit_arm_();
+    } else {
+        g_stats_no_slot = true;
+        (void)g_stats_no_table_add(1);
+    }
+    clog_unlock_();
+    return g_stats_tab;
+}
+
+static void clog_stats_release_(void) {
+    if (!g_stats_tab) return;
+    clog_lock_();
+    g_stats_owned[g_stats_tab - g_stats] = false;
+    clog_unlock_();
+    g_stats_tab = NULL;
+}
+
+static void clog_stats_note_(const char *file, int line, size_t bytes, bool suppressed) {
+    if (!g_stats_on_load() || !clog_stats_tab_get_()) return;
+    uint64_t h = ((uint64_t)(uintptr_t)file ^ (uint64_t)(unsigned)line * 0x9E3779B97F4A7C15ull) * 1099511628211ull;
+    for (unsigned i = 0; i < CLOG_STATS_SITES; i++) {
+        clog_site_stats_ *e = &g_stats_tab->sites[(h + i) & (CLOG_STATS_SITES - 1)];
+        if (!e->file) {
+            e->line = line;
+            e->file = file;
+        } else if (e->file != file || e->line != line) {
+            continue;
+        }
+        if (suppressed) {
+            ++e->suppressed;
+        } else {
+            ++e->records;
+            e->bytes += bytes;
+        }
+        return;
+    }
+    ++g_stats_tab->overflow;
+}
+#    else
+static inline void *clog_stats_tab_get_(void) { return NULL; }
+static void         clog_stats_release_(void) {}
+static inline void  clog_stats_note_(const char *file, int line, size_t bytes, bool suppressed) {
+    (void)file;
+    (void)line;
+    (void)bytes;
+    (void)suppressed;
+}
+#    endif
+
+// workload recorder. Trace layout (host byte order): "CLOGREC1", then entries
+//   'S' u16 id, i32 line, u16+file, u16+group, u16+fmt, u8 nargs (0xff: untyped), nargs class chars
+//   'R' u16 site, u8 lvl, u8 thread, u8 emitted, u32 delta_ns (same thread, saturating), u16 size per arg
+// Sizes: string length, decimal digits of integers / of the integer part of floats (bit 15 = negative);
+// an untyped site carries one size, its rendered message length.
+#    if CLOG_RECORD
+#        if CLOG_RECORD_SITES & (CLOG_RECORD_SITES - 1)
+#            error "CLOG_RECORD_SITES must be a power of two"
+#        endif
+#        define CLOG_REC_ARGS_    16
+#        define CLOG_REC_STR_MAX_ 4096
+typedef struct {
+    const char   *file, *group, *fmt; /* file NULL => free slot */
+    int           line;
+    uint16_t      id;
+    unsigned char nargs;
+} clog_rec_site_;
+
+/* all guarded by the write lock */
+static clog_rec_site_ g_rec_sites[CLOG_RECORD_SITES];
+static unsigned char  g_rec_buf[1 << 16];
+static size_t         g_rec_len = 0;
+static int            g_rec_fd = -1, g_rec_session = 0;
+static unsigned       g_rec_nsites = 0, g_rec_dropped = 0, g_rec_threads = 0;
+CLOG_STATE_INT(g_rec_on, 0)
+
+static CLOG_THREADLOCAL int           g_rec_thr_session = 0;
+static CLOG_THREADLOCAL unsigned char g_rec_thr         = 0;
+static CLOG_THREADLOCAL uint64_t      g_rec_last_ns     = 0;
+
+static void clog_rec_flush_(void) {
+    if (g_rec_len) (void)clog_write_all_(g_rec_fd, (const char *)g_rec_buf, g_rec_len);
+    g_rec_len = 0;
+}
+static void clog_rec_put_(const void *p, size_t n) {
+    if (g_rec_len + n > sizeof g_rec_buf) clog_rec_flush_();
+    memcpy(g_rec_buf + g_rec_len, p, n);
+    g_rec_len += n;
+}
+static void clog_rec_put_str_(const char *str) {
+    size_t   n   = str ? strlen(str) : 0;
+    uint16_t len = (uint16_t)(n < CLOG_REC_STR_MAX_ ? n : CLOG_REC_STR_MAX_);
+    clog_rec_put_(&len, sizeof len);
+    clog_rec_put_(str, len);
+}
+
+/* one class char per conversion: i(nteger), c(har), f(loating), s(tring), p(ointer); -1 if untyped */
+static int clog_rec_classes_(const char *fmt, char *cls) {
+    int n = 0;
+    for (const char *p = fmt; (p = strchr(p, '%'));) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        clog_conv_ c;
+        p = clog_conv_parse_(p, &c);
+        if (c.tag == CLOG_ARG_BAD_ || n == CLOG_REC_ARGS_) return -1;
+        char k = c.tag == CLOG_ARG_STR_ ? 's' : c.tag == CLOG_ARG_PTR_ ? 'p' : c.tag >= CLOG_ARG_DBL_ ? 'f' : 'i';
+        cls[n++] = k == 'i' && c.end[-1] == 'c' ? 'c' : k;
+    }
+    return n;
+}
+
+static uint16_t clog_rec_digits_(uintmax_t v, bool neg) {
+    uint16_t d = 1;
+    for (; v >= 10; v /= 10) ++d;
+    return (uint16_t)(neg ? d | 0x8000u : d);
+}
+
+/* walks a typed site's arguments; sizes only, contents never leave the process */
+static void clog_rec_sizes_(const char *fmt, va_list ap, uint16_t *sz) {
+    int n = 0;
+    for (const char *p = fmt; (p = strchr(p, '%'));) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        clog_conv_ c;
+        p        = clog_conv_parse_(p, &c);
+        int prec = c.prec;
+        for (int k = 0; k < c.star_w + c.star_p; k++) {
+            int v = va_arg(ap, int);
+            if (k == c.star_w) prec = v;
+        }
+        intmax_t    iv = 0;
+        long double fv = 0;
+        switch (c.tag) {
+            case CLOG_ARG_INT_: iv = va_arg(ap, int); break;
+            case CLOG_ARG_LONG_: iv = va_arg(ap, long); break;
+            case CLOG_ARG_LLONG_: iv = va_arg(ap, long long); break;
+            case CLOG_ARG_IMAX_: iv = va_arg(ap, intmax_t); break;
+            case CLOG_ARG_SIZE_: iv = (intmax_t)va_arg(ap, size_t); break;
+            case CLOG_ARG_PDIFF_: iv = va_arg(ap, ptrdiff_t); break;
+            case CLOG_ARG_DBL_: fv = va_arg(ap, double); break;
+            case CLOG_ARG_LDBL_: fv = va_arg(ap, long double); break;
+            case CLOG_ARG_PTR_: (void)va_arg(ap, void *); break;
+            default: {
+                const char *str = va_arg(ap, const char *);
+                size_t      len = 6;
+                if (str && prec >= 0) { /* bounded like clog_cap_put_args_: the argument need not be terminated */
+                    const char *z = memchr(str, '\0', (size_t)prec);
+                    len           = z ? (size_t)(z - str) : (size_t)prec;
+                } else if (str) {
+                    len = strlen(str);
+                }
+                sz[n++] = (uint16_t)(len < 0xffffu ? len : 0xffffu);
+                continue;
+            }
+        }
+        if (c.tag == CLOG_ARG_PTR_) {
+            sz[n++] = 0;
+        } else if (c.tag >= CLOG_ARG_DBL_) {
+            bool     neg = fv < 0;
+            uint16_t d   = 1;
+            for (fv = neg ? -fv : fv; fv >= 10 && d < 0x7fff; fv /= 10) ++d;
+            sz[n++] = (uint16_t)(neg ? d | 0x8000u : d);
+        } else {
+            uintmax_t mag = iv < 0 ? (uintmax_t)0 - (uintmax_t)iv : (uintmax_t)iv;
+            sz[n++]       = c.end[-1] == 'c' ? 1 : clog_rec_digits_(mag, iv < 0);
+        }
+    }
+}
+
+/* find or add the site; returns NULL when the table is full (entry 'S' written on first sight) */
+static clog_rec_site_ *clog_rec_site_of_(const char *file, int line, const char *group, const char *fmt) {
+    uintptr_t h = ((uintptr_t)fmt ^ ((uintptr_t)file * 31u) ^ (uintptr_t)group) * 0x9E3779B1u + (uintptr_t)line;
+    for (unsigned i = 0; i < CLOG_RECORD_SITES; i++) {
+        clog_rec_site_ *e = &g_rec_sites[(h + i) & (CLOG_RECORD_SITES - 1)];
+        if (e->file == file && e->line == line && e->fmt == fmt && e->group == group) return e;
+        if (e->file) continue;
+        if (g_rec_nsites * 4 >= CLOG_RECORD_SITES * 3) return NULL; /* keep probes short */
+        char cls[CLOG_REC_ARGS_];
+        int  n   = clog_rec_classes_(fmt, cls);
+        e->file  = file;
+        e->line  = line;
+        e->group = group;
+        e->fmt   = fmt;
+        e->id    = (uint16_t)g_rec_nsites++;
+        e->nargs = (unsigned char)(n < 0 ? 0xff : n);
+
+        int32_t ln = (int32_t)line;
+        clog_rec_put_("S", 1);
+        clog_rec_put_(&e->id, sizeof e->id);
+        clog_rec_put_(&ln, sizeof ln);
+        clog_rec_put_str_(file);
+        clog_rec_put_str_(group);
+        clog_rec_put_str_(fmt);
+        clog_rec_put_(&e->nargs, 1);
+        if (n > 0) clog_rec_put_(cls, (size_t)n);
+        return e;
+    }
+    return NULL;
+}
+
+static void clog_rec_note_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap, bool emitted
+) {
+    uint64_t now = clog_now_ns_mono_();
+    uint16_t sz[CLOG_REC_ARGS_];
+    clog_lock_();
+    clog_rec_site_ *e = g_rec_on_load() ? clog_rec_site_of_(file, line, group, fmt) : NULL;
+    if (!e) {
+        if (g_rec_on_load()) ++g_rec_dropped;
+        clog_unlock_();
+        return;
+    }
+    if (g_rec_thr_session != g_rec_session) {
+        g_rec_thr_session = g_rec_session;
+        g_rec_thr         = (unsigned char)(g_rec_threads < 255 ? g_rec_threads++ : 255);
+        g_rec_last_ns     = now;
+    }
+    uint64_t dt   = now - g_rec_last_ns;
+    g_rec_last_ns = now;
+
+    va_list ap2;
+    va_copy(ap2, ap);
+    size_t nsz = 1;
+    if (e->nargs == 0xff) {
+#        if defined(__GNUC__) || defined(__clang__)
+#            pragma GCC diagnostic push
+#            pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#        endif
+        int len = vsnprintf(NULL, 0, fmt, ap2);
+#        if defined(__GNUC__) || defined(__clang__)
+#            pragma GCC diagnostic pop
+#        endif
+        sz[0] = (uint16_t)(len < 0 ? 0 : len < 0xffff ? len : 0xffff);
+    } else {
+        clog_rec_sizes_(fmt, ap2, sz);
+        nsz = e->nargs;
+    }
+    va_end(ap2);
+
+    unsigned char hdr[6] = {'R', 0, 0, (unsigned char)lvl, g_rec_thr, emitted ? 1 : 0};
+    uint32_t      d32    = dt > 0xffffffffu ? 0xffffffffu : (uint32_t)dt;
+    memcpy(hdr + 1, &e->id, sizeof e->id);
+    clog_rec_put_(hdr, sizeof hdr);
+    clog_rec_put_(&d32, sizeof d32);
+    clog_rec_put_(sz, nsz * sizeof sz[0]);
+    clog_unlock_();
+}
+
+int clog_record_start(int fd) {
+    if (fd < 0) return -1;
+    clog_lock_();
+    if (g_rec_on_load()) {
+        clog_unlock_();
+        return -1;
+    }
+    memset(g_rec_sites, 0, sizeof g_rec_sites);
+    g_rec_nsites = g_rec_dropped = g_rec_threads = 0;
+    g_rec_len                                    = 0;
+    g_rec_fd                                     = fd;
+    ++g_rec_session;
+    clog_rec_put_("CLOGREC1", 8);
+    ++g_gate_want[CLOG_LVL_TRACE]; /* suppressed calls must reach the recorder too */
+    clog_gate_refresh_();
+    g_rec_on_store(1);
+    clog_unlock_();
+    return 0;
+}
+
+unsigned clog_record_stop(void) {
+    clog_lock_();
+    unsigned dropped = 0;
+    if (g_rec_on_load()) {
+        g_rec_on_store(0);
+        --g_gate_want[CLOG_LVL_TRACE];
+        clog_gate_refresh_();
+        clog_rec_flush_();
+        g_rec_fd = -1;
+        dropped  = g_rec_dropped;
+    }
+    clog_unlock_();
+    return dropped;
+}
+
+static inline void clog_rec_maybe_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap, bool emitted
+) {
+    if (CLOG_UNLIKELY(g_rec_on_load())) clog_rec_note_(lvl, file, line, group, fmt, ap, emitted);
+}
+#    else
+int clog_record_start(int fd) {
+    (void)fd;
+    return -1;
+}
+unsigned clog_record_stop(void) { return 0; }
+static inline void clog_rec_maybe_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap, bool emitted
+) {
+    (void)lvl;
+    (void)file;
+    (void)line;
+    (void)group;
+    (void)fmt;
+    (void)ap;
+    (void)emitted;
+}
+#    endif
+
+// filter expressions (clog_set_filter): a postfix program over call-site metadata, swapped under the write lock
+#    if CLOG_FILTER_OPS > 0
+enum { CLOG_FOP_PRED_, CLOG_FOP_AND_, CLOG_FOP_OR_, CLOG_FOP_NOT_ };
+enum { CLOG_FF_LEVEL_, CLOG_FF_LINE_, CLOG_FF_FILE_, CLOG_FF_GROUP_ };
+enum { CLOG_FC_EQ_, CLOG_FC_NE_, CLOG_FC_LT_, CLOG_FC_LE_, CLOG_FC_GT_, CLOG_FC_GE_, CLOG_FC_GLOB_ };
+typedef struct {
+    unsigned char op, field, cmp;
+    int           arg; /* level or line number, or the offset of the pattern in str */
+} clog_fop_;
+typedef struct {
+    clog_fop_ ops[CLOG_FILTER_OPS];
+    int       n_ops;
+    int       min_lvl; /* lowest level the program can admit; CLOG_LVL_NONE_ if none */
+    size_t    n_str;
+    char      str[CLOG_FILTER_STR];
+} clog_filter_;
+typedef struct {
+    const char   *p;
+    clog_filter_ *f;
+    bool          err;
+} clog_fparse_;
+
+CLOG_STATE_INT(g_filter_gen, 0) /* generation of the installed filter; 0 => none */
+static int g_filter_seq = 0;
+
+/* Two slots; g_filter_cur points at the installed one (NULL => none). Readers pin it with its count and evaluate
+   without the lock; clog_set_filter (under the lock) refills the other slot once its last reader has left. */
+typedef struct {
+    clog_filter_ f;
+    int          gen;
+    int          readers;
+} clog_fslot_;
+static clog_fslot_  g_filter_slot[2];
+static clog_fslot_ *g_filter_cur = NULL;
+
+/* Site memo: (generation << 4 | lvl << 1 | pass) for the group in filt_group, -1 while a thread rewrites the pair.
+   A writer claims the memo it read by CAS before storing the group (release); a reader takes the verdict only if
+   the memo is unchanged after loading the group (acquire), so a group it sees comes with that group's memo. */
+#        if defined(__GNUC__) || defined(__clang__)
+#            ifdef _WIN32
+#                define CLOG_FILTER_YIELD_() SwitchToThread()
+#            else
+#                include <sched.h> /* sched_yield */
+#                define CLOG_FILTER_YIELD_() sched_yield()
+#            endif
+#            define CLOG_FMEMO_LOAD_(s)         __atomic_load_n(&(s)->filt, __ATOMIC_ACQUIRE)
+#            define CLOG_FMEMO_RECHECK_(s)      __atomic_load_n(&(s)->filt, __ATOMIC_RELAXED)
+#            define CLOG_FMEMO_CLAIM_(s, m)     clog_fmemo_claim_(&(s)->filt, (m))
+#            define CLOG_FMEMO_GROUP_(s)        __atomic_load_n(&(s)->filt_group, __ATOMIC_ACQUIRE)
+#            define CLOG_FMEMO_SET_GROUP_(s, g) __atomic_store_n(&(s)->filt_group, (g), __ATOMIC_RELEASE)
+#            define CLOG_FMEMO_PUBLISH_(s, v)   __atomic_store_n(&(s)->filt, (v), __ATOMIC_RELEASE)
+static inline bool clog_fmemo_claim_(int *filt, int m) {
+    return __atomic_compare_exchange_n(filt, &m, -1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static clog_fslot_ *clog_filter_pin_(void) {
+    for (;;) {
+        clog_fslot_ *fs = __atomic_load_n(&g_filter_cur, __ATOMIC_SEQ_CST);
+        if (!fs) return NULL;
+        __atomic_add_fetch(&fs->readers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&g_filter_cur, __ATOMIC_SEQ_CST) == fs) return fs;
+        __atomic_sub_fetch(&fs->readers, 1, __ATOMIC_RELEASE); /* replaced meanwhile: it may be refilled */
+    }
+}
+static inline void clog_filter_unpin_(clog_fslot_ *fs) { __atomic_sub_fetch(&fs->readers, 1, __ATOMIC_RELEASE); }
+
+/* lock held: the slot is not installed, so only readers that pinned it earlier can still be inside */
+static void clog_filter_drain_(clog_fslot_ *fs) {
+    while (__atomic_load_n(&fs->readers, __ATOMIC_SEQ_CST)) CLOG_FILTER_YIELD_();
+}
+static inline void clog_filter_publish_(clog_fslot_ *fs) { __atomic_store_n(&g_filter_cur, fs, __ATOMIC_SEQ_CST); }
+#        else
+/* no builtins: readers evaluate under the write lock, which also makes the memo updates plain */
+#            define CLOG_FMEMO_LOAD_(s)         (*(volatile int *)&(s)->filt)
+#            define CLOG_FMEMO_RECHECK_(s)      CLOG_FMEMO_LOAD_(s)
+#            define CLOG_FMEMO_CLAIM_(s, m)     (CLOG_FMEMO_LOAD_(s) == (m) ? (CLOG_FMEMO_LOAD_(s) = -1, true) : false)
+#            define CLOG_FMEMO_GROUP_(s)        (*(const char *volatile *)&(s)->filt_group)
+#            define CLOG_FMEMO_SET_GROUP_(s, g) (CLOG_FMEMO_GROUP_(s) = (g))
+#            define CLOG_FMEMO_PUBLISH_(s, v)   (CLOG_FMEMO_LOAD_(s) = (v))
+static clog_fslot_ *clog_filter_pin_(void) {
+    clog_lock_();
+    clog_fslot_ *fs = g_filter_cur;
+    if (!fs) clog_unlock_();
+    return fs;
+}
+static inline void clog_filter_unpin_(clog_fslot_ *fs) {
+    (void)fs;
+    clog_unlock_();
+}
+static inline void clog_filter_drain_(clog_fslot_ *fs) { (void)fs; }
+static inline void clog_filter_publish_(clog_fslot_ *fs) { g_filter_cur = fs; }
+#        endif
+
+static bool clog_glob_match_(const char *pat, const char *s, size_t n);
+
+static bool clog_fp_eat_(clog_fparse_ *ps, const char *tok) {
+    while (*ps->p == ' ' || *ps->p == '\t') ++ps->p;
+    size_t n = strlen(tok);
+    if (strncmp(ps->p, tok, n) != 0) return false;
+    ps->p += n;
+    return true;
+}
+
+static void clog_fp_op_(clog_fparse_ *ps, int op, int field, int cmp, int arg) {
+    if (ps->f->n_ops == CLOG_FILTER_OPS) {
+        ps->err = true;
+        return;
+    }
+    clog_fop_ *o = &ps->f->ops[ps->f->n_ops++];
+    o->op        = (unsigned char)op;
+    o->field     = (unsigned char)field;
+    o->cmp       = (unsigned char)cmp;
+    o->arg       = arg;
+}
+
+/* "quoted" or a bare word; returns its length, value at *v */
+static size_t clog_fp_value_(clog_fparse_ *ps, const char **v) {
+    while (*ps->p == ' ' || *ps->p == '\t') ++ps->p;
+    const char *s = ps->p;
+    size_t      n = 0;
+    if (*s == '"') {
+        const char *q = strchr(++s, '"');
+        if (!q) return 0;
+        n     = (size_t)(q - s);
+        ps->p = q + 1;
+    } else {
+        while (s[n] && !strchr(" \t()&|!=<>~\"", s[n])) ++n;
+        ps->p = s + n;
+    }
+    *v = s;
+    return n;
+}
+
+static void clog_fp_pred_(clog_fparse_ *ps) {
+    static const char *const fields[] = {"level", "line", "file", "group"};
+    static const char *const cmps[]   = {"==", "!=", "<=", ">=", "<", ">", "=", "~"};
+    static const int         cmp_of[] = {CLOG_FC_EQ_, CLOG_FC_NE_, CLOG_FC_LE_, CLOG_FC_GE_,
+                                         CLOG_FC_LT_, CLOG_FC_GT_, CLOG_FC_EQ_, CLOG_FC_GLOB_};
+    int                      field = -1, cmp = -1;
+    for (int i = 0; i < 4 && field < 0; i++)
+        if (clog_fp_eat_(ps, fields[i])) field = i;
+    for (int i = 0; i < 8 && field >= 0 && cmp < 0; i++)
+        if (clog_fp_eat_(ps, cmps[i])) cmp = cmp_of[i];
+    const char *v;
+    size_t      n = cmp < 0 ? 0 : clog_fp_value_(ps, &v);
+    if (!n) {
+        ps->err = true;
+        return;
+    }
+
+    int arg = 0;
+    if (field == CLOG_FF_FILE_ || field == CLOG_FF_GROUP_) {
+        if (cmp != CLOG_FC_EQ_ && cmp != CLOG_FC_NE_ && cmp != CLOG_FC_GLOB_) ps->err = true;
+        if (ps->f->n_str + n + 1 > CLOG_FILTER_STR) ps->err = true;
+        if (ps->err) return;
+        arg = (int)ps->f->n_str;
+        memcpy(ps->f->str + ps->f->n_str, v, n);
+        ps->f->str[ps->f->n_str + n] = '\0';
+        ps->f->n_str += n + 1;
+    } else if (cmp == CLOG_FC_GLOB_) {
+        ps->err = true;
+        return;
+    } else if (*v >= '0' && *v <= '9') {
+        for (size_t i = 0; i < n && !ps->err; i++) {
+            if (v[i] < '0' || v[i] > '9' || arg > 99999999) ps->err = true;
+            arg = arg * 10 + (v[i] - '0');
+        }
+        if (field == CLOG_FF_LEVEL_ && arg > CLOG_LVL_FATAL) ps->err = true;
+    } else if (field == CLOG_FF_LEVEL_) {
+        arg = -1;
+        for (int l = CLOG_LVL_TRACE; l <= CLOG_LVL_FATAL && arg < 0; l++) {
+            const char *name = clog_level_name_((clog_level)l);
+            size_t      i    = 0;
+            while (i < n && name[i] && (v[i] == name[i] || v[i] == name[i] + ('a' - 'A'))) ++i;
+            if (i == n && !name[i]) arg = l;
+        }
+        if (arg < 0) ps->err = true;
+    } else {
+        ps->err = true;
+    }
+    if (!ps->err) clog_fp_op_(ps, CLOG_FOP_PRED_, field, cmp, arg);
+}
+
+static void clog_fp_or_(clog_fparse_ *ps);
+
+static void clog_fp_unary_(clog_fparse_ *ps) {
+    if (clog_fp_eat_(ps, "!")) {
+        clog_fp_unary_(ps);
+        clog_fp_op_(ps, CLOG_FOP_NOT_, 0, 0, 0);
+    } else if (clog_fp_eat_(ps, "(")) {
+        clog_fp_or_(ps);
+        if (!ps->err && !clog_fp_eat_(ps, ")")) ps->err = true;
+    } else {
+        clog_fp_pred_(ps);
+    }
+}
+
+static void clog_fp_and_(clog_fparse_ *ps) {
+    clog_fp_unary_(ps);
+    while (!ps->err && clog_fp_eat_(ps, "&&")) {
+        clog_fp_unary_(ps);
+        clog_fp_op_(ps, CLOG_FOP_AND_, 0, 0, 0);
+    }
+}
+
+static void clog_fp_or_(clog_fparse_ *ps) {
+    clog_fp_and_(ps);
+    while (!ps->err && clog_fp_eat_(ps, "||")) {
+        clog_fp_and_(ps);
+        clog_fp_op_(ps, CLOG_FOP_OR_, 0, 0, 0);
+    }
+}
+
+/* 0 false, 1 true, 2 unknown: file == NULL leaves everything but the level open */
+static int clog_fpred_(
+    const clog_filter_ *f, const clog_fop_ *o, int lvl, const char *file, int line, const char *group
+) {
+    if (o->field == CLOG_FF_LEVEL_ || o->field == CLOG_FF_LINE_) {
+        if (o->field == CLOG_FF_LINE_ && !file) return 2;
+        int v = o->field == CLOG_FF_LEVEL_ ? lvl : line;
+        switch (o->cmp) {
+            case CLOG_FC_EQ_: return v == o->arg;
+            case CLOG_FC_NE_: return v != o->arg;
+            case CLOG_FC_LT_: return v < o->arg;
+            case CLOG_FC_LE_: return v <= o->arg;
+            case CLOG_FC_GT_: return v > o->arg;
+            default: return v >= o->arg;
+        }
+    }
+    if (!file) return 2;
+    const char *s   = o->field == CLOG_FF_FILE_ ? clog_basename_(file) : group ? group : "";
+    const char *pat = f->str + o->arg;
+    bool        m   = o->cmp == CLOG_FC_GLOB_ ? clog_glob_match_(pat, s, strlen(s)) : strcmp(pat, s) == 0;
+    return o->cmp == CLOG_FC_NE_ ? !m : m;
+}
+
+static int clog_filter_eval_(const clog_filter_ *f, int lvl, const char *file, int line, const char *group) {
+    unsigned char st[CLOG_FILTER_OPS];
+    int           sp = 0;
+    for (int i = 0; i < f->n_ops; i++) {
+        const clog_fop_ *o = &f->ops[i];
+        if (o->op == CLOG_FOP_PRED_) {
+            st[sp++] = (unsigned char)clog_fpred_(f, o, lvl, file, line, group);
+        } else if (o->op == CLOG_FOP_NOT_) {
+            st[sp - 1] = st[sp - 1] == 2 ? 2 : !st[sp - 1];
+        } else {
+            int b = st[--sp], a = st[sp - 1], dom = o->op == CLOG_FOP_AND_ ? 0 : 1;
+            st[sp - 1] = (unsigned char)(a == dom || b == dom ? dom : a == 2 || b == 2 ? 2 : !dom);
+        }
+    }
+    return st[0];
+}
+
+int clog_set_filter(const char *expr) {
+    clog_filter_ f;
+    f.n_ops = 0;
+    f.n_str = 0;
+    if (expr && *expr) {
+        clog_fparse_ ps = {expr, &f, false};
+        clog_fp_or_(&ps);
+        (void)clog_fp_eat_(&ps, ""); /* trailing blanks */
+        if (ps.err || *ps.p) return -1;
+        f.min_lvl = CLOG_LVL_NONE_;
+        for (int l = CLOG_LVL_TRACE; l <= CLOG_LVL_FATAL && f.min_lvl == CLOG_LVL_NONE_; l++)
+            if (clog_filter_eval_(&f, l, NULL, 0, NULL)) f.min_lvl = l;
+    }
+
+    clog_lock_();
+    if (g_filter_cur && g_filter_cur->f.min_lvl != CLOG_LVL_NONE_) --g_gate_want[g_filter_cur->f.min_lvl];
+    if (f.n_ops) {
+        clog_fslot_ *fs = &g_filter_slot[g_filter_cur == &g_filter_slot[0]];
+        clog_filter_drain_(fs);
+        memcpy(&fs->f, &f, sizeof f);
+        if (f.min_lvl != CLOG_LVL_NONE_) ++g_gate_want[f.min_lvl];
+        g_filter_seq = g_filter_seq == 0x7ffffff ? 1 : g_filter_seq + 1;
+        fs->gen      = g_filter_seq;
+        clog_filter_publish_(fs);
+        g_filter_gen_store(g_filter_seq);
+    } else {
+        clog_filter_publish_(NULL);
+        g_filter_gen_store(0);
+    }
+    clog_gate_refresh_();
+    clog_unlock_();
+    return 0;
+}
+
+/* Sites keep the verdict for the current generation, level and group; misses and siteless calls (block_begin,
+   CLOG_PREFIX_CACHE=0) evaluate the pinned filter without taking the write lock. */
+static bool clog_filter_pass_(clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group) {
+    int m = site ? CLOG_FMEMO_LOAD_(site) : -1;
+    if (m >= 0 && m >> 4 == g_filter_gen_load() && (m >> 1 & 7) == (int)lvl && CLOG_FMEMO_GROUP_(site) == group &&
+        CLOG_FMEMO_RECHECK_(site) == m)
+        return m & 1;
+    clog_fslot_ *fs = clog_filter_pin_();
+    if (!fs) return false;
+    bool ok = clog_filter_eval_(&fs->f, (int)lvl, file ? file : "", line, group) == 1;
+    if (site && m >= 0 && CLOG_FMEMO_CLAIM_(site, m)) {
+        CLOG_FMEMO_SET_GROUP_(site, group);
+        CLOG_FMEMO_PUBLISH_(site, fs->gen << 4 | (int)lvl << 1 | ok);
+    }
+    clog_filter_unpin_(fs);
+    return ok;
+}
+#    else
+CLOG_STATE_INT(g_filter_gen, 0)
+int clog_set_filter(const char *expr) { return expr && *expr ? -1 : 0; }
+static inline bool clog_filter_pass_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group
+) {
+    (void)site;
+    (void)lvl;
+    (void)file;
+    (void)line;
+    (void)group;
+    return false;
+}
+#    endif
+
+/* below the level threshold and not admitted by the filter */
+static inline bool clog_suppressed_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group
+) {
+    return (int)lvl < clog_eff_lvl_() &&
+           !(CLOG_UNLIKELY(g_filter_gen_load()) && clog_filter_pass_(site, lvl, file, line, group));
+}
+
+static inline void clog_emit_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap
+) {
+    if (clog_suppressed_(site, lvl, file, line, group)) {
+        if (g_cap_on && (int)lvl >= CLOG_CAPTURE_LEVEL) clog_capture_push_(lvl, file, line, group, fmt, ap);
+        clog_stats_note_(file, line, 0, true);
+        clog_rec_maybe_(lvl, file, line, group, fmt, ap, false);
+        return;
+    }
+    if (CLOG_UNLIKELY((int)lvl < g_shed_load())) {
+        clog_shed_count_(lvl);
+        clog_stats_note_(file, line, 0, true);
+        clog_rec_maybe_(lvl, file, line, group, fmt, ap, false);
+        return;
+    }
+
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load()) && clog_in_sink_()) return;
+
+    int    fd = clog_fd_load_();
+    size_t pl, off = clog_format_record_(g_buf, CLOG_LINE_MAX, site, lvl, file, line, group, fmt, ap, &pl);
+    clog_stats_note_(file, line, clog_flush_line_(fd, g_buf, off, lvl, g_prefix_ns, file, line, group, pl), false);
+    clog_rec_maybe_(lvl, file, line, group, fmt, ap, true);
+    clog_sync_if_fatal_(fd, lvl);
+    if (CLOG_UNLIKELY(g_ctr_interval_ms_load() > 0)) clog_counters_tick_(file, line);
+}
+
+// blocks (per-thread accumulation, one locked write per block)
+#    if CLOG_BLOCK_MAX < CLOG_LINE_MAX
+#        error "CLOG_BLOCK_MAX must be >= CLOG_LINE_MAX"
+#    endif
+static CLOG_THREADLOCAL char        g_block[CLOG_BLOCK_MAX];
+static CLOG_THREADLOCAL size_t      g_block_len   = 0;
+static CLOG_THREADLOCAL int         g_block_lvl   = -1; /* -1 => no block open or block filtered out */
+static CLOG_THREADLOCAL const char *g_block_group = NULL;
+
+static void clog_block_flush_(void) {
+    if (!g_block_len) return;
+    clog_write_locked_(clog_fd_load_(), g_block, g_block_len);
+    g_block_len = 0;
+}
+
+void clog_block_begin_(clog_level lvl, const char *file, int line, const char *group) {
+    if (g_block_lvl >= 0) clog_block_end();
+    g_block_lvl   = clog_suppressed_(NULL, lvl, file, line, group) ? -1 : (int)lvl;
+    g_block_group = group;
+    g_block_len   = 0;
+}
+
+void clog_block_line_(const char *file, int line, const char *fmt, ...) {
+    if (g_block_lvl < 0) return;
+    if (CLOG_BLOCK_MAX - g_block_len < CLOG_LINE_MAX) clog_block_flush_();
+
+    char   *dst = g_block + g_block_len;
+    size_t  pl;
+    va_list ap;
+    va_start(ap, fmt);
+    size_t off =
+        clog_format_record_(dst, CLOG_LINE_MAX, NULL, (clog_level)g_block_lvl, file, line, g_block_group, fmt, ap, &pl);
+    va_end(ap);
+    size_t n = clog_terminate_line_(dst, off, CLOG_LINE_MAX);
+    g_block_len += n;
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load()) && !clog_in_sink_()) {
+        clog_record r;
+        clog_record_view_(&r, (clog_level)g_block_lvl, g_prefix_ns, file, line, g_block_group, dst, pl, n);
+        clog_lock_();
+        clog_sinks_call_(&r);
+        clog_unlock_();
+    }
+    clog_stats_note_(file, line, n, false);
+}
+
+void clog_block_end(void) {
+    if (g_block_lvl < 0) return;
+    int fd = clog_fd_load_();
+    clog_block_flush_();
+    clog_sync_if_fatal_(fd, (clog_level)g_block_lvl);
+    g_block_lvl = -1;
+}
+
+void clog_capture_begin(void) {
+    if (g_cap_on) return;
+    g_cap_len     = 0;
+    g_cap_dropped = 0;
+    g_cap_on      = true;
+    clog_lock_();
+    ++g_gate_want[CLOG_CAPTURE_LEVEL];
+    clog_gate_refresh_();
+    clog_thread_exit_arm_();
+    clog_unlock_();
+}
+
+static void clog_capture_end_(void) {
+    g_cap_on  = false;
+    g_cap_len = 0;
+    clog_lock_();
+    --g_gate_want[CLOG_CAPTURE_LEVEL];
+    clog_gate_refresh_();
+    clog_unlock_();
+}
+
+void clog_capture_discard(void) {
+    if (g_cap_on) clog_capture_end_();
+}
+
+/* The records go out under one hold of the write lock, so no other thread's line lands between them. */
+void clog_capture_commit(void) {
+    if (!g_cap_on) return;
+    int      fd = clog_fd_load_();
+    uint64_t t0 = g_shed_high_ns_load() ? clog_now_ns_mono_() : 0;
+    (void)clog_stats_tab_get_(); /* claiming takes the lock: do it before holding it */
+    clog_lock_();
+    for (size_t off = 0; off < g_cap_len;) {
+        clog_cap_rec_ r;
+        memcpy(&r, g_cap + off, sizeof r);
+        const unsigned char *payload = g_cap + off + sizeof r;
+        off += r.size;
+
+        clog_tm_ t;
+        clog_wall_parts_(r.wall_ns, &t.Y, &t.m, &t.d, &t.H, &t.M, &t.S, &t.ms);
+        size_t n  = clog_write_prefix_tm_(g_buf, CLOG_LINE_MAX, &t, (clog_level)r.lvl, r.file, r.line, r.group);
+        size_t pl = n;
+        bool   clipped = r.truncated;
+        if (n < CLOG_LINE_MAX) {
+            if (r.deferred) {
+                n += clog_cap_render_(g_buf + n, CLOG_LINE_MAX - n, r.fmt, payload, &clipped);
+            } else {
+                size_t k = strlen((const char *)payload);
+                if (k > CLOG_LINE_MAX - 1 - n) {
+                    k       = CLOG_LINE_MAX - 1 - n;
+                    clipped = true;
+                }
+                memcpy(g_buf + n, payload, k);
+                n += k;
+            }
+        }
+        if (clipped) {
+            if (n + 5 < CLOG_LINE_MAX) {
+                memcpy(g_buf + n, "...", 3);
+                n += 3;
+            } else {
+                n = clog_mark_truncated_(g_buf, CLOG_LINE_MAX);
+            }
+        }
+        n = clog_terminate_line_(g_buf, n, CLOG_LINE_MAX);
+
+        clog_iov_ iov;
+        iov.iov_base = g_buf;
+        iov.iov_len  = n;
+        clog_writev_held_(fd, &iov, 1);
+        if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load())) {
+            clog_record rec;
+            clog_record_view_(&rec, (clog_level)r.lvl, r.wall_ns, r.file, r.line, r.group, g_buf, pl, n);
+            clog_sinks_call_(&rec);
+        }
+        clog_stats_note_(r.file, r.line, n, false);
+    }
+    if (g_cap_dropped) {
+        int k = snprintf(g_buf, CLOG_LINE_MAX, "=== capture: %u record(s) dropped (CLOG_CAPTURE_MAX=%d) ===",
+                         g_cap_dropped, CLOG_CAPTURE_MAX);
+        clog_iov_ iov;
+        iov.iov_base = g_buf;
+        iov.iov_len  = clog_terminate_line_(g_buf, clog_snlen_(k, CLOG_LINE_MAX), CLOG_LINE_MAX);
+        clog_writev_held_(fd, &iov, 1);
+    }
+    if (t0) {
+        uint64_t now = clog_now_ns_mono_();
+        clog_shed_account_(fd, now - t0, now);
+    }
+    clog_unlock_();
+    clog_capture_end_();
+}
+
+void clog_set_index_fd(int fd, unsigned every_records) {
+    clog_lock_();
+    if (fd >= 0 && clog_fd_seek_(fd, 0, SEEK_END) == 0) {
+        char hdr[CLOG_INDEX_HDR_] = CLOG_INDEX_MAGIC_;
+        (void)clog_write_all_(fd, hdr, sizeof hdr);
+    }
+    g_index_fd     = fd;
+    g_index_every  = every_records;
+    g_index_count  = 0;
+    g_index_log_fd = -1;
+    clog_unlock_();
+}
+
+static bool clog_index_read_(int fd, int64_t idx, uint64_t e[2]) {
+    int64_t off = CLOG_INDEX_HDR_ + idx * 16;
+#    if defined(_WIN32)
+    if (clog_fd_seek_(fd, off, SEEK_SET) != off) return false;
+    return _read(fd, e, 16) == 16;
+#    else
+    return pread(fd, e, 16, (off_t)off) == 16;
+#    endif
+}
+
+int64_t clog_index_seek(int index_fd, uint64_t wall_ns) {
+    char    hdr[CLOG_INDEX_HDR_];
+    int64_t size = clog_fd_seek_(index_fd, 0, SEEK_END);
+    if (size < CLOG_INDEX_HDR_) return -1;
+#    if defined(_WIN32)
+    if (clog_fd_seek_(index_fd, 0, SEEK_SET) != 0 || _read(index_fd, hdr, sizeof hdr) != (int)sizeof hdr) return -1;
+#    else
+    if (pread(index_fd, hdr, sizeof hdr, 0) != (ssize_t)sizeof hdr) return -1;
+#    endif
+    if (memcmp(hdr, CLOG_INDEX_MAGIC_, 8) != 0) return -1;
+
+    /* last entry with t <= wall_ns: every record before its offset was stamped no later than t */
+    int64_t  lo = 0, hi = (size - CLOG_INDEX_HDR_) / 16, best = 0;
+    uint64_t e[2];
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (!clog_index_read_(index_fd, mid, e)) return -1;
+        if (e[0] <= wall_ns) {
+            best = (int64_t)e[1];
+            lo   = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return best;
+}
+
+#    if CLOG_STATS_THREADS > 0
+/* merged view for dumps; guarded by the write lock */
+static clog_site_stats_ g_stats_agg[CLOG_STATS_SITES * 2];
+
+static int clog_stats_cmp_(const void *a, const void *b) {
+    const clog_site_stats_ *x = (const clog_site_stats_ *)a, *y = (const clog_site_stats_ *)b;
+    if (x->bytes != y->bytes) return x->bytes < y->bytes ? 1 : -1;
+    if (x->records != y->records) return x->records < y->records ? 1 : -1;
+    return x->suppressed < y->suppressed ? 1 : x->suppressed > y->suppressed ? -1 : 0;
+}
+
+/* while on, the inline gate is held at TRACE so suppressed calls reach the front-end and are counted */
+void clog_stats_enable(bool on) {
+    clog_lock_();
+    if (on != (g_stats_on_load() != 0)) {
+        g_gate_want[CLOG_LVL_TRACE] += on ? 1 : -1;
+        clog_gate_refresh_();
+        g_stats_on_store(on ? 1 : 0);
+    }
+    clog_unlock_();
+}
+
+void clog_stats_dump(int top_n) {
+    int    fd = clog_fd_load_();
+    size_t n = 0, lost = 0;
+    int    tabs = g_stats_claimed_load();
+    if (tabs > CLOG_STATS_THREADS) tabs = CLOG_STATS_THREADS;
+
+    clog_lock_();
+    for (int t = 0; t < tabs; t++) {
+        lost += (size_t)g_stats[t].overflow;
+        for (int i = 0; i < CLOG_STATS_SITES; i++) {
+            const clog_site_stats_ *e = &g_stats[t].sites[i];
+            if (!e->file) continue;
+            /* same file:line can come from different TUs (headers), so merge by name */
+            size_t k = 0;
+            for (; k < n; k++)
+                if (g_stats_agg[k].line == e->line && strcmp(g_stats_agg[k].file, e->file) == 0) break;
+            if (k == n) {
+                if (n == sizeof g_stats_agg / sizeof g_stats_agg[0]) {
+                    lost += (size_t)e->records;
+                    continue;
+                }
+                memset(&g_stats_agg[n], 0, sizeof g_stats_agg[n]);
+                g_stats_agg[n].file = e->file;
+                g_stats_agg[n].line = e->line;
+                ++n;
+            }
+            g_stats_agg[k].records += e->records;
+            g_stats_agg[k].bytes += e->bytes;
+            g_stats_agg[k].suppressed += e->suppressed;
+        }
+    }
+    qsort(g_stats_agg, n, sizeof g_stats_agg[0], clog_stats_cmp_);
+
+    clog_dump_printf_(fd, "=== top talkers: %zu site(s), %d thread table(s) ===\n%12s %14s %12s  site\n", n, tabs,
+                      "records", "bytes", "suppressed");
+    for (size_t k = 0; k < n && (top_n <= 0 || k < (size_t)top_n); k++) {
+        const clog_site_stats_ *e = &g_stats_agg[k];
+        clog_dump_printf_(fd, "%12llu %14llu %12llu  %s:%d\n", (unsigned long long)e->records,
+                          (unsigned long long)e->bytes, (unsigned long long)e->suppressed, clog_basename_(e->file),
+                          e->line);
+    }
+    if (lost || g_stats_no_table_load())
+        clog_dump_printf_(fd, "(untracked: %zu record(s) past table limits, %d thread(s) without a table)\n", lost,
+                          g_stats_no_table_load());
+    clog_unlock_();
+}
+
+static int  g_stats_exit_top = 0;
+static void clog_stats_atexit_(void) { clog_stats_dump(g_stats_exit_top); }
+void        clog_stats_dump_at_exit(int top_n) {
+    static bool registered = false;
+    g_stats_exit_top       = top_n;
+    if (!registered) registered = atexit(clog_stats_atexit_) == 0;
+}
+#    else
+void clog_stats_enable(bool on) { (void)on; }
+void clog_stats_dump(int top_n) { (void)top_n; }
+void clog_stats_dump_at_exit(int top_n) { (void)top_n; }
 #    endif
+
+// lock instrumentation: a fixed pool of per-thread label tables, like the call-site stats above. Durations go
+// into log2 buckets (bucket b holds [2^b, 2^(b+1)) ns; the last one everything above ~2 s).
+#    if CLOG_LOCKSTAT_THREADS > 0
+#        if CLOG_LOCKSTAT_LABELS & (CLOG_LOCKSTAT_LABELS - 1)
+#            error "CLOG_LOCKSTAT_LABELS must be a power of two"
+#        endif
+#        define CLOG_LOCK_BUCKETS_ 32
+typedef struct {
+    const char *label; /* NULL => free slot */
+    uint64_t    acquires, wait_ns, hold_ns, wait_max, hold_max, held_since;
+    uint32_t    wait_hist[CLOG_LOCK_BUCKETS_], hold_hist[CLOG_LOCK_BUCKETS_];
+} clog_lock_stats_;
+
+typedef struct {
+    clog_lock_stats_ labels[CLOG_LOCKSTAT_LABELS];
+    uint64_t         overflow; /* acquisitions whose label didn't fit */
+} clog_lock_tab_;
+
+static clog_lock_tab_                   g_locks[CLOG_LOCKSTAT_THREADS];
+static bool                             g_locks_owned[CLOG_LOCKSTAT_THREADS]; /* guarded by the write lock */
+static CLOG_THREADLOCAL clog_lock_tab_ *g_lock_tab = NULL;
+static CLOG_THREADLOCAL bool            g_lock_no_slot = false;
+CLOG_STATE_INT(g_locks_claimed, 0) /* tables ever handed out; dumps merge [0, claimed) */
+CLOG_STATE_INT(g_locks_no_table, 0) /* threads that found every table taken */
+CLOG_STATE_U64(g_lock_wait_out, CLOG_LOCKSTAT_WAIT_NS)
+CLOG_STATE_U64(g_lock_hold_out, CLOG_LOCKSTAT_HOLD_NS)
+
+static inline unsigned clog_lock_bucket_(uint64_t ns) {
+    unsigned b = 0;
+    while (ns > 1 && b < CLOG_LOCK_BUCKETS_ - 1) {
+        ns >>= 1;
+        ++b;
+    }
+    return b;
 }
 
-static inline void clog_write_line_raw_(const char *s) {
-    int    fd  = clog_fd_load_();
-    char  *buf = g_buf;  // reuse per-thread buffer
-    size_t cap = CLOG_LINE_MAX;
+/* this thread's table, claimed on its first lock (takes the write lock). As with the call-site stats, a table whose
+   owner exited goes to the next thread with its counts kept: the dump merges by label anyway. */
+static clog_lock_tab_ *clog_lock_tab_get_(void) {
+    if (g_lock_tab || g_lock_no_slot) return g_lock_tab;
+    clog_lock_();
+    int idx = 0;
+    while (idx < CLOG_LOCKSTAT_THREADS && g_locks_owned[idx]) ++idx;
+    if (idx < CLOG_LOCKSTAT_THREADS) {
+        g_locks_owned[idx] = true;
+        if (idx >= g_locks_claimed_load()) g_locks_claimed_store(idx + 1);
+        g_lock_tab = &g_locks[idx];
+        clog_thread_exit_arm_();
+    } else {
+        g_lock_no_slot = true;
+        (void)g_locks_no_table_add(1);
+    }
+    clog_unlock_();
+    return g_lock_tab;
+}
 
-    size_t i   = 0;
-    if (s) {
-        for (; i + 1 < cap && s[i]; ++i) buf[i] = s[i];
+/* a lock still held at exit has no release to time: the next owner starts from a clean hold */
+static void clog_lockstat_release_(void) {
+    if (!g_lock_tab) return;
+    clog_lock_();
+    for (int i = 0; i < CLOG_LOCKSTAT_LABELS; i++) g_lock_tab->labels[i].held_since = 0;
+    g_locks_owned[g_lock_tab - g_locks] = false;
+    clog_unlock_();
+    g_lock_tab = NULL;
+}
+
+static clog_lock_stats_ *clog_lock_entry_(const char *label) {
+    if (!clog_lock_tab_get_()) return NULL;
+    /* keyed by content: lock and unlock sites in different TUs may pass different copies of the literal */
+    uint64_t h = clog_hash64_(label);
+    for (unsigned i = 0; i < CLOG_LOCKSTAT_LABELS; i++) {
+        clog_lock_stats_ *e = &g_lock_tab->labels[(h + i) & (CLOG_LOCKSTAT_LABELS - 1)];
+        if (!e->label) e->label = label;
+        else if (e->label != label && strcmp(e->label, label) != 0) continue;
+        return e;
     }
-    clog_flush_line_(fd, buf, i);
+    return NULL;
 }
 
-static inline void clog_emit_(
-    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap
-) {
-    if ((int)lvl < clog_lvl_load_()) return;
+/* "812 ns", "3.25 us", "1.50 ms", "2.000 s" */
+static void clog_lock_fmt_(char *out, size_t cap, uint64_t ns) {
+    if (ns < 1000) (void)snprintf(out, cap, "%llu ns", (unsigned long long)ns);
+    else if (ns < 1000000) (void)snprintf(out, cap, "%.2f us", (double)ns / 1e3);
+    else if (ns < 1000000000) (void)snprintf(out, cap, "%.2f ms", (double)ns / 1e6);
+    else (void)snprintf(out, cap, "%.3f s", (double)ns / 1e9);
+}
 
-    int    fd        = clog_fd_load_();
-    char  *buf       = g_buf;
-    size_t cap       = CLOG_LINE_MAX;
-    size_t off       = clog_write_prefix_(buf, cap, lvl, file, line, group);
-    bool   truncated = false;
+void clogp_lock_acquired_(const char *file, int line, const char *label, uint64_t t0) {
+    uint64_t          now = clog_now_ns_mono_(), wait = now - t0;
+    clog_lock_stats_ *e   = clog_lock_entry_(label);
+    if (!e) {
+        if (g_lock_tab) ++g_lock_tab->overflow;
+    } else {
+        ++e->acquires;
+        e->wait_ns += wait;
+        if (wait > e->wait_max) e->wait_max = wait;
+        ++e->wait_hist[clog_lock_bucket_(wait)];
+    }
+    uint64_t out = g_lock_wait_out_load();
+    if (out && wait > out) {
+        char d[32];
+        clog_lock_fmt_(d, sizeof d, wait);
+        clog_log_file_line_(CLOG_WARN, file, line, "lock", "waited %s for %s", d, label);
+        now = clog_now_ns_mono_(); /* keep the report out of the hold time */
+    }
+    if (e) e->held_since = now;
+}
 
-    if (off < cap) {
-        va_list ap2;
-        va_copy(ap2, ap);
+void clogp_lock_release_(const char *file, int line, const char *label) {
+    clog_lock_stats_ *e = g_lock_tab ? clog_lock_entry_(label) : NULL;
+    if (!e || !e->held_since) return;
+    uint64_t hold = clog_now_ns_mono_() - e->held_since;
+    e->held_since = 0;
+    e->hold_ns += hold;
+    if (hold > e->hold_max) e->hold_max = hold;
+    ++e->hold_hist[clog_lock_bucket_(hold)];
+    uint64_t out = g_lock_hold_out_load();
+    if (out && hold > out) {
+        char d[32];
+        clog_lock_fmt_(d, sizeof d, hold);
+        clog_log_file_line_(CLOG_WARN, file, line, "lock", "held %s for %s", d, label);
+    }
+}
 
-        size_t avail = cap - off;
-        /* macOS/Clang (and GCC) fortify headers warn on non-literal formats.
-        We intentionally allow non-literals here */
-#    if defined(__APPLE__)
-#        pragma GCC diagnostic push
-#        pragma GCC diagnostic ignored "-Wformat-nonliteral"
-#    endif
-        int n = vsnprintf(buf + off, avail, fmt, ap2);
-#    if defined(__APPLE__)
-#        pragma GCC diagnostic pop
-#    endif
-        va_end(ap2);
+void clog_lockstat_set_outliers(uint64_t wait_ns, uint64_t hold_ns) {
+    g_lock_wait_out_store(wait_ns);
+    g_lock_hold_out_store(hold_ns);
+}
 
-        if (n > 0) {
-            size_t nn = (size_t)n;
-            if (nn >= avail) {
-                off       = cap - 1; /* keep last byte for '\0' */
-                truncated = true;
-            } else {
-                off += nn;
+/* upper edge of the bucket holding the q-th fraction of n samples, capped at the observed max */
+static uint64_t clog_lock_quantile_(const uint32_t *hist, uint64_t n, double q, uint64_t max) {
+    uint64_t want = (uint64_t)((double)n * q), seen = 0;
+    for (unsigned b = 0; b < CLOG_LOCK_BUCKETS_; b++) {
+        seen += hist[b];
+        if (seen > want) return (2ull << b) - 1 < max ? (2ull << b) - 1 : max;
+    }
+    return max;
+}
+
+/* merged view for dumps; guarded by the write lock */
+static clog_lock_stats_ g_locks_agg[CLOG_LOCKSTAT_LABELS * 2];
+
+static int clog_lock_cmp_(const void *a, const void *b) {
+    const clog_lock_stats_ *x = (const clog_lock_stats_ *)a, *y = (const clog_lock_stats_ *)b;
+    if (x->wait_ns != y->wait_ns) return x->wait_ns < y->wait_ns ? 1 : -1;
+    return x->hold_ns < y->hold_ns ? 1 : x->hold_ns > y->hold_ns ? -1 : 0;
+}
+
+void clog_lockstat_dump(void) {
+    int      fd = clog_fd_load_();
+    size_t   n  = 0;
+    uint64_t lost = 0;
+    int      tabs = g_locks_claimed_load();
+
+    clog_lock_();
+    for (int t = 0; t < tabs; t++) {
+        lost += g_locks[t].overflow;
+        for (int i = 0; i < CLOG_LOCKSTAT_LABELS; i++) {
+            const clog_lock_stats_ *e = &g_locks[t].labels[i];
+            if (!e->label) continue;
+            size_t k = 0;
+            for (; k < n; k++)
+                if (strcmp(g_locks_agg[k].label, e->label) == 0) break;
+            if (k == n) {
+                if (n == sizeof g_locks_agg / sizeof g_locks_agg[0]) {
+                    lost += e->acquires;
+                    continue;
+                }
+                memset(&g_locks_agg[n], 0, sizeof g_locks_agg[n]);
+                g_locks_agg[n].label = e->label;
+                ++n;
+            }
+            clog_lock_stats_ *a = &g_locks_agg[k];
+            a->acquires += e->acquires;
+            a->wait_ns += e->wait_ns;
+            a->hold_ns += e->hold_ns;
+            if (e->wait_max > a->wait_max) a->wait_max = e->wait_max;
+            if (e->hold_max > a->hold_max) a->hold_max = e->hold_max;
+            for (int b = 0; b < CLOG_LOCK_BUCKETS_; b++) {
+                a->wait_hist[b] += e->wait_hist[b];
+                a->hold_hist[b] += e->hold_hist[b];
             }
         }
     }
+    qsort(g_locks_agg, n, sizeof g_locks_agg[0], clog_lock_cmp_);
 
-    if (truncated && off + 3 < cap) {
-        memcpy(buf + off, "...", 3);
-        off += 3;
+    clog_dump_printf_(fd,
+                      "=== lock stats: %zu label(s), %d thread table(s) ===\n"
+                      "%10s %10s %10s %10s %10s %10s %10s  label\n",
+                      n, tabs, "acquires", "wait p50<", "wait p99<", "wait max", "hold p50<", "hold p99<", "hold max");
+    for (size_t k = 0; k < n; k++) {
+        const clog_lock_stats_ *e = &g_locks_agg[k];
+        uint64_t holds = 0;
+        for (int b = 0; b < CLOG_LOCK_BUCKETS_; b++) holds += e->hold_hist[b];
+        char d[6][24];
+        clog_lock_fmt_(d[0], sizeof d[0], clog_lock_quantile_(e->wait_hist, e->acquires, 0.50, e->wait_max));
+        clog_lock_fmt_(d[1], sizeof d[1], clog_lock_quantile_(e->wait_hist, e->acquires, 0.99, e->wait_max));
+        clog_lock_fmt_(d[2], sizeof d[2], e->wait_max);
+        clog_lock_fmt_(d[3], sizeof d[3], clog_lock_quantile_(e->hold_hist, holds, 0.50, e->hold_max));
+        clog_lock_fmt_(d[4], sizeof d[4], clog_lock_quantile_(e->hold_hist, holds, 0.99, e->hold_max));
+        clog_lock_fmt_(d[5], sizeof d[5], e->hold_max);
+        clog_dump_printf_(fd, "%10llu %10s %10s %10s %10s %10s %10s  %s\n", (unsigned long long)e->acquires, d[0], d[1],
+                          d[2], d[3], d[4], d[5], e->label);
     }
+    int no_table = g_locks_no_table_load();
+    if (lost || no_table)
+        clog_dump_printf_(fd, "(untracked: %llu acquisition(s) past table limits, %d thread(s) without a table)\n",
+                          (unsigned long long)lost, no_table);
+    clog_unlock_();
+}
+#    else
+void clog_lockstat_set_outliers(uint64_t wait_ns, uint64_t hold_ns) {
+    (void)wait_ns;
+    (void)hold_ns;
+}
+void clog_lockstat_dump(void) {}
+static void clog_lockstat_release_(void) {}
+void clogp_lock_acquired_(const char *file, int line, const char *label, uint64_t t0) {
+    (void)file;
+    (void)line;
+    (void)label;
+    (void)t0;
+}
+void clogp_lock_release_(const char *file, int line, const char *label) {
+    (void)file;
+    (void)line;
+    (void)label;
+}
+#    endif
+
+// named counters: per-thread slot arrays from a fixed pool, written only by their owner and summed by readers
+// (relaxed loads and stores: one writer per slot, so no read-modify-write). An exiting thread's slots are folded
+// into a shared set and its table goes back to the pool; threads past the pool add into that set under the lock. A periodic flush is checked every CLOG_COUNTER_CHECK_ adds per thread, so the
+// add path never reads the clock, and after every record written while an interval is set.
+#    if CLOG_COUNTERS_MAX > 0
+#        define CLOG_COUNTER_CHECK_ 256
+#        if defined(__GNUC__) || defined(__clang__)
+#            define CLOG_CTR_LOAD_(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#            define CLOG_CTR_STORE_(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#        else
+#            define CLOG_CTR_LOAD_(p)     (*(volatile int64_t *)(p))
+#            define CLOG_CTR_STORE_(p, v) (*(volatile int64_t *)(p) = (v))
+#        endif
+typedef struct {
+    int64_t v[CLOG_COUNTERS_MAX];
+} clog_counter_tab_;
 
-    clog_flush_line_(fd, buf, off);
+static char                                g_ctr_names[CLOG_COUNTERS_MAX][CLOG_COUNTER_NAME_MAX];
+static clog_counter_tab_                   g_ctr_tabs[CLOG_COUNTER_THREADS];
+static bool                                g_ctr_owned[CLOG_COUNTER_THREADS]; /* guarded by the write lock */
+static clog_counter_tab_                   g_ctr_shared; /* exited threads and those without a table; under the lock */
+static int64_t                             g_ctr_last[CLOG_COUNTERS_MAX]; /* totals at the last flush */
+static uint64_t                            g_ctr_last_ns; /* under the lock */
+static CLOG_THREADLOCAL clog_counter_tab_ *g_ctr_tab     = NULL;
+static CLOG_THREADLOCAL bool               g_ctr_no_slot = false;
+static CLOG_THREADLOCAL unsigned           g_ctr_tick    = 0;
+CLOG_STATE_INT(g_ctr_n, 0)
+CLOG_STATE_INT(g_ctr_claimed, 0) /* tables ever handed out; sums cover [0, claimed) */
+CLOG_STATE_U64(g_ctr_due_ns, 0) /* read without the lock to skip early, advanced under it */
 
-#    if defined(_WIN32)
-    if (lvl == CLOG_FATAL) { _commit(fd); }
+static int clog_counter_find_(const char *name) {
+    int n = g_ctr_n_load();
+    for (int i = 0; i < n; i++)
+        if (strcmp(g_ctr_names[i], name) == 0) return i;
+    return -1;
+}
+
+/* the name is copied, so a computed one may live in a caller's buffer; names are never removed */
+int clog_counter_register(const char *name) {
+    size_t len = name ? strlen(name) : CLOG_COUNTER_NAME_MAX;
+    if (len >= CLOG_COUNTER_NAME_MAX) return -1;
+    uint64_t now = clog_now_ns_mono_();
+    clog_lock_();
+    if (!g_ctr_last_ns) g_ctr_last_ns = now; /* the first flush reports the time since the first counter */
+    int id = clog_counter_find_(name);
+    if (id < 0 && g_ctr_n_load() < CLOG_COUNTERS_MAX) {
+        id = g_ctr_n_load();
+        memcpy(g_ctr_names[id], name, len + 1);
+        g_ctr_n_store(id + 1);
+    }
+    clog_unlock_();
+    return id;
+}
+
+static int64_t clog_counter_sum_(int id) {
+    int     tabs = g_ctr_claimed_load();
+    int64_t v    = g_ctr_shared.v[id];
+    for (int t = 0; t < tabs; t++) v += CLOG_CTR_LOAD_(&g_ctr_tabs[t].v[id]);
+    return v;
+}
+
+int64_t clog_counter_get(const char *name) {
+    clog_lock_();
+    int     id = clog_counter_find_(name);
+    int64_t v  = id < 0 ? 0 : clog_counter_sum_(id);
+    clog_unlock_();
+    return v;
+}
+
+void clogp_counters_flush_(const char *file, int line) {
+    /* a summary the level, filter, shedding or a running sink would drop keeps its changes for the next flush */
+    if (clog_suppressed_(NULL, CLOG_INFO, file, line, "counters") || (int)CLOG_INFO < g_shed_load()) return;
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load()) && clog_in_sink_()) return;
+    int64_t  d[CLOG_COUNTERS_MAX];
+    uint64_t now = clog_now_ns_mono_(), since;
+    clog_lock_();
+    int n = g_ctr_n_load();
+    for (int i = 0; i < n; i++) {
+        int64_t v     = clog_counter_sum_(i);
+        d[i]          = v - g_ctr_last[i];
+        g_ctr_last[i] = v;
+    }
+    since         = g_ctr_last_ns ? now - g_ctr_last_ns : 0;
+    g_ctr_last_ns = now;
+    clog_unlock_();
+
+    /* unchanged counters are left out; a long list is split over several lines */
+    char   msg[CLOG_LINE_MAX / 2];
+    size_t off = 0;
+    for (int i = 0; i <= n; i++) {
+        if (i < n && !d[i]) continue;
+        char item[160];
+        int  w = i < n ? snprintf(item, sizeof item, " %s=%lld", g_ctr_names[i], (long long)d[i]) : 0;
+        if (w < 0) w = 0;
+        if ((size_t)w >= sizeof item) w = (int)sizeof item - 1;
+        if (off && (i == n || off + (size_t)w >= sizeof msg)) {
+            clog_log_file_line_(CLOG_INFO, file, line, "counters", "%.3f s:%.*s", (double)since / 1e9, (int)off, msg);
+            off = 0;
+        }
+        if (i < n) {
+            memcpy(msg + off, item, (size_t)w);
+            off += (size_t)w;
+        }
+    }
+}
+
+static void clog_counters_tick_(const char *file, int line) {
+    int ms = g_ctr_interval_ms_load();
+    if (ms <= 0) return;
+    uint64_t now = clog_now_ns_mono_();
+    if (now < g_ctr_due_ns_load()) return;
+    clog_lock_();
+    bool due = now >= g_ctr_due_ns_load();
+    if (due) g_ctr_due_ns_store(now + (uint64_t)ms * UINT64_C(1000000));
+    clog_unlock_();
+    if (due) clogp_counters_flush_(file, line);
+}
+
+/* this thread's slots, claimed on its first add (takes the write lock) */
+static void clog_counters_claim_(void) {
+    clog_lock_();
+    int idx = 0;
+    while (idx < CLOG_COUNTER_THREADS && g_ctr_owned[idx]) ++idx;
+    if (idx < CLOG_COUNTER_THREADS) {
+        g_ctr_owned[idx] = true;
+        if (idx >= g_ctr_claimed_load()) g_ctr_claimed_store(idx + 1);
+        g_ctr_tab = &g_ctr_tabs[idx];
+        clog_thread_exit_arm_();
+    } else {
+        g_ctr_no_slot = true;
+    }
+    clog_unlock_();
+}
+
+/* sums and flushes hold the lock too, so they see each count once: in the table or in the shared set */
+static void clog_counters_release_(void) {
+    if (!g_ctr_tab) return;
+    clog_lock_();
+    for (int i = 0; i < CLOG_COUNTERS_MAX; i++) {
+        g_ctr_shared.v[i] += CLOG_CTR_LOAD_(&g_ctr_tab->v[i]);
+        CLOG_CTR_STORE_(&g_ctr_tab->v[i], 0);
+    }
+    g_ctr_owned[g_ctr_tab - g_ctr_tabs] = false;
+    clog_unlock_();
+    g_ctr_tab = NULL;
+}
+
+void clogp_counter_add_(int id, int64_t delta, const char *file, int line) {
+    if ((unsigned)id >= CLOG_COUNTERS_MAX) return;
+    if (CLOG_UNLIKELY(!g_ctr_tab)) {
+        if (!g_ctr_no_slot) clog_counters_claim_();
+        if (g_ctr_no_slot) {
+            clog_lock_();
+            g_ctr_shared.v[id] += delta;
+            clog_unlock_();
+        }
+    }
+    if (g_ctr_tab) CLOG_CTR_STORE_(&g_ctr_tab->v[id], CLOG_CTR_LOAD_(&g_ctr_tab->v[id]) + delta);
+    if (CLOG_UNLIKELY(++g_ctr_tick >= CLOG_COUNTER_CHECK_)) {
+        g_ctr_tick = 0;
+        clog_counters_tick_(file, line);
+    }
+}
+
+void clog_counters_set_interval(int ms) {
+    uint64_t now = clog_now_ns_mono_();
+    clog_lock_();
+    g_ctr_due_ns_store(ms > 0 ? now + (uint64_t)ms * UINT64_C(1000000) : 0);
+    if (!g_ctr_last_ns) g_ctr_last_ns = now;
+    clog_unlock_();
+    g_ctr_interval_ms_store(ms);
+}
 #    else
-    if (lvl == CLOG_FATAL) (void)fsync(fd);
-#    endif
+int clog_counter_register(const char *name) {
+    (void)name;
+    return -1;
 }
+int64_t clog_counter_get(const char *name) {
+    (void)name;
+    return 0;
+}
+void clog_counters_set_interval(int ms) { (void)ms; }
+static void clog_counters_release_(void) {}
+static void clog_counters_tick_(const char *file, int line) {
+    (void)file;
+    (void)line;
+}
+void clogp_counter_add_(int id, int64_t delta, const char *file, int line) {
+    (void)id;
+    (void)delta;
+    (void)file;
+    (void)line;
+}
+void clogp_counters_flush_(const char *file, int line) {
+    (void)file;
+    (void)line;
+}
+#    endif
 
 // public funcs
-void       clog_set_level(clog_level lvl) { clog_lvl_store_((int)lvl); }
+void clog_set_level(clog_level lvl) {
+    clog_lock_();
+    clog_lvl_store_((int)lvl);
+    clog_gate_refresh_();
+    clog_unlock_();
+}
 clog_level clog_get_level(void) { return (clog_level)clog_lvl_load_(); }
 
-void clog_vlog_file_line_(clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap) {
-    clog_emit_(lvl, file, line, group, fmt, ap);
+/* the level itself is thread-local; only setting the first or clearing the last override touches the gate word */
+int clog_thread_swap_level_(int lvl) {
+    int prev = clog_thread_lvl_;
+    if (lvl < 0 || lvl > CLOG_LVL_NONE_) lvl = CLOG_LVL_NONE_;
+    clog_thread_lvl_ = lvl;
+    if ((lvl == CLOG_LVL_NONE_) != (prev == CLOG_LVL_NONE_)) {
+        clog_lock_();
+        if (prev == CLOG_LVL_NONE_) clog_thread_exit_arm_();
+        g_thread_overrides += prev == CLOG_LVL_NONE_ ? 1 : -1;
+        clog_gate_refresh_();
+        clog_unlock_();
+    }
+    return prev;
+}
+void clog_set_shedding(int high_ns, int low_ns) {
+    clog_lock_();
+    if (high_ns <= 0 && g_shed_load() > CLOG_LVL_TRACE) clog_shed_summary_(clog_fd_load_(), clog_now_ns_mono_());
+    if (high_ns <= 0) g_shed_store(CLOG_LVL_TRACE);
+    g_shed_high_ns_store(high_ns > 0 ? high_ns : 0);
+    g_shed_low_ns_store(low_ns > 0 ? low_ns : 0);
+    g_shed_ewma_ns    = 0;
+    g_shed_changed_ns = clog_now_ns_mono_();
+    clog_unlock_();
+}
+clog_level clog_get_shed_level(void) { return (clog_level)g_shed_load(); }
+
+void       clog_thread_set_level(clog_level lvl) { (void)clog_thread_swap_level_((int)lvl); }
+void       clog_thread_clear_level(void) { (void)clog_thread_swap_level_(CLOG_LVL_NONE_); }
+clog_level clog_thread_get_level(void) { return (clog_level)clog_eff_lvl_(); }
+
+// V-levels: global V, vmodule table and the list of resolved sites (all guarded by the write lock)
+typedef struct {
+    char pat[CLOG_VMODULE_PAT_MAX];
+    int  v;
+} clog_vmodule_;
+static int           g_v = 0;
+static clog_vmodule_ g_vmodule[CLOG_VMODULE_MAX];
+static int           g_vmodule_n = 0;
+static clog_vsite_  *g_vsites    = NULL;
+
+/* glob with '*' and '?' against s[0..n) */
+static bool clog_glob_match_(const char *pat, const char *s, size_t n) {
+    const char *star = NULL, *ss = s, *end = s + n;
+    while (s < end) {
+        if (*pat == '?' || (*pat && *pat == *s)) {
+            ++pat;
+            ++s;
+        } else if (*pat == '*') {
+            star = pat++;
+            ss   = s;
+        } else if (star) {
+            pat = star + 1;
+            s   = ++ss;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') ++pat;
+    return *pat == '\0';
+}
+
+static int clog_vsite_resolve_(const char *file, const char *group) {
+    const char *stem = clog_basename_(file);
+    size_t      n    = 0;
+    while (stem[n] && stem[n] != '.') ++n;
+    for (int i = 0; i < g_vmodule_n; i++) {
+        const char *pat = g_vmodule[i].pat;
+        if (clog_glob_match_(pat, stem, n) || (group && clog_glob_match_(pat, group, strlen(group))))
+            return g_vmodule[i].v;
+    }
+    return g_v;
+}
+
+#    if defined(__GNUC__) || defined(__clang__)
+#        define CLOG_VSITE_SET_V_(s, x)    __atomic_store_n(&(s)->v, (x), __ATOMIC_RELAXED)
+#        define CLOG_VSITE_SET_FILE_(s, f) __atomic_store_n(&(s)->file, (f), __ATOMIC_RELEASE)
+#    else
+#        define CLOG_VSITE_SET_V_(s, x)    (*(volatile int *)&(s)->v = (x))
+#        define CLOG_VSITE_SET_FILE_(s, f) (*(const char *volatile *)&(s)->file = (f))
+#    endif
+
+static void clog_vsites_refresh_(void) {
+    for (clog_vsite_ *s = g_vsites; s; s = s->next) CLOG_VSITE_SET_V_(s, clog_vsite_resolve_(s->file, s->group));
+}
+
+bool clog_vsite_init_(clog_vsite_ *site, const char *file, const char *group, int n) {
+    clog_lock_();
+    if (!site->file) {
+        site->group = group;
+        CLOG_VSITE_SET_V_(site, clog_vsite_resolve_(file, group));
+        site->next = g_vsites;
+        g_vsites   = site;
+        CLOG_VSITE_SET_FILE_(site, file); /* publishes v, group and next */
+    }
+    int v = site->v;
+    clog_unlock_();
+    return v >= n;
+}
+
+void clog_set_v(int v) {
+    clog_lock_();
+    g_v = v;
+    clog_vsites_refresh_();
+    clog_unlock_();
+}
+int clog_get_v(void) {
+    clog_lock_();
+    int v = g_v;
+    clog_unlock_();
+    return v;
+}
+
+int clog_set_vmodule(const char *spec) {
+    clog_vmodule_ tab[CLOG_VMODULE_MAX];
+    int           cnt = 0;
+    for (const char *p = spec; p && *p;) {
+        const char *eq = strchr(p, '=');
+        if (!eq || eq == p || cnt == CLOG_VMODULE_MAX) return -1;
+        size_t plen = (size_t)(eq - p);
+        if (plen >= CLOG_VMODULE_PAT_MAX) return -1;
+        memcpy(tab[cnt].pat, p, plen);
+        tab[cnt].pat[plen] = '\0';
+        char *end;
+        long  v = strtol(eq + 1, &end, 10);
+        if (end == eq + 1 || (*end && *end != ',')) return -1;
+        tab[cnt++].v = (int)v;
+        p            = *end ? end + 1 : end;
+    }
+    clog_lock_();
+    memcpy(g_vmodule, tab, sizeof tab[0] * (size_t)cnt);
+    g_vmodule_n = cnt;
+    clog_vsites_refresh_();
+    clog_unlock_();
+    return 0;
+}
+
+CLOG_COLD void clog_vlog_file_line_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, va_list ap
+) {
+    clog_emit_(NULL, lvl, file, line, group, fmt, ap);
 }
-void clog_log_file_line_(clog_level lvl, const char *file, int line, const char *group, const char *fmt, ...) {
+CLOG_COLD void clog_log_file_line_(
+    clog_level lvl, const char *file, int line, const char *group, const char *fmt, ...
+) {
     va_list ap;
     va_start(ap, fmt);
     clog_vlog_file_line_(lvl, file, line, group, fmt, ap);
     va_end(ap);
 }
+CLOG_COLD void clog_log_site_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group, const char *fmt, ...
+) {
+    va_list ap;
+    va_start(ap, fmt);
+    clog_emit_(site, lvl, file, line, group, fmt, ap);
+    va_end(ap);
+}
+
+/* Not captured when suppressed: the payload is the caller's and may be gone by commit time. */
+CLOG_COLD void clog_log_raw_(
+    clog_psite_ *site, clog_level lvl, const char *file, int line, const char *group, const void *buf, size_t len
+) {
+    if (clog_suppressed_(site, lvl, file, line, group)) {
+        clog_stats_note_(file, line, 0, true);
+        return;
+    }
+    if (CLOG_UNLIKELY((int)lvl < g_shed_load())) {
+        clog_shed_count_(lvl);
+        clog_stats_note_(file, line, 0, true);
+        return;
+    }
+
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load()) && clog_in_sink_()) return;
+
+    int    fd  = clog_fd_load_();
+    size_t off = site ? clog_write_prefix_site_(g_buf, CLOG_LINE_MAX, lvl, site, file, line, group)
+                      : clog_write_prefix_(g_buf, CLOG_LINE_MAX, lvl, file, line, group);
+    if (off >= CLOG_LINE_MAX) off = CLOG_LINE_MAX - 1;
+    if (!buf) len = 0;
+
+    bool      nl = !len || ((const char *)buf)[len - 1] != '\n';
+    clog_iov_ iov[CLOG_IOV_MAX_];
+    iov[0].iov_base = g_buf;
+    iov[0].iov_len  = off;
+    iov[1].iov_base = (void *)(uintptr_t)buf;
+    iov[1].iov_len  = len;
+    iov[2].iov_base = (void *)(uintptr_t) "\n";
+    iov[2].iov_len  = 1;
+    clog_record  r, *rec = NULL;
+    if (CLOG_SINKS_MAX > 0 && CLOG_UNLIKELY(g_sinks_n_load())) {
+        clog_record_view_(&r, lvl, g_prefix_ns, file, line, group, g_buf, off, off);
+        r.msg     = (const char *)buf;
+        r.msg_len = nl ? len : len - 1;
+        rec       = &r;
+    }
+    clog_writev_locked_(fd, iov, nl ? 3 : 2, rec);
+    clog_stats_note_(file, line, off + len + (nl ? 1u : 0u), false);
+    clog_sync_if_fatal_(fd, lvl);
+}
 
 // timers (call-site aware)
 #    if CLOG_TIMERS_MAX > 0
@@ -704,6 +4176,7 @@ void clogp_timer_end_(const char *file, int line, const char *label) {
 void clogp_timer_start_(const char *file, int line, const char *label) {
     (void)file;
     (void)line;
+    CLOG_PROBE_TIMER_("timer_start", file, line, label, 0);
     uint64_t key = clog_hash64_(label);
     int      idx = clog_timer_find_slot_(key);
     if (idx < 0) idx = clog_timer_free_slot_();
@@ -726,6 +4199,7 @@ void clogp_timer_end_(const char *file, int line, const char *label) {
     }
     uint64_t dt_ns     = clog_now_ns_mono_() - g_timers[idx].t0;
     g_timers[idx].used = false;
+    CLOG_PROBE_TIMER_("timer_end", file, line, label, dt_ns);
     if (dt_ns < CLOG_TIMER_NS_MAX) {
         clog_log_file_line_(CLOG_DEBUG, file, line, "timer", "[%llu ns]: %s", (unsigned long long)dt_ns, label);
     } else if (dt_ns < CLOG_TIMER_US_MAX) {
@@ -741,6 +4215,126 @@ void clogp_timer_end_(const char *file, int line, const char *label) {
 }
 #    endif
 
+// clock provider
+int               clog_clock_kind_ = CLOG_CLOCK_SYSTEM;
+static clog_clock g_clock_user;
+
+#    if defined(__linux__) && defined(CLOCK_REALTIME_COARSE) && defined(CLOCK_MONOTONIC_COARSE)
+#        define CLOG_CLOCK_COARSE_ 1
+static uint64_t clog_coarse_ns_(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+static uint64_t clog_coarse_wall_(void) { return clog_coarse_ns_(CLOCK_REALTIME_COARSE); }
+static uint64_t clog_coarse_mono_(void) { return clog_coarse_ns_(CLOCK_MONOTONIC_COARSE); }
+#    elif defined(_WIN32)
+#        define CLOG_CLOCK_COARSE_ 1
+static uint64_t clog_coarse_wall_(void) {
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULARGE_INTEGER u;
+    u.LowPart  = ft.dwLowDateTime;
+    u.HighPart = ft.dwHighDateTime;
+    return (u.QuadPart - 116444736000000000ULL) * 100ULL;
+}
+static uint64_t clog_coarse_mono_(void) { return (uint64_t)GetTickCount64() * 1000000ull; }
+#    else
+#        define CLOG_CLOCK_COARSE_ 0
+#    endif
+
+/* TSC: ns = mono0 + ((tsc - tsc0) * mult >> 32), mult measured over CLOG_TSC_CALIBRATE_MS */
+#    if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#        include <cpuid.h>
+#        include <x86intrin.h>
+#        define CLOG_CLOCK_TSC_ 1
+static uint64_t g_tsc0 = 0, g_tsc_mult = 0, g_tsc_mono0 = 0, g_tsc_wall0 = 0;
+
+static int clog_tsc_calibrate_(void) {
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000007u, &a, &b, &c, &d) || !(d & (1u << 8))) return -1; /* not invariant */
+    uint64_t m0 = clog_sys_mono_ns_(), t0 = __rdtsc(), m1, t1;
+    do {
+        m1 = clog_sys_mono_ns_();
+        t1 = __rdtsc();
+    } while (m1 - m0 < (uint64_t)CLOG_TSC_CALIBRATE_MS * UINT64_C(1000000));
+    if (t1 <= t0) return -1;
+    g_tsc_mult  = ((m1 - m0) << 32) / (t1 - t0);
+    g_tsc0      = t1;
+    g_tsc_mono0 = m1;
+    g_tsc_wall0 = clog_sys_wall_ns_();
+    return 0;
+}
+
+__extension__ typedef unsigned __int128 clog_u128_;
+static inline uint64_t clog_tsc_ns_(void) {
+    return (uint64_t)(((clog_u128_)(__rdtsc() - g_tsc0) * g_tsc_mult) >> 32);
+}
+#    else
+#        define CLOG_CLOCK_TSC_ 0
+#    endif
+
+uint64_t clogp_clock_wall_(void) {
+    switch (CLOG_CLOCK_LOAD_()) {
+#    if CLOG_CLOCK_COARSE_
+        case CLOG_CLOCK_COARSE: return clog_coarse_wall_();
+#    endif
+#    if CLOG_CLOCK_TSC_
+        case CLOG_CLOCK_TSC: return g_tsc_wall0 + clog_tsc_ns_();
+#    endif
+        case CLOG_CLOCK_USER: return g_clock_user.wall_ns(g_clock_user.ud);
+        default: return clog_sys_wall_ns_();
+    }
+}
+
+uint64_t clogp_clock_mono_(void) {
+    switch (CLOG_CLOCK_LOAD_()) {
+#    if CLOG_CLOCK_COARSE_
+        case CLOG_CLOCK_COARSE: return clog_coarse_mono_();
+#    endif
+#    if CLOG_CLOCK_TSC_
+        case CLOG_CLOCK_TSC: return g_tsc_mono0 + clog_tsc_ns_();
+#    endif
+        case CLOG_CLOCK_USER: return g_clock_user.mono_ns(g_clock_user.ud);
+        default: return clog_sys_mono_ns_();
+    }
+}
+
+int clog_set_clock(clog_clock_kind kind, const clog_clock *user) {
+    switch (kind) {
+        case CLOG_CLOCK_SYSTEM: break;
+        case CLOG_CLOCK_COARSE:
+            if (!CLOG_CLOCK_COARSE_) {
+                errno = ENOTSUP;
+                return -1;
+            }
+            break;
+        case CLOG_CLOCK_TSC:
+#    if CLOG_CLOCK_TSC_
+            if (clog_tsc_calibrate_() != 0) {
+                errno = ENOTSUP;
+                return -1;
+            }
+            break;
+#    else
+            errno = ENOTSUP;
+            return -1;
+#    endif
+        case CLOG_CLOCK_USER:
+            if (!user || !user->wall_ns || !user->mono_ns) {
+                errno = EINVAL;
+                return -1;
+            }
+            g_clock_user = *user;
+            break;
+        default: errno = EINVAL; return -1;
+    }
+    CLOG_CLOCK_STORE_((int)kind);
+    return 0;
+}
+
+clog_clock_kind clog_get_clock(void) { return (clog_clock_kind)CLOG_CLOCK_LOAD_(); }
+
 // banner
 void clog_banner(void) {
 #    ifdef CLOG_BUILD
@@ -756,6 +4350,7 @@ void clog_banner(void) {
 int  clog_get_fd(void) { return clog_fd_load_(); }
 void clog_set_fd(int fd) {
     clog_fd_store_(fd);
+    g_shared_store(0);
     /* no cached color state; detection follows current fd per call */
 }
 
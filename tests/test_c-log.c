@@ -19,6 +19,7 @@ static void set_no_color_(void) { _putenv("NO_COLOR=1"); }
 #else
     #include <fcntl.h>
     #include <sys/stat.h>
+    #include <sys/wait.h>
     #include <time.h>
     #include <unistd.h>
     #define PIPE         pipe
@@ -219,6 +220,780 @@ static int test_newline_integrity(void) {
     return ok ? 0 : 42;
 }
 
+static void vsite_probe(void) { log_v(3, "vprobe"); }
+
+static int test_vlevels_and_vmodule(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 60;
+
+    clog_set_level(CLOG_INFO);
+    clog_set_v(1);
+    log_v(1, "v1 on");
+    log_v(2, "v2 off");
+    vsite_probe();  // resolved at V=1: off
+    int bad = clog_set_vmodule("nope=");
+    clog_set_vmodule("test_c*=3");
+    vsite_probe();  // re-resolved through vmodule: on
+    log_v_group(4, "vgrp", "v4 group off");
+    clog_set_vmodule("vgrp=4");
+    log_v_group(4, "vgrp", "v4 group on");
+    clog_set_vmodule(NULL);
+    clog_set_v(0);
+    vsite_probe();  // back to V=0: off
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 61;
+
+    int ok = bad == -1 && contains(out, "v1 on") && !contains(out, "v2 off") && count_substr(out, "vprobe") == 1 &&
+             !contains(out, "v4 group off") && contains(out, "[vgrp] v4 group on");
+    free(out);
+    return ok ? 0 : 62;
+}
+
+static int test_block_contiguous(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 70;
+
+    clog_set_level(CLOG_INFO);
+    clog_block_begin(CLOG_DEBUG, "cfg");  // below threshold: whole block dropped
+    clog_block_line("hidden %d", 1);
+    clog_block_end();
+    clog_block_begin(CLOG_WARN, "cfg");
+    clog_block_line("config:");
+    log_info("inside");  // regular records are not part of the block and come first
+    clog_block_line("  a = %d", 1);
+    clog_block_line("  b = %s", "two");
+    clog_block_end();
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 71;
+
+    const char* hdr = strstr(out, "[cfg] config:");
+    int         ok  = hdr && !contains(out, "hidden") && count_substr(out, "[WARN]") == 3 && count_char(out, '\n') == 4 &&
+             strstr(out, "inside") < hdr && contains(hdr, "[cfg]   a = 1\n") && contains(hdr, "[cfg]   b = two\n");
+    free(out);
+    return ok ? 0 : 72;
+}
+
+static int test_capture_commit_discard(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 80;
+
+    clog_set_level(CLOG_WARN);
+    clog_capture_begin();
+    log_debug("dropped request %d", 1);
+    log_trace("below capture level");
+    clog_capture_discard();
+
+    char        name[16] = "alice";
+    char        raw[4]   = {'w', 'x', 'y', 'z'};  // not terminated: only the precision bounds it
+    static char longer[2 * CLOG_LINE_MAX];
+    memset(longer, 'a', sizeof longer - 1);
+    clog_capture_begin();
+    log_debug_group("req", "user=%s id=%05d ratio=%.2f big=%lld w=[%*d] p=[%.*s] %%", name, 42, 0.5, 1LL << 40, 4, 7,
+                    3, "abcdef");
+    log_info("ls %ls", L"x");  // wide strings cannot be deferred: rendered eagerly
+    log_debug("raw=[%.3s|%.*s]", raw, 4, raw);
+    log_debug("long %s", longer);            // clipped at commit: ends in "..."
+    log_debug("wide %ls %s", L"y", longer);  // clipped when rendered eagerly: ends in "..."
+    strcpy(name, "bob");                     // capture must not keep pointers into caller memory
+    log_error("request failed");
+    clog_capture_commit();
+    log_debug("after commit (should NOT appear)");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 81;
+
+    const char* err = strstr(out, "request failed");
+    const char* dbg = strstr(out, "[req] user=alice id=00042 ratio=0.50 big=1099511627776 w=[   7] p=[abc] %");
+    int ok = err && dbg && err < dbg && contains(out, "ls x") && !contains(out, "dropped request") &&
+             !contains(out, "below capture") && !contains(out, "after commit") && count_char(out, '\n') == 6 &&
+             contains(out, "raw=[wxy|wxyz]\n") && count_substr(out, "aaa...\n") == 2 && contains(out, "wide y aaa");
+    free(out);
+    return ok ? 0 : 82;
+}
+
+static int test_thread_level_override(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 90;
+
+    clog_set_level(CLOG_WARN);
+    log_debug("global warn (should NOT appear)");
+    int gate_shared = 0;
+    CLOG_SCOPE_LEVEL(CLOG_DEBUG) {
+        log_debug("scoped debug");
+        CLOG_SCOPE_LEVEL(CLOG_TRACE) {
+            log_trace("nested trace");
+            gate_shared = clog_lvl_gate_ == CLOG_WARN - CLOG_GATE_TLS_; /* flagged, not lowered */
+        }
+        log_trace("trace after nested scope (should NOT appear)");
+    }
+    int gate_restored = clog_lvl_gate_ == CLOG_WARN && clog_thread_get_level() == CLOG_WARN;
+    clog_thread_set_level(CLOG_INFO);
+    log_info("thread info");
+    clog_thread_clear_level();
+    log_info("cleared (should NOT appear)");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 91;
+
+    int ok = gate_shared && gate_restored && contains(out, "scoped debug") && contains(out, "nested trace") &&
+             contains(out, "thread info") && !contains(out, "should NOT appear") && clog_lvl_gate_ == CLOG_WARN;
+    free(out);
+    return ok ? 0 : 92;
+}
+
+static int test_load_shedding(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 100;
+
+    clog_set_level(CLOG_TRACE);
+    clog_set_shedding(1, 0);  // any write is "slow": step up every CLOG_SHED_STEP_MS, never recover
+    for (int i = 0; i < 5; i++) {
+        log_warn("pressure %d", i);
+        sleep_ms_(CLOG_SHED_STEP_MS + 15);
+    }
+    clog_level shed = clog_get_shed_level();
+    log_trace("shed trace");
+    log_debug("shed debug");
+    log_info("shed info");
+    log_warn("kept warn");
+    clog_set_shedding(0, 0);  // disabling ends the episode and prints the summary
+    log_info("after shedding");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 101;
+
+    int ok = shed == CLOG_WARN && !contains(out, "shed trace") && !contains(out, "shed debug") &&
+             !contains(out, "shed info") && contains(out, "kept warn") && contains(out, "after shedding") &&
+             count_substr(out, "=== shed: dropped TRACE=1 DEBUG=1 INFO=1") == 1;
+    free(out);
+    return ok ? 0 : 102;
+}
+
+static int chatty_line;
+static void chatty_site(int i) {
+    chatty_line = __LINE__ + 1;
+    log_info("chatty site with a longer payload %d", i);
+}
+
+static int test_stats_top_talkers(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 110;
+
+    clog_set_level(CLOG_INFO);
+    clog_stats_enable(true);
+    for (int i = 0; i < 3; i++) chatty_site(i);
+    int quiet_line = __LINE__ + 1;
+    log_info("quiet");
+    int supp_line = __LINE__ + 1;
+    log_debug("suppressed");  // counted at the front-end: stats hold the inline gate at TRACE
+    clog_stats_enable(false);
+    log_info("not counted");
+    clog_stats_dump(0);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 111;
+
+    char chatty[64], quiet[64], supp[64];
+    snprintf(chatty, sizeof chatty, "  test_c-log.c:%d\n", chatty_line);
+    snprintf(quiet, sizeof quiet, "  test_c-log.c:%d\n", quiet_line);
+    snprintf(supp, sizeof supp, "1  test_c-log.c:%d\n", supp_line);
+    const char* top = strstr(out, "=== top talkers:");
+    const char* c   = top ? strstr(top, chatty) : NULL;
+    const char* q   = top ? strstr(top, quiet) : NULL;
+    int         ok  = c && q && c < q && contains(top, supp) && count_substr(top, "test_c-log.c:") == 3;
+    free(out);
+    return ok ? 0 : 112;
+}
+
+static int prefix_site_line;
+static void prefix_site(const char* group, int i) {
+    prefix_site_line = __LINE__ + 1;
+    log_warn_group(group, "ps %d", i);
+}
+
+static int group_evals;
+static const char* counted_group_(void) {
+    group_evals++;
+    return "ev";
+}
+
+static int test_prefix_cache_per_site(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 130;
+
+    clog_set_level(CLOG_INFO);
+    char buf[80];
+    prefix_site("net", 0);
+    prefix_site("net", 1);
+    prefix_site(NULL, 2);
+    snprintf(buf, sizeof buf, "dyn%d", 3); /* same pointer, new contents */
+    prefix_site(buf, 3);
+    snprintf(buf, sizeof buf, "dyn%d", 4);
+    prefix_site(buf, 4);
+    memset(buf, 'g', 70);
+    buf[70] = '\0';
+    prefix_site(buf, 5);
+    /* the macros stay expressions */
+    int hits = 0;
+    (void)(hits++, log_info("comma %d", hits));
+    hits > 0 ? log_info("ternary") : (void)0;
+    for (int i = 0; i < 2; i++, log_info("loop step %d", i)) {}
+    /* arguments run once when the record is logged and not at all when it is suppressed (the USDT probes only take
+       compile-time constants) */
+    int arg_evals = 0;
+    group_evals   = 0;
+    log_debug_group(counted_group_(), "suppressed %d", ++arg_evals);
+    log_info_group(counted_group_(), "once %d", ++arg_evals);
+    log_raw(CLOG_INFO, counted_group_(), "raw once", (size_t)(++arg_evals, 8));
+    int once = group_evals == 2 && arg_evals == 2;
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 131;
+
+    char where[64], want[160];
+    snprintf(where, sizeof where, "<test_c-log.c:%d> ", prefix_site_line);
+    int ok = count_substr(out, where) == 6 && count_substr(out, "[WARN]\t") == 6;
+    const char* exp[] = {"[net] ps 0\n", "[net] ps 1\n", "> ps 2\n", "[dyn3] ps 3\n", "[dyn4] ps 4\n"};
+    for (int i = 0; i < 5; i++) {
+        snprintf(want, sizeof want, "%s%s", where, exp[i][0] == '>' ? "" : exp[i]);
+        ok &= exp[i][0] == '>' ? contains(out, exp[i]) : contains(out, want);
+    }
+    /* groups longer than the prefix slot are clipped exactly as before */
+    snprintf(want, sizeof want, "%s[%.62sps 5\n", where, buf);
+    ok &= contains(out, want) && contains(out, "comma 1\n") && contains(out, "ternary\n") &&
+          contains(out, "loop step 2\n") && once && contains(out, "[ev] once 1\n") && contains(out, "[ev] raw once\n");
+    free(out);
+    return ok ? 0 : 132;
+}
+
+static int test_raw_payload(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 140;
+
+    static char big[3 * CLOG_LINE_MAX];
+    for (size_t i = 0; i < sizeof big; i++) big[i] = (char)('a' + i % 26);
+    big[sizeof big - 1] = 'Z';
+    const char json[]   = "{\"k\":1}\n";
+
+    clog_set_level(CLOG_INFO);
+    int raw_line = __LINE__ + 1;
+    log_raw(CLOG_WARN, "blob", big, sizeof big);
+    log_raw(CLOG_INFO, NULL, json, sizeof json - 1);
+    log_raw(CLOG_DEBUG, NULL, json, sizeof json - 1);
+    /* one site, two levels: each record carries its own level, not the one the site first cached */
+    static const clog_level lv[] = {CLOG_WARN, CLOG_ERROR, CLOG_WARN};
+    for (int i = 0; i < 3; i++) log_raw(lv[i], "lv", i == 1 ? "second" : "other", i == 1 ? 6 : 5);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 141;
+
+    char head[64];
+    snprintf(head, sizeof head, "<test_c-log.c:%d> [blob] abcdef", raw_line);
+    const char* b  = strstr(out, head);
+    const char* z  = b ? strstr(b, "Z\n") : NULL;
+    /* untruncated, newline added once; trailing newline of the second payload kept as is */
+    int         ok = z && (size_t)(z - b) > sizeof big && contains(out, "> {\"k\":1}\n") &&
+             !contains(out, "{\"k\":1}\n\n") && count_char(out, '\n') == 5 && count_substr(out, "[WARN]") == 3 &&
+             count_substr(out, "[ERROR]") == 1;
+    const char* sec = strstr(out, "[lv] second\n");
+    const char* err = strstr(out, "[ERROR]");
+    ok &= sec && err && err < sec && !memchr(err, '\n', (size_t)(sec - err));
+    free(out);
+    return ok ? 0 : 142;
+}
+
+#define CLOG_GROUP_MIN_gquiet CLOG_WARN
+#define CLOG_GROUP_MIN_goff   OFF
+#define gmacro                42 /* group names are not macro-expanded */
+
+static int test_group_compile_floor(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 160;
+
+    clog_set_level(CLOG_TRACE);
+    int evals = 0;
+    log_trace_g(gnet, "gf trace %d", 1);
+    log_info_g(gquiet, "gf elided %d", ++evals);
+    log_warn_g(gquiet, "gf warn %d", 2);
+    log_fatal_g(goff, "gf off %d", ++evals);
+    log_debug_g(gmacro, "gf macro %d", 3);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 161;
+
+    /* elided statements never evaluate their arguments, whatever the runtime level */
+    int ok = evals == 0 && contains(out, "[TRACE]") && contains(out, "[gnet] gf trace 1\n") &&
+             contains(out, "[gquiet] gf warn 2\n") && contains(out, "[gmacro] gf macro 3\n") &&
+             !contains(out, "gf elided") && !contains(out, "gf off") && count_char(out, '\n') == 3;
+    free(out);
+    return ok ? 0 : 162;
+}
+
+static int test_framing_crc32c(void) {
+    if (clog_crc32c(0, "123456789", 9) != 0xE3069283u) return 180;
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 181;
+
+    clog_set_level(CLOG_INFO);
+    clog_set_framing(true);
+    log_info("framed %d", 1);
+    clog_stats_enable(true);
+    clog_stats_dump(1); /* report lines go through the same framed writes */
+    clog_stats_enable(false);
+    clog_lockstat_dump();
+    log_warn_group("fr", "framed %s", "two");
+    clog_set_framing(false);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 181;
+
+    /* frames back to back (two records and the dump lines), each CRC over exactly its payload */
+    const unsigned char* p = (const unsigned char*)out;
+    int                  frames = 0, dump = 0, ok = 1;
+    while (ok && (size_t)((const char*)p - out) + CLOG_FRAME_HDR <= n) {
+        uint32_t len = (uint32_t)p[1] | (uint32_t)p[2] << 8 | (uint32_t)p[3] << 16 | (uint32_t)p[4] << 24;
+        uint32_t crc = (uint32_t)p[5] | (uint32_t)p[6] << 8 | (uint32_t)p[7] << 16 | (uint32_t)p[8] << 24;
+        ok = p[0] == CLOG_FRAME_MARK && len <= n && clog_crc32c(0, p + CLOG_FRAME_HDR, len) == crc &&
+             p[CLOG_FRAME_HDR + len - 1] == '\n';
+        dump += ok && len > 16 && memcmp(p + CLOG_FRAME_HDR, "=== top talkers:", 16) == 0;
+        dump += ok && len > 15 && memcmp(p + CLOG_FRAME_HDR, "=== lock stats:", 15) == 0;
+        p += CLOG_FRAME_HDR + len;
+        ++frames;
+    }
+    /* headers hold NUL bytes, so compare the tail of the last payload directly */
+    const char tail[] = "> [fr] framed two\n";
+    ok &= frames >= 4 && dump == 1 + (CLOG_LOCKSTAT_THREADS > 0) && (size_t)((const char*)p - out) == n &&
+          n > sizeof tail && memcmp(out + n - (sizeof tail - 1), tail, sizeof tail - 1) == 0;
+    free(out);
+    return ok ? 0 : 182;
+}
+
+typedef struct {
+    int    calls;
+    char   msgs[4][64];
+    char   prefix[96];
+    int    line;
+    int    level;
+    int    grouped;
+    int    ts_ok;
+} sink_seen_t;
+
+static void test_sink_(const clog_record* r, void* ud) {
+    sink_seen_t* s = (sink_seen_t*)ud;
+    if (s->calls < 4) {
+        size_t n = r->msg_len < 63 ? r->msg_len : 63;
+        memcpy(s->msgs[s->calls], r->msg, n);
+        s->msgs[s->calls][n] = '\0';
+    }
+    if (s->calls == 0) {
+        size_t n = r->prefix_len < 95 ? r->prefix_len : 95;
+        memcpy(s->prefix, r->prefix, n);
+        s->prefix[n] = '\0';
+        s->line      = r->line;
+        s->level     = (int)r->level;
+        s->grouped   = r->group && strcmp(r->group, "sk") == 0;
+        s->ts_ok     = r->ts_ns > UINT64_C(1600000000) * 1000000000u && r->tid != 0;
+        s->ts_ok &= contains(r->file, "test_c-log.c");
+    }
+    s->calls++;
+    log_info("from inside a sink"); /* dropped */
+}
+
+static int test_sink_callbacks(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 230;
+
+    sink_seen_t seen;
+    memset(&seen, 0, sizeof seen);
+    clog_set_level(CLOG_INFO);
+    int added = clog_sink_add(test_sink_, &seen);
+    int line  = __LINE__ + 1;
+    log_warn_group("sk", "sink %d", 7);
+    log_debug("below the level");
+    log_raw(CLOG_INFO, NULL, "raw bytes\n", 10);
+    clog_block_begin(CLOG_INFO, NULL);
+    clog_block_line("in a block");
+    clog_block_end();
+    int removed = clog_sink_remove(test_sink_, &seen);
+    log_info("after removal");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 231;
+
+    /* the prefix in the view is exactly what went to the fd in front of the message */
+    int ok = added == 0 && removed == 0 && clog_sink_remove(test_sink_, &seen) == -1 && seen.calls == 3 &&
+             strcmp(seen.msgs[0], "sink 7") == 0 && strcmp(seen.msgs[1], "raw bytes") == 0 &&
+             strcmp(seen.msgs[2], "in a block") == 0 && seen.line == line && seen.level == CLOG_WARN &&
+             seen.grouped && seen.ts_ok && contains(seen.prefix, "[sk] ") && contains(out, seen.prefix) &&
+             !contains(out, "from inside a sink") && contains(out, "after removal");
+    free(out);
+    return ok ? 0 : 232;
+}
+
+typedef struct {
+    int     calls, removed;
+    int64_t seen;
+} sink_reenter_t;
+
+/* calls back into the API that takes the write lock, then removes itself */
+static void test_sink_reenter_(const clog_record* r, void* ud) {
+    sink_reenter_t* s = (sink_reenter_t*)ud;
+    (void)r;
+    ++s->calls;
+    clog_counter_add("test.sink", 1);
+    s->seen = clog_counter_get("test.sink");
+    clog_counters_flush();
+    s->removed = clog_sink_remove(test_sink_reenter_, ud);
+}
+
+static int test_sink_reentry(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 270;
+
+    sink_reenter_t st;
+    memset(&st, 0, sizeof st);
+    sink_seen_t seen;
+    memset(&seen, 0, sizeof seen);
+    clog_set_level(CLOG_INFO);
+    int added = clog_sink_add(test_sink_reenter_, &st) | clog_sink_add(test_sink_, &seen);
+    log_info("reenter %d", 1);
+    log_info("reenter %d", 2);
+    int gone = clog_sink_remove(test_sink_reenter_, &st); /* already removed by itself */
+    clog_sink_remove(test_sink_, &seen);
+    clog_counters_flush(); /* the one from inside the sink could not write: its change is reported here */
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 271;
+
+    /* no deadlock; the sink behind the removed one still saw both records */
+    int ok = added == 0 && st.calls == 1 && st.removed == 0 && st.seen == 1 && gone == -1 && seen.calls == 2 &&
+             strcmp(seen.msgs[1], "reenter 2") == 0 && count_substr(out, "reenter ") == 2 &&
+             contains(out, " s: test.sink=1\n");
+    free(out);
+    return ok ? 0 : 272;
+}
+
+static int test_filter_expressions(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 240;
+
+    clog_set_level(CLOG_INFO);
+    int bad = clog_set_filter("level>=debug &&") == -1 && clog_set_filter("group<\"db\"") == -1 &&
+              clog_set_filter("level=loud") == -1 && clog_set_filter("(line>1") == -1;
+    int set = clog_set_filter("level>=debug && group~\"db*\" && file=\"test_c-log.c\"");
+    for (int pass = 0; pass < 2; pass++) {
+        log_debug_group("dbpool", "pool debug %d", pass);
+        log_debug_group("net", "net debug %d", pass);
+        log_trace_group("db", "db trace %d", pass);
+        log_debug("plain debug %d", pass);
+        /* a new filter invalidates the verdicts the sites above remember */
+        if (pass == 0) set |= clog_set_filter("!(group = dbpool) && (level == trace || file != other.c)");
+    }
+    set |= clog_set_filter(NULL);
+    log_debug_group("dbpool", "after clearing");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 241;
+    int ok = bad && set == 0 && contains(out, "[dbpool] pool debug 0") && !contains(out, "net debug 0") &&
+             !contains(out, "db trace 0") && !contains(out, "plain debug 0") && !contains(out, "pool debug 1") &&
+             contains(out, "[net] net debug 1") && contains(out, "[db] db trace 1") && contains(out, "plain debug 1") &&
+             !contains(out, "after clearing");
+    free(out);
+    return ok ? 0 : 242;
+}
+
+/* one site reached at two levels keeps a verdict per level; siteless calls evaluate the filter too */
+static int test_filter_site_level(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 243;
+
+    clog_set_level(CLOG_INFO);
+    int set = clog_set_filter("level == trace && group = memo");
+    for (int i = 0; i < 4; i++) log_raw(i % 2 ? CLOG_DEBUG : CLOG_TRACE, i < 2 ? "memo" : "other", "memo raw\n", 9);
+    for (int i = 0; i < 2; i++) {
+        clog_block_begin(i ? CLOG_DEBUG : CLOG_TRACE, "memo");
+        clog_block_line("memo block %d", i);
+        clog_block_end();
+    }
+    set |= clog_set_filter(NULL);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 244;
+    int ok = set == 0 && count_substr(out, "memo raw") == 1 && contains(out, "memo block 0") &&
+             !contains(out, "memo block 1");
+    free(out);
+    return ok ? 0 : 245;
+}
+
+/* a block is filtered on the file and line of its clog_block_begin */
+static int test_filter_block_site(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 246;
+
+    clog_set_level(CLOG_INFO);
+    int set = clog_set_filter("level>=debug && file=\"test_c-log.c\"");
+    clog_block_begin(CLOG_DEBUG, "cfg");
+    clog_block_line("file block in");
+    clog_block_end();
+    set |= clog_set_filter("level>=debug && file!=\"test_c-log.c\"");
+    clog_block_begin(CLOG_DEBUG, "cfg");
+    clog_block_line("file block out");
+    clog_block_end();
+    char expr[48];
+    snprintf(expr, sizeof expr, "level>=debug && line==%d", __LINE__ + 2); /* the clog_block_begin below */
+    set |= clog_set_filter(expr);
+    clog_block_begin(CLOG_DEBUG, NULL);
+    clog_block_line("line block in");
+    clog_block_end();
+    set |= clog_set_filter(NULL);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 247;
+    int ok = set == 0 && contains(out, "file block in") && !contains(out, "file block out") &&
+             contains(out, "line block in");
+    free(out);
+    return ok ? 0 : 248;
+}
+
+#if !defined(_WIN32)
+static int test_time_index_seek(void) {
+    char log_path[] = "/tmp/c-log-test-XXXXXX", idx_path[] = "/tmp/c-log-idx-XXXXXX";
+    int  lfd = mkstemp(log_path), ifd = mkstemp(idx_path);
+    if (lfd < 0 || ifd < 0) return 120;
+
+    int saved = clog_get_fd();
+    clog_set_fd(lfd);
+    clog_set_level(CLOG_INFO);
+    clog_set_index_fd(ifd, 2);
+    for (int i = 0; i < 5; i++) log_info("indexed %d", i);
+    /* another writer appends, then records go through a fresh O_APPEND fd whose own offset is still 0 */
+    int afd = open(log_path, O_WRONLY | O_APPEND), ofd = open(log_path, O_WRONLY | O_APPEND);
+    if (afd < 0 || ofd < 0 || write(ofd, "foreign\n", 8) != 8) return 120;
+    clog_set_fd(afd);
+    log_info("appended");
+    clog_set_index_fd(-1, 0);
+    clog_set_fd(saved);
+    close(afd);
+    close(ofd);
+
+    int64_t first = clog_index_seek(ifd, 0);
+    int64_t last  = clog_index_seek(ifd, UINT64_MAX);
+    off_t   isz   = lseek(ifd, 0, SEEK_END);
+    char    buf[256];
+    ssize_t r = last > 0 ? pread(lfd, buf, sizeof buf - 1, (off_t)last) : -1;
+    if (r > 0) buf[r] = '\0';
+
+    close(lfd);
+    close(ifd);
+    unlink(log_path);
+    unlink(idx_path);
+    /* entries at records 0, 2 and 4 (more if the second rolled over) and at the appended record, where the last
+       one starts */
+    int ok = first == 0 && isz >= 16 + 4 * 16 && r > 0 && buf[0] == '2' && contains(buf, "> appended\n") &&
+             !contains(buf, "foreign");
+    return ok ? 0 : 121;
+}
+
+#if CLOG_RECORD
+static int test_workload_recorder(void) {
+    char path[] = "/tmp/c-log-rec-XXXXXX";
+    int  fd     = mkstemp(path);
+    if (fd < 0) return 150;
+
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 150;
+    clog_set_level(CLOG_INFO);
+    int started = clog_record_start(fd);
+    for (int i = 0; i < 2; i++) log_info("rec %d", i * 100);
+    log_debug("rec %s", "quiet");
+    unsigned dropped = clog_record_stop();
+    size_t   n       = 0;
+    char*    out     = cap_end(&cap, &n);
+    free(out);
+
+    unsigned char buf[512];
+    ssize_t       r = pread(fd, buf, sizeof buf, 0);
+    close(fd);
+    unlink(path);
+    if (started != 0 || dropped != 0 || r < 8 || memcmp(buf, "CLOGREC1", 8) != 0) return 151;
+
+    /* walk the entries: two sites, three records; only the debug one was suppressed */
+    int     sites = 0, recs = 0, emitted = 0;
+    uint8_t nargs[4] = {0};
+    for (size_t off = 8; off < (size_t)r;) {
+        if (buf[off] == 'S' && sites < 4) {
+            off += 1 + 2 + 4;
+            for (int k = 0; k < 3; k++) {
+                uint16_t len;
+                memcpy(&len, buf + off, sizeof len);
+                off += 2 + len;
+            }
+            nargs[sites++] = buf[off];
+            off += 1u + (buf[off] == 0xff ? 0u : buf[off]);
+        } else if (buf[off] == 'R') {
+            uint16_t id;
+            memcpy(&id, buf + off + 1, sizeof id);
+            if (id >= sites) return 152;
+            emitted |= buf[off + 5] << recs++;
+            off += 10 + 2u * nargs[id];
+        } else {
+            return 152;
+        }
+    }
+    return sites == 2 && recs == 3 && emitted == 3 && nargs[0] == 1 && nargs[1] == 1 ? 0 : 152;
+}
+
+#endif
+
+typedef struct {
+    uint64_t wall, mono;
+} vclock_t;
+
+static uint64_t vclock_wall_(void* ud) { return ((vclock_t*)ud)->wall; }
+static uint64_t vclock_mono_(void* ud) { return ((vclock_t*)ud)->mono; }
+
+static int test_clock_provider(void) {
+    vclock_t   vc  = {UINT64_C(1757067300123000000), 1000}; /* 2025-09-05 10:15:00.123 UTC */
+    clog_clock clk = {vclock_wall_, vclock_mono_, &vc};
+    if (clog_set_clock(CLOG_CLOCK_USER, NULL) != -1 || clog_get_clock() != CLOG_CLOCK_SYSTEM) return 220;
+
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 221;
+    clog_set_level(CLOG_DEBUG);
+    int set = clog_set_clock(CLOG_CLOCK_USER, &clk);
+    log_info("virtual %d", 1);
+    clog_start_time("vclock");
+    vc.mono += 250;
+    clog_end_time("vclock");
+    clog_set_clock(CLOG_CLOCK_SYSTEM, NULL);
+    clog_set_level(CLOG_INFO);
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 221;
+
+    /* the timestamp is the virtual wall time rendered like any other; the timer measures virtual ns exactly */
+    time_t    sec = (time_t)(vc.wall / 1000000000u);
+    struct tm tmv;
+#if CLOG_TIME_UTC
+    gmtime_r(&sec, &tmv);
+#else
+    localtime_r(&sec, &tmv);
+#endif
+    char want[32];
+    strftime(want, sizeof want, "%Y-%m-%d %H:%M:%S.123 [INFO]", &tmv);
+    int ok = set == 0 && strncmp(out, want, strlen(want)) == 0 && contains(out, "[250 ns]: vclock") &&
+             clog_get_clock() == CLOG_CLOCK_SYSTEM;
+    free(out);
+    return ok ? 0 : 222;
+}
+
+static int test_shared_append(void) {
+    char path[] = "/tmp/c-log-shared-XXXXXX";
+    int  tmp    = mkstemp(path);
+    if (tmp < 0) return 210;
+    close(tmp);
+
+    int saved = clog_get_fd();
+    int fd    = clog_open_shared(path, false);
+    if (fd < 0) return 211;
+    clog_set_level(CLOG_INFO);
+    /* four processes append concurrently; each record is one write, so no line is ever split */
+    for (int c = 0; c < 4; c++) {
+        if (fork() == 0) {
+            for (int i = 0; i < 300; i++) log_info("child %d line %d", c, i);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {}
+    /* a block longer than CLOG_SHARED_CHUNK goes out as chunk records */
+    clog_block_begin(CLOG_INFO, "big");
+    char dots[91];
+    memset(dots, '.', sizeof dots - 1);
+    dots[sizeof dots - 1] = '\0';
+    for (int i = 0; i < 40; i++) clog_block_line("row %02d %s", i, dots);
+    clog_block_end();
+    clog_set_fd(saved);
+    close(fd);
+
+    FILE* f = fopen(path, "rb");
+    unlink(path);
+    if (!f) return 212;
+    static char buf[1 << 17];
+    size_t      n = fread(buf, 1, sizeof buf - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    int   lines = 0, bad = 0, chunks = 0, rows = 0;
+    char* joined = malloc(n + 1);
+    size_t jl = 0;
+    for (char* p = buf; p < buf + n;) {
+        if (*p == CLOG_SHARED_MARK) {
+            long     pid;
+            unsigned id, k, cnt;
+            size_t   len;
+            int      h = 0;
+            if (sscanf(p + 1, "%ld.%u.%u/%u.%zu %n", &pid, &id, &k, &cnt, &len, &h) != 5 || k != (unsigned)chunks ||
+                p[1 + (size_t)h + len] != '\n' || len > CLOG_SHARED_CHUNK) {
+                bad++;
+                break;
+            }
+            memcpy(joined + jl, p + 1 + (size_t)h, len);
+            jl += len;
+            chunks++;
+            p += 1 + (size_t)h + len + 1;
+            continue;
+        }
+        char* nl = strchr(p, '\n');
+        if (!nl) break;
+        *nl = '\0';
+        if (contains(p, "> child ")) lines++;
+        else bad++;
+        p = nl + 1;
+    }
+    joined[jl] = '\0';
+    rows       = count_substr(joined, "row ");
+    int ok     = lines == 1200 && bad == 0 && chunks >= 2 && rows == 40 && contains(joined, "row 39 ....");
+    free(joined);
+    /* the shared sequence counter needs CLOG_WITH_SEQ */
+    if (!CLOG_WITH_SEQ && clog_open_shared(path, true) != -1) ok = 0;
+    return ok ? 0 : 213;
+}
+#endif
+
 #if !defined(_WIN32) && CLOG_THREAD_SAFE
     #include <pthread.h>
 typedef struct {
@@ -257,6 +1032,388 @@ static int test_thread_safety_lines_not_split(void) {
     free(out);
     return ok ? 0 : 52;
 }
+
+static void* level_leaver_(void* a) {
+    (void)a;
+    clog_thread_set_level(CLOG_TRACE);  // never cleared: the thread-exit callback drops it from the gate
+    log_trace("leaver trace");
+    return NULL;
+}
+
+static int test_thread_level_exit(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 250;
+
+    clog_set_level(CLOG_INFO);
+    pthread_t th;
+    pthread_create(&th, NULL, level_leaver_, NULL);
+    pthread_join(th, NULL);
+    int gate = clog_lvl_gate_;
+    log_debug("main debug (should NOT appear)");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 251;
+
+    int ok = gate == CLOG_INFO && contains(out, "leaver trace") && !contains(out, "should NOT appear");
+    free(out);
+    return ok ? 0 : 252;
+}
+
+static void* capture_leaver_(void* a) {
+    (void)a;
+    clog_capture_begin();  // never committed: the thread-exit callback discards it and restores the gate
+    log_debug("leaver captured");
+    return NULL;
+}
+
+static int test_capture_thread_exit(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 253;
+
+    clog_set_level(CLOG_INFO);
+    pthread_t th;
+    pthread_create(&th, NULL, capture_leaver_, NULL);
+    pthread_join(th, NULL);
+    int gate = clog_lvl_gate_;
+    log_debug("main debug (should NOT appear)");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 254;
+
+    int ok = gate == CLOG_INFO && !contains(out, "leaver captured") && !contains(out, "should NOT appear");
+    free(out);
+    return ok ? 0 : 255;
+}
+
+static int stats_thread_line;
+static void* stats_thread_(void* a) {
+    (void)a;
+    stats_thread_line = __LINE__ + 1;
+    log_info("short-lived");
+    return NULL;
+}
+
+static int test_stats_thread_reuse(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 260;
+
+    /* more threads than tables, one at a time: each exiting thread hands its table to the next */
+    clog_set_level(CLOG_INFO);
+    clog_stats_enable(true);
+    enum { T = CLOG_STATS_THREADS + 4 };
+    for (int i = 0; i < T; i++) {
+        pthread_t th;
+        pthread_create(&th, NULL, stats_thread_, NULL);
+        pthread_join(th, NULL);
+    }
+    clog_stats_enable(false);
+    clog_stats_dump(0);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 261;
+
+    char site[64];
+    snprintf(site, sizeof site, "  test_c-log.c:%d\n", stats_thread_line);
+    const char* row = strstr(out, site);
+    while (row && row > out && row[-1] != '\n') --row;
+    int ok = row && strtol(row, NULL, 10) == T && !contains(out, "untracked");
+    free(out);
+    return ok ? 0 : 262;
+}
+
+static pthread_mutex_t lock_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static void* lock_waiter_(void* a) {
+    (void)a;
+    CLOG_MUTEX_LOCK(&lock_mu, "cache");
+    CLOG_MUTEX_UNLOCK(&lock_mu, "cache");
+    return NULL;
+}
+
+static int test_lock_instrumentation(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 190;
+
+    clog_set_level(CLOG_INFO);
+    clog_lockstat_set_outliers(1000000, 5000000);
+    for (int i = 0; i < 3; i++) {
+        CLOG_MUTEX_LOCK(&lock_mu, "cache");
+        CLOG_MUTEX_UNLOCK(&lock_mu, "cache");
+    }
+    /* held for ~30 ms while another thread waits for it: one hold and one wait outlier */
+    CLOG_MUTEX_LOCK(&lock_mu, "cache");
+    pthread_t th;
+    pthread_create(&th, NULL, lock_waiter_, NULL);
+    sleep_ms_(30);
+    CLOG_MUTEX_UNLOCK(&lock_mu, "cache");
+    pthread_join(th, NULL);
+    /* thresholds are 64-bit: 2^32 + 1 ms must not wrap to 1 ms */
+    clog_lockstat_set_outliers(UINT64_C(4295967296), UINT64_C(4295967296));
+    CLOG_MUTEX_LOCK(&lock_mu, "cache");
+    sleep_ms_(5);
+    CLOG_MUTEX_UNLOCK(&lock_mu, "cache");
+    clog_lockstat_dump();
+    clog_lockstat_set_outliers(CLOG_LOCKSTAT_WAIT_NS, CLOG_LOCKSTAT_HOLD_NS);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 191;
+
+    const char* dump = strstr(out, "=== lock stats: 1 label(s), 2 thread table(s) ===");
+    int         ok   = dump && contains(dump, "\n         6 ") && contains(dump, " ms  cache\n") &&
+               count_substr(out, "[WARN]") == 2 && count_substr(out, "[lock] held ") == 1 &&
+               count_substr(out, "[lock] waited ") == 1 && contains(out, " ms for cache\n");
+    free(out);
+    return ok ? 0 : 192;
+}
+
+static void* lock_pool_thread_(void* a) {
+    (void)a;
+    CLOG_MUTEX_LOCK(&lock_mu, "reuse");
+    CLOG_MUTEX_UNLOCK(&lock_mu, "reuse");
+    return NULL;
+}
+
+static int test_lock_thread_reuse(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 193;
+
+    /* more threads than tables, one at a time: each exiting thread hands its table to the next */
+    clog_set_level(CLOG_INFO);
+    enum { T = CLOG_LOCKSTAT_THREADS + 4 };
+    for (int i = 0; i < T; i++) {
+        pthread_t th;
+        pthread_create(&th, NULL, lock_pool_thread_, NULL);
+        pthread_join(th, NULL);
+    }
+    clog_lockstat_dump();
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 194;
+
+    const char* row = strstr(out, "  reuse\n");
+    while (row && row > out && row[-1] != '\n') --row;
+    int ok = row && strtol(row, NULL, 10) == T && !contains(out, "untracked");
+    free(out);
+    return ok ? 0 : 195;
+}
+
+static void* counter_thread_(void* a) {
+    (void)a;
+    for (int i = 0; i < 3; i++) clog_counter_add("test.hit", 1);
+    return NULL;
+}
+
+static int test_named_counters(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 200;
+
+    clog_set_level(CLOG_INFO);
+    for (int i = 0; i < 2; i++) clog_counter_add("test.hit", 1);
+    clog_counter_add("test.miss", 5);
+    pthread_t th;
+    pthread_create(&th, NULL, counter_thread_, NULL);
+    pthread_join(th, NULL);
+    int64_t hits = clog_counter_get("test.hit");
+    clog_counters_flush(); /* hit=5 miss=5 */
+    clog_counters_flush(); /* nothing changed: no line */
+    clog_counter_add("test.miss", -2);
+    clog_set_level(CLOG_WARN);
+    clog_counters_flush(); /* dropped by the level: the change waits for the next flush */
+    clog_set_level(CLOG_INFO);
+    clog_counters_flush(); /* miss=-2 */
+
+    /* periodic: the first add after the interval has passed (checked every 256 adds per thread) flushes */
+    clog_counters_set_interval(1);
+    sleep_ms_(5);
+    for (int i = 0; i < 256; i++) clog_counter_add("test.tick", 1);
+    /* a thread that adds rarely: the next record written after the interval flushes */
+    clog_counter_add("test.slow", 1);
+    sleep_ms_(5);
+    log_info("counters poll");
+    clog_counters_set_interval(0);
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 201;
+
+    int ok = hits == 5 && clog_counter_get("test.miss") == 3 && clog_counter_get("nope") == 0 &&
+             count_substr(out, "[counters] ") == 4 && contains(out, " s: test.hit=5 test.miss=5\n") &&
+             contains(out, " s: test.miss=-2\n") && contains(out, "test.tick=") &&
+             contains(out, "counters poll\n") && contains(out, " test.slow=1\n") && count_char(out, '\n') == 5;
+    free(out);
+    return ok ? 0 : 202;
+}
+
+static void* counter_pool_thread_(void* a) {
+    (void)a;
+    clog_counter_add("test.pool", 1);
+    return NULL;
+}
+
+static int test_counter_thread_reuse(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 206;
+
+    /* more threads than tables, one at a time: each exit folds its slots into the shared set and frees the table */
+    clog_set_level(CLOG_INFO);
+    enum { T = CLOG_COUNTER_THREADS + 4 };
+    for (int i = 0; i < T; i++) {
+        pthread_t th;
+        pthread_create(&th, NULL, counter_pool_thread_, NULL);
+        pthread_join(th, NULL);
+    }
+    clog_counter_add("test.pool", 1);
+    int64_t v = clog_counter_get("test.pool");
+    clog_counters_flush();
+    clog_counters_flush(); /* folded counts are not reported twice */
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 207;
+
+    char want[48];
+    snprintf(want, sizeof want, " s: test.pool=%d\n", T + 1);
+    int ok = v == T + 1 && contains(out, want) && count_substr(out, "[counters] ") == 1;
+    free(out);
+    return ok ? 0 : 208;
+}
+
+/* computed names are copied: the caller's buffer can be reused right after registering */
+static int test_counter_computed_names(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 203;
+
+    clog_set_level(CLOG_INFO);
+    char name[CLOG_COUNTER_NAME_MAX + 8];
+    int  ids[2];
+    for (int i = 0; i < 2; i++) {
+        snprintf(name, sizeof name, "test.shard%d", i);
+        ids[i] = clog_counter_register(name);
+    }
+    memset(name, 'x', sizeof name - 1);
+    name[sizeof name - 1] = '\0';
+    int too_long = clog_counter_register(name);
+    strcpy(name, "scribbled");
+    clog_counter_add_id(ids[0], 2);
+    clog_counter_add_id(ids[1], 3);
+    int64_t v = clog_counter_get("test.shard1");
+    clog_counters_flush();
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 204;
+
+    int ok = ids[0] >= 0 && ids[1] > ids[0] && too_long == -1 && v == 3 &&
+             contains(out, " s: test.shard0=2 test.shard1=3\n") && !contains(out, "scribbled");
+    free(out);
+    return ok ? 0 : 205;
+}
+#endif
+
+#if !defined(_WIN32) && CLOG_THREAD_SAFE && CLOG_WITH_SEQ
+static unsigned long long seq_of_(const char* line) {
+    const char* h = strstr(line, ") #");
+    return h ? strtoull(h + 3, NULL, 10) : ~0ull;
+}
+
+static void* seq_other_thread_(void* a) {
+    (void)a;
+    log_info("seq other");
+    return NULL;
+}
+
+static int test_record_sequence(void) {
+    set_no_color_();
+    cap_t cap;
+    if (cap_begin(&cap) != 0) return 170;
+
+    clog_set_level(CLOG_INFO);
+    log_info("seq a");
+    log_info("seq b");
+    pthread_t th;
+    pthread_create(&th, NULL, seq_other_thread_, NULL);
+    pthread_join(th, NULL);
+    log_info("seq c");
+
+    size_t n   = 0;
+    char*  out = cap_end(&cap, &n);
+    if (!out) return 171;
+
+    const char *a = strstr(out, "seq a"), *b = strstr(out, "seq b"), *c = strstr(out, "seq c");
+    const char *o = strstr(out, "seq other");
+    if (!a || !b || !c || !o) {
+        free(out);
+        return 172;
+    }
+    /* find the start of each line, then its number */
+    const char* lines[4] = {a, b, c, o};
+    unsigned long long s[4];
+    for (int i = 0; i < 4; i++) {
+        while (lines[i] > out && lines[i][-1] != '\n') --lines[i];
+        s[i] = seq_of_(lines[i]);
+    }
+    /* consecutive within this thread's lease; the other thread stamps from a block of its own */
+    int ok = s[1] == s[0] + 1 && s[2] == s[1] + 1 && s[3] / CLOG_SEQ_LEASE != s[0] / CLOG_SEQ_LEASE;
+    free(out);
+    return ok ? 0 : 173;
+}
+
+    #if defined(__GNUC__) || defined(__clang__) /* the shared counter needs GCC atomics */
+static int test_record_sequence_fork(void) {
+    char path[] = "/tmp/c-log-seqfork-XXXXXX";
+    int  tmp    = mkstemp(path);
+    if (tmp < 0) return 175;
+    close(tmp);
+
+    int saved = clog_get_fd();
+    if (clog_open_shared(path, true) < 0) return 175;
+    clog_set_level(CLOG_INFO);
+    log_info("fork parent a");
+    if (fork() == 0) {
+        log_info("fork child"); /* must not reuse the rest of the parent's lease */
+        _exit(0);
+    }
+    while (wait(NULL) > 0) {}
+    log_info("fork parent b");
+    int fd = clog_get_fd();
+    clog_set_fd(saved);
+    close(fd);
+
+    char    buf[1024];
+    FILE*   f = fopen(path, "rb");
+    size_t  n = f ? fread(buf, 1, sizeof buf - 1, f) : 0;
+    if (f) fclose(f);
+    char seq_path[sizeof path + 4];
+    snprintf(seq_path, sizeof seq_path, "%s.seq", path);
+    unlink(path);
+    unlink(seq_path);
+    buf[n] = '\0';
+
+    const char* lines[3] = {strstr(buf, "fork parent a"), strstr(buf, "fork child"), strstr(buf, "fork parent b")};
+    unsigned long long s[3];
+    for (int i = 0; i < 3; i++) {
+        if (!lines[i]) return 176;
+        while (lines[i] > buf && lines[i][-1] != '\n') --lines[i];
+        s[i] = seq_of_(lines[i]);
+    }
+    /* the parent goes on in its lease; the child took a block of its own from the shared counter */
+    int ok = s[2] == s[0] + 1 && s[1] / CLOG_SEQ_LEASE != s[0] / CLOG_SEQ_LEASE && s[1] != ~0ull;
+    return ok ? 0 : 177;
+}
+    #endif
 #endif
 
 int main(void) {
@@ -265,8 +1422,45 @@ int main(void) {
     rc |= test_group_and_fileline();
     rc |= test_timer_line_and_callsite();
     rc |= test_newline_integrity();
+    rc |= test_vlevels_and_vmodule();
+    rc |= test_block_contiguous();
+    rc |= test_capture_commit_discard();
+    rc |= test_thread_level_override();
+    rc |= test_load_shedding();
+    rc |= test_stats_top_talkers();
+    rc |= test_prefix_cache_per_site();
+    rc |= test_raw_payload();
+    rc |= test_group_compile_floor();
+    rc |= test_framing_crc32c();
+    rc |= test_sink_callbacks();
+    rc |= test_sink_reentry();
+    rc |= test_filter_expressions();
+    rc |= test_filter_site_level();
+    rc |= test_filter_block_site();
+#if !defined(_WIN32)
+    rc |= test_time_index_seek();
+    #if CLOG_RECORD
+    rc |= test_workload_recorder();
+    #endif
+    rc |= test_clock_provider();
+    rc |= test_shared_append();
+#endif
 #if !defined(_WIN32) && CLOG_THREAD_SAFE
     rc |= test_thread_safety_lines_not_split();
+    rc |= test_thread_level_exit();
+    rc |= test_capture_thread_exit();
+    rc |= test_stats_thread_reuse();
+    rc |= test_lock_instrumentation();
+    rc |= test_lock_thread_reuse();
+    rc |= test_named_counters();
+    rc |= test_counter_computed_names();
+    rc |= test_counter_thread_reuse();
+#endif
+#if !defined(_WIN32) && CLOG_THREAD_SAFE && CLOG_WITH_SEQ
+    rc |= test_record_sequence();
+    #if defined(__GNUC__) || defined(__clang__)
+    rc |= test_record_sequence_fork();
+    #endif
 #endif
 
     if (rc) {
@@ -0,0 +1,178 @@
+// c-log-archive — convert c-log text output into a columnar archive and query it.
+//
+//   c-log-archive pack [-r ROWS] [-n] OUT LOG...
+//   c-log-archive query [-l LEVEL] [-g GLOB] [-f GLOB] [-t TID] [-s TIME] [-u TIME] [-c] [-v] ARCHIVE
+//
+// pack parses the fixed prefix of every record (see c-log-grep) into per-column encodings and writes row groups
+// of ROWS records (src/c-log-archive.h describes the layout); "-" reads standard input. query skips row groups by
+// their time and level statistics and their dictionaries, and decompresses the messages of a group only when one
+// of its rows matched. Matches are printed as c-log lines.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "c-log-archive.h"  // impl compiled in src/c-log-archive-impl.c
+
+static const char *const k_levels[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+static int pack_file(clog_archive *a, const char *path, size_t *bytes) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "c-log-archive: %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+    char   *line = NULL;
+    size_t  cap  = 0;
+    ssize_t n;
+    int     rc = 0;
+    while ((n = getline(&line, &cap, f)) > 0) {
+        *bytes += (size_t)n;
+        if (line[n - 1] == '\n') --n;
+        if (clog_archive_add_line(a, line, (size_t)n) < 0) {
+            fprintf(stderr, "c-log-archive: write failed: %s\n", strerror(errno));
+            rc = 2;
+            break;
+        }
+    }
+    if (ferror(f)) rc = 2;
+    free(line);
+    if (f != stdin) fclose(f);
+    return rc;
+}
+
+static int pack(int argc, char **argv) {
+    unsigned rows     = 0;
+    bool     compress = true;
+    int      opt;
+    while ((opt = getopt(argc, argv, "r:n")) != -1) {
+        switch (opt) {
+            case 'r': rows = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'n': compress = false; break;
+            default: return -1;
+        }
+    }
+    if (argc - optind < 2) return -1;
+    clog_archive *a = clog_archive_create(argv[optind], rows, compress);
+    if (!a) {
+        fprintf(stderr, "c-log-archive: %s: %s\n", argv[optind], strerror(errno));
+        return 2;
+    }
+    size_t in = 0;
+    int    rc = 0;
+    for (int i = optind + 1; i < argc && !rc; i++) rc = pack_file(a, argv[i], &in);
+    clog_archive_stats st;
+    if (clog_archive_close(a, &st) != 0) {
+        fprintf(stderr, "c-log-archive: %s: write failed\n", argv[optind]);
+        return 2;
+    }
+    FILE *f   = fopen(argv[optind], "rb");
+    long  out = -1;
+    if (f && fseek(f, 0, SEEK_END) == 0) out = ftell(f);
+    if (f) fclose(f);
+    fprintf(stderr, "%llu records in %llu row groups, %zu -> %ld bytes\n", (unsigned long long)st.rows,
+            (unsigned long long)st.groups, in, out);
+    return rc;
+}
+
+static int print_row(void *ud, const clog_archive_row *r) {
+    (void)ud;
+    char ts[24];
+    clog_archive_format_time(r->ts_ms, ts);
+    printf("%s [%s]\t", ts, k_levels[r->level]);
+    if (*r->tid) printf("(%s) ", r->tid);
+    printf("<%s:%u> ", r->file, r->line);
+    if (*r->group) printf("[%s] ", r->group);
+    fwrite(r->msg, 1, r->msg_len, stdout);
+    putchar('\n');
+    return ferror(stdout) ? 2 : 0;
+}
+
+static int query(int argc, char **argv) {
+    clog_archive_query q;
+    clog_archive_query_init(&q);
+    bool count_only = false, verbose = false;
+    int  opt;
+    while ((opt = getopt(argc, argv, "l:g:f:t:s:u:cv")) != -1) {
+        switch (opt) {
+            case 'l': {
+                int lvl = -1;
+                for (int i = 0; i < 6; i++)
+                    if (strcasecmp(optarg, k_levels[i]) == 0) lvl = i;
+                if (lvl < 0) {
+                    fprintf(stderr, "c-log-archive: unknown level '%s'\n", optarg);
+                    return 2;
+                }
+                q.min_level = (clog_level)lvl;
+                break;
+            }
+            case 'g': q.group = optarg; break;
+            case 'f': q.file = optarg; break;
+            case 't': q.tid = optarg; break;
+            case 's':
+            case 'u': {
+                int64_t ms = clog_archive_parse_time(optarg, opt == 'u');
+                if (ms < 0) {
+                    fprintf(stderr, "c-log-archive: bad time '%s'\n", optarg);
+                    return 2;
+                }
+                *(opt == 's' ? &q.since_ms : &q.until_ms) = ms;
+                break;
+            }
+            case 'c': count_only = true; break;
+            case 'v': verbose = true; break;
+            default: return -1;
+        }
+    }
+    if (argc - optind != 1) return -1;
+    clog_archive_stats st;
+    int                rc = clog_archive_scan(argv[optind], &q, count_only ? NULL : print_row, NULL, &st);
+    if (rc < 0) {
+        fprintf(stderr, "c-log-archive: %s: not a readable archive\n", argv[optind]);
+        return 2;
+    }
+    if (count_only) printf("%llu\n", (unsigned long long)st.matches);
+    fflush(stdout);
+    if (verbose)
+        fprintf(stderr, "%llu of %llu rows matched; read %llu of %llu row groups, %llu message chunks\n",
+                (unsigned long long)st.matches, (unsigned long long)st.rows, (unsigned long long)st.groups_read,
+                (unsigned long long)st.groups, (unsigned long long)st.blobs_read);
+    return rc ? rc : st.matches ? 0 : 1;
+}
+
+static void usage(void) {
+    fputs(
+        "usage: c-log-archive pack [-r ROWS] [-n] OUT LOG...\n"
+        "       c-log-archive query [options] ARCHIVE\n"
+        "pack:\n"
+        "  -r ROWS    records per row group (default 65536)\n"
+        "  -n         store messages uncompressed\n"
+        "query:\n"
+        "  -l LEVEL   minimum level: TRACE DEBUG INFO WARN ERROR FATAL\n"
+        "  -g GLOB    group glob\n"
+        "  -f GLOB    file glob, matched against the basename\n"
+        "  -t TID     thread id as printed\n"
+        "  -s TIME    since \"YYYY-MM-DD[ HH[:MM[:SS[.mmm]]]]\"\n"
+        "  -u TIME    until (inclusive at the given precision)\n"
+        "  -c         print only the number of matching records\n"
+        "  -v         report how many row groups were read\n",
+        stderr
+    );
+}
+
+int main(int argc, char **argv) {
+    int rc = -1;
+    if (argc >= 2 && strcmp(argv[1], "pack") == 0) rc = pack(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "query") == 0) rc = query(argc - 1, argv + 1);
+    else if (argc >= 2 && strcmp(argv[1], "-h") == 0) rc = (usage(), 0);
+    if (rc < 0) {
+        usage();
+        return 2;
+    }
+    return rc;
+}
@@ -0,0 +1,409 @@
+// c-log-grep — parallel search over c-log text files.
+//
+// Files are mmapped and processed in rounds of CHUNK bytes per thread, split at line boundaries. Every
+// thread collects its matches in a private buffer and the buffers are written in chunk order, so output
+// keeps file order. Field filters work on the fixed prefix written by clog_write_prefix_:
+//
+//   YYYY-MM-DD HH:MM:SS.mmm [LEVEL]\t[build:x] (tid:N) #seq <file:line> [group] message
+//
+// The substring search runs over the whole chunk (SSE2/NEON first+last byte filter, memchr fallback);
+// only lines containing a hit in their message are parsed.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+#endif
+
+#define CHUNK ((size_t)32 << 20)
+#define TS_LEN 23 /* "YYYY-MM-DD HH:MM:SS.mmm" */
+
+typedef struct {
+    const char *pat;
+    size_t      pat_len;
+    int         min_lvl;
+    const char *group_glob;
+    const char *file_glob;
+    long long   tid;
+    const char *since, *until; /* timestamp prefixes, compared lexicographically */
+    bool        count_only;
+    bool        invert;
+} opts_t;
+
+typedef struct {
+    const char *ts;
+    int         lvl;
+    long long   tid; /* -1 when absent */
+    const char *file;
+    size_t      file_len;
+    const char *group;
+    size_t      group_len;
+    const char *msg; /* start of the message; end is the line end */
+} rec_t;
+
+typedef struct {
+    char  *p;
+    size_t len, cap;
+} outbuf_t;
+
+typedef struct {
+    const opts_t *o;
+    const char   *beg, *end;
+    outbuf_t      out;
+    size_t        matches;
+    pthread_t     th;
+    bool          threaded;
+} job_t;
+
+static const char *const k_levels[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+// ---------- substring search ----------
+
+/* first occurrence of pat[0..m) in [p, end), or NULL */
+static const char *find_sub(const char *p, const char *end, const char *pat, size_t m) {
+    if (m == 0) return p;
+    if ((size_t)(end - p) < m) return NULL;
+    const char *last = end - m; /* last valid start */
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(pat[0]);
+    const __m128i tail  = _mm_set1_epi8(pat[m - 1]);
+    for (; p + 16 <= last + 1; p += 16) {
+        __m128i  a    = _mm_loadu_si128((const __m128i *)(const void *)p);
+        __m128i  b    = _mm_loadu_si128((const __m128i *)(const void *)(p + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, tail)));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(p + bit + 1, pat + 1, m - 1) == 0) return p + bit;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t first = vdupq_n_u8((uint8_t)pat[0]);
+    const uint8x16_t tail  = vdupq_n_u8((uint8_t)pat[m - 1]);
+    for (; p + 16 <= last + 1; p += 16) {
+        uint8x16_t a  = vld1q_u8((const uint8_t *)p);
+        uint8x16_t b  = vld1q_u8((const uint8_t *)(p + m - 1));
+        uint8x16_t eq = vandq_u8(vceqq_u8(a, first), vceqq_u8(b, tail));
+        if (vmaxvq_u8(eq) == 0) continue;
+        uint8_t lanes[16];
+        vst1q_u8(lanes, eq);
+        for (int i = 0; i < 16; i++)
+            if (lanes[i] && memcmp(p + i + 1, pat + 1, m - 1) == 0) return p + i;
+    }
+#endif
+    for (; p <= last; p++) {
+        p = memchr(p, pat[0], (size_t)(last - p) + 1);
+        if (!p) return NULL;
+        if (memcmp(p + 1, pat + 1, m - 1) == 0) return p;
+    }
+    return NULL;
+}
+
+// ---------- prefix parsing ----------
+
+static bool glob_match(const char *pat, const char *s, size_t n) {
+    const char *star = NULL, *ss = s, *end = s + n;
+    while (s < end) {
+        if (*pat == '?' || (*pat && *pat == *s)) {
+            ++pat;
+            ++s;
+        } else if (*pat == '*') {
+            star = pat++;
+            ss   = s;
+        } else if (star) {
+            pat = star + 1;
+            s   = ++ss;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') ++pat;
+    return *pat == '\0';
+}
+
+static const char *skip_ansi(const char *p, const char *e) {
+    while (p < e && *p == '\x1b') {
+        while (p < e && *p != 'm') ++p;
+        if (p < e) ++p;
+    }
+    return p;
+}
+
+/* closing char c at or after p within the line, or NULL */
+static const char *find_close(const char *p, const char *e, char c) { return memchr(p, c, (size_t)(e - p)); }
+
+static bool parse_rec(const char *p, const char *e, rec_t *r) {
+    if (e - p < TS_LEN + 4 || p[4] != '-' || p[10] != ' ' || p[19] != '.') return false;
+    r->ts = p;
+    p += TS_LEN;
+    if (*p++ != ' ' || *p++ != '[') return false;
+    p      = skip_ansi(p, e);
+    r->lvl = -1;
+    for (int i = 0; i < 6; i++) {
+        size_t n = strlen(k_levels[i]);
+        if ((size_t)(e - p) > n && memcmp(p, k_levels[i], n) == 0 && (p[n] == ']' || p[n] == '\x1b')) {
+            r->lvl = i;
+            p += n;
+            break;
+        }
+    }
+    if (r->lvl < 0) return false;
+    p = skip_ansi(p, e);
+    if (p >= e || *p++ != ']') return false;
+    if (p < e && *p == '\t') ++p;
+    if (e - p > 7 && memcmp(p, "[build:", 7) == 0) {
+        const char *c = find_close(p, e, ']');
+        if (!c) return false;
+        p = c + (c + 1 < e && c[1] == ' ' ? 2 : 1);
+    }
+    r->tid = -1;
+    if (p < e && *p == '(') {
+        const char *c = find_close(p, e, ')');
+        if (!c) return false;
+        if (c - p > 5 && memcmp(p, "(tid:", 5) == 0) r->tid = strtoll(p + 5, NULL, 10);
+        else if (c - p > 3 && memcmp(p, "(t#", 3) == 0) r->tid = strtoll(p + 3, NULL, 16);
+        p = c + (c + 1 < e && c[1] == ' ' ? 2 : 1);
+    }
+    if (p < e && *p == '#') { /* CLOG_WITH_SEQ */
+        const char *c = find_close(p, e, ' ');
+        if (!c) return false;
+        p = c + 1;
+    }
+    if (p >= e || *p != '<') return false;
+    const char *c = find_close(p, e, '>');
+    if (!c) return false;
+    const char *colon = c;
+    while (colon > p && *colon != ':') --colon;
+    r->file     = p + 1;
+    r->file_len = (size_t)((colon > p ? colon : c) - r->file);
+    p           = c + (c + 1 < e && c[1] == ' ' ? 2 : 1);
+    r->group    = NULL;
+    r->group_len = 0;
+    if (p < e && *p == '[') {
+        c = find_close(p, e, ']');
+        if (c && c + 1 < e && c[1] == ' ') {
+            r->group     = p + 1;
+            r->group_len = (size_t)(c - p - 1);
+            p            = c + 2;
+        }
+    }
+    r->msg = p;
+    return true;
+}
+
+static bool rec_filter(const opts_t *o, const rec_t *r) {
+    if (r->lvl < o->min_lvl) return false;
+    if (o->tid >= 0 && r->tid != o->tid) return false;
+    if (o->since && strncmp(r->ts, o->since, strlen(o->since)) < 0) return false;
+    if (o->until && strncmp(r->ts, o->until, strlen(o->until)) > 0) return false;
+    if (o->file_glob && !glob_match(o->file_glob, r->file, r->file_len)) return false;
+    if (o->group_glob && (!r->group || !glob_match(o->group_glob, r->group, r->group_len))) return false;
+    return true;
+}
+
+// ---------- workers ----------
+
+static void out_put(outbuf_t *b, const char *p, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 1 << 16;
+        while (cap < b->len + n) cap *= 2;
+        char *np = realloc(b->p, cap);
+        if (!np) {
+            perror("realloc");
+            exit(2);
+        }
+        b->p   = np;
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, p, n);
+    b->len += n;
+}
+
+static void emit_line(job_t *j, const char *ls, const char *le) {
+    ++j->matches;
+    if (j->o->count_only) return;
+    out_put(&j->out, ls, (size_t)(le - ls));
+    out_put(&j->out, "\n", 1);
+}
+
+/* line [ls, le) passes filters and (unless inverted) contains pat in its message */
+static bool line_matches(const opts_t *o, const char *ls, const char *le) {
+    rec_t r;
+    if (!parse_rec(ls, le, &r) || !rec_filter(o, &r)) return false;
+    bool hit = !o->pat_len || find_sub(r.msg, le, o->pat, o->pat_len) != NULL;
+    return hit != o->invert;
+}
+
+static void *worker(void *arg) {
+    job_t        *j = arg;
+    const opts_t *o = j->o;
+    const char   *p = j->beg, *end = j->end;
+
+    if (o->pat_len && !o->invert) {
+        /* search first, parse only lines that contain a hit */
+        while (p < end) {
+            const char *hit = find_sub(p, end, o->pat, o->pat_len);
+            if (!hit) break;
+            const char *ls = hit;
+            while (ls > j->beg && ls[-1] != '\n') --ls;
+            const char *le = memchr(hit, '\n', (size_t)(end - hit));
+            if (!le) le = end;
+            if (line_matches(o, ls, le)) emit_line(j, ls, le);
+            p = le + 1;
+        }
+        return NULL;
+    }
+    while (p < end) {
+        const char *le = memchr(p, '\n', (size_t)(end - p));
+        if (!le) le = end;
+        if (line_matches(o, p, le)) emit_line(j, p, le);
+        p = le + 1;
+    }
+    return NULL;
+}
+
+static int write_all(int fd, const char *p, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int grep_file(const opts_t *o, const char *path, int nthreads, size_t *total) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "c-log-grep: %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 2;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+    const char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "c-log-grep: %s: mmap: %s\n", path, strerror(errno));
+        return 2;
+    }
+    (void)madvise((void *)(uintptr_t)base, size, MADV_SEQUENTIAL);
+
+    job_t      *jobs = calloc((size_t)nthreads, sizeof *jobs);
+    const char *p = base, *end = base + size;
+    int         rc = 0;
+    if (!jobs) {
+        munmap((void *)(uintptr_t)base, size);
+        return 2;
+    }
+    while (p < end) {
+        int n = 0;
+        for (; n < nthreads && p < end; n++) {
+            const char *e = (size_t)(end - p) > CHUNK ? p + CHUNK : end;
+            if (e < end) {
+                const char *nl = memchr(e, '\n', (size_t)(end - e));
+                e              = nl ? nl + 1 : end;
+            }
+            jobs[n].o        = o;
+            jobs[n].beg      = p;
+            jobs[n].end      = e;
+            jobs[n].out.len  = 0;
+            jobs[n].threaded = pthread_create(&jobs[n].th, NULL, worker, &jobs[n]) == 0;
+            if (!jobs[n].threaded) worker(&jobs[n]);
+            p = e;
+        }
+        for (int i = 0; i < n; i++) {
+            if (jobs[i].threaded) pthread_join(jobs[i].th, NULL);
+            if (jobs[i].out.len && write_all(1, jobs[i].out.p, jobs[i].out.len) != 0) rc = 2;
+        }
+    }
+    for (int i = 0; i < nthreads; i++) {
+        *total += jobs[i].matches;
+        free(jobs[i].out.p);
+    }
+    free(jobs);
+    munmap((void *)(uintptr_t)base, size);
+    return rc;
+}
+
+static void usage(void) {
+    fputs(
+        "usage: c-log-grep [options] FILE...\n"
+        "  -e TEXT    substring to find in the message\n"
+        "  -v         invert the substring match (filters still apply)\n"
+        "  -l LEVEL   minimum level: TRACE DEBUG INFO WARN ERROR FATAL\n"
+        "  -g GLOB    group glob (records without a group never match)\n"
+        "  -f GLOB    file glob, matched against the basename in <file:line>\n"
+        "  -t TID     thread id as printed (decimal, or hex for CLOG_TID_SHORT)\n"
+        "  -s TIME    since, a timestamp prefix such as \"2025-09-05 10:15\"\n"
+        "  -u TIME    until (inclusive at the given precision)\n"
+        "  -j N       worker threads (default: online CPUs)\n"
+        "  -c         print only the number of matching records\n",
+        stderr
+    );
+}
+
+int main(int argc, char **argv) {
+    opts_t o;
+    memset(&o, 0, sizeof o);
+    o.tid   = -1;
+    int thr = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "e:vl:g:f:t:s:u:j:ch")) != -1) {
+        switch (opt) {
+            case 'e': o.pat = optarg; break;
+            case 'v': o.invert = true; break;
+            case 'l':
+                o.min_lvl = -1;
+                for (int i = 0; i < 6; i++)
+                    if (strcasecmp(optarg, k_levels[i]) == 0) o.min_lvl = i;
+                if (o.min_lvl < 0) {
+                    fprintf(stderr, "c-log-grep: unknown level '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'g': o.group_glob = optarg; break;
+            case 'f': o.file_glob = optarg; break;
+            case 't': o.tid = strtoll(optarg, NULL, 0); break;
+            case 's': o.since = optarg; break;
+            case 'u': o.until = optarg; break;
+            case 'j': thr = atoi(optarg); break;
+            case 'c': o.count_only = true; break;
+            default: usage(); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 2;
+    }
+    if (thr < 1) thr = 1;
+    o.pat_len = o.pat ? strlen(o.pat) : 0;
+
+    int    rc    = 0;
+    size_t total = 0;
+    for (int i = optind; i < argc; i++) rc |= grep_file(&o, argv[i], thr, &total);
+    if (o.count_only) printf("%zu\n", total);
+    return rc ? rc : total ? 0 : 1;
+}
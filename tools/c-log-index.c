@@ -0,0 +1,147 @@
+// c-log-index — inspect a c-log sparse time index and seek a log file to a timestamp.
+//
+//   c-log-index INDEX                 dump entries (time, offset)
+//   c-log-index [-u] INDEX TIME       print the log offset to start reading from for TIME
+//   c-log-index [-u] INDEX TIME LOG   print LOG from the first record stamped >= TIME
+//
+// TIME is "YYYY-MM-DD HH:MM:SS[.mmm]" in local time (-u: UTC) or "@<unix seconds>". The seek itself is a
+// binary search over the index (clog_index_seek), so it is O(log n) in the number of entries.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c-log.h"  // interface only; impl compiled in src/c-log-impl.c
+
+#define TS_LEN 23 /* "YYYY-MM-DD HH:MM:SS.mmm" */
+
+static bool parse_time(const char *s, bool utc, uint64_t *ns, char ts[TS_LEN + 1]) {
+    struct tm tmv;
+    memset(&tmv, 0, sizeof tmv);
+    int ms = 0;
+    if (s[0] == '@') {
+        char  *end;
+        double v = strtod(s + 1, &end);
+        if (*end || v < 0) return false;
+        *ns      = (uint64_t)(v * 1e9);
+        time_t t = (time_t)v;
+        if (utc) gmtime_r(&t, &tmv);
+        else localtime_r(&t, &tmv);
+        ms = (int)((*ns / UINT64_C(1000000)) % 1000u);
+    } else {
+        int n = sscanf(s, "%d-%d-%d %d:%d:%d.%d", &tmv.tm_year, &tmv.tm_mon, &tmv.tm_mday, &tmv.tm_hour, &tmv.tm_min,
+                       &tmv.tm_sec, &ms);
+        if (n < 6) return false;
+        tmv.tm_year -= 1900;
+        tmv.tm_mon -= 1;
+        tmv.tm_isdst = -1;
+        time_t t     = utc ? timegm(&tmv) : mktime(&tmv);
+        if (t == (time_t)-1) return false;
+        *ns = (uint64_t)t * UINT64_C(1000000000) + (uint64_t)ms * UINT64_C(1000000);
+    }
+    char full[96];
+    snprintf(full, sizeof full, "%04d-%02d-%02d %02d:%02d:%02d.%03d", tmv.tm_year + 1900, tmv.tm_mon + 1, tmv.tm_mday,
+             tmv.tm_hour, tmv.tm_min, tmv.tm_sec, ms);
+    memcpy(ts, full, TS_LEN);
+    ts[TS_LEN] = '\0';
+    return true;
+}
+
+static int dump(int fd, bool utc) {
+    char hdr[16];
+    if (read(fd, hdr, sizeof hdr) != (ssize_t)sizeof hdr || memcmp(hdr, "CLOGIDX1", 8) != 0) {
+        fprintf(stderr, "c-log-index: not a c-log index\n");
+        return 2;
+    }
+    uint64_t e[2];
+    while (read(fd, e, sizeof e) == (ssize_t)sizeof e) {
+        time_t    t = (time_t)(e[0] / 1000000000ull);
+        struct tm tmv;
+        if (utc) gmtime_r(&t, &tmv);
+        else localtime_r(&t, &tmv);
+        char buf[32];
+        strftime(buf, sizeof buf, "%Y-%m-%d %H:%M:%S", &tmv);
+        printf("%s.%03llu %llu\n", buf, (unsigned long long)((e[0] / 1000000ull) % 1000ull), (unsigned long long)e[1]);
+    }
+    return 0;
+}
+
+/* a record's first line starts with its "YYYY-MM-DD HH:MM:SS.mmm" stamp; the lines of a multi-line message don't */
+static bool stamped(const char *line, ssize_t n) {
+    static const char pat[] = "dddd-dd-dd dd:dd:dd.ddd";
+    if (n < TS_LEN) return false;
+    for (int i = 0; i < TS_LEN; i++) {
+        if (pat[i] == 'd' ? line[i] < '0' || line[i] > '9' : line[i] != pat[i]) return false;
+    }
+    return true;
+}
+
+/* copy LOG from off, skipping leading records stamped before ts (with their continuation lines) */
+static int print_from(const char *path, int64_t off, const char *ts) {
+    FILE *f = fopen(path, "rb");
+    if (!f || fseeko(f, (off_t)off, SEEK_SET) != 0) {
+        fprintf(stderr, "c-log-index: %s: %s\n", path, strerror(errno));
+        if (f) fclose(f);
+        return 2;
+    }
+    char   *line = NULL;
+    size_t  cap  = 0;
+    ssize_t n;
+    bool    on = false;
+    while ((n = getline(&line, &cap, f)) > 0) {
+        if (!on && (!stamped(line, n) || memcmp(line, ts, TS_LEN) < 0)) continue;
+        on = true;
+        fwrite(line, 1, (size_t)n, stdout);
+    }
+    free(line);
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    bool utc = false;
+    int  a   = 1;
+    if (a < argc && strcmp(argv[a], "-u") == 0) {
+        utc = true;
+        ++a;
+    }
+    if (argc - a < 1 || argc - a > 3) {
+        fputs("usage: c-log-index [-u] INDEX [TIME [LOG]]\n", stderr);
+        return 2;
+    }
+    int fd = open(argv[a], O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "c-log-index: %s: %s\n", argv[a], strerror(errno));
+        return 2;
+    }
+    if (argc - a == 1) {
+        int rc = dump(fd, utc);
+        close(fd);
+        return rc;
+    }
+
+    uint64_t ns;
+    char     ts[TS_LEN + 1];
+    if (!parse_time(argv[a + 1], utc, &ns, ts)) {
+        fprintf(stderr, "c-log-index: bad time '%s'\n", argv[a + 1]);
+        close(fd);
+        return 2;
+    }
+    int64_t off = clog_index_seek(fd, ns);
+    close(fd);
+    if (off < 0) {
+        fprintf(stderr, "c-log-index: %s: not a c-log index\n", argv[a]);
+        return 2;
+    }
+    if (argc - a == 2) {
+        printf("%lld\n", (long long)off);
+        return 0;
+    }
+    return print_from(argv[a + 2], off, ts);
+}
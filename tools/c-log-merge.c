@@ -0,0 +1,300 @@
+// c-log-merge — put the chunk records of a shared log (clog_open_shared) back together.
+//
+//   c-log-merge [-s] [-v] FILE...
+//
+// A process writing to a shared file emits every record in one write(); a record longer than CLOG_SHARED_CHUNK is
+// cut into chunk records, CLOG_SHARED_MARK "<pid>.<id>.<k>/<n>.<len> " + len bytes + '\n', and chunks of other
+// processes may land in between. The files are mmapped and walked record by record: plain lines and frames
+// (clog_set_framing) pass through, chunks are collected per (file, pid, id) and the record is printed once its
+// last chunk arrives. A record whose chunks stop short or arrive out of order is reported as torn.
+// -s merges the inputs by their timestamps; records stamped in the same millisecond keep their "#N" order
+// (CLOG_WITH_SEQ), which with clog_open_shared(path, true) is unique across the processes writing the file.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "c-log.h"  // CLOG_SHARED_MARK and the frame layout; impl compiled in src/c-log-impl.c
+
+typedef struct {
+    unsigned    file, id, got, n;
+    long        pid;
+    char       *buf;
+    size_t      len;
+} pending_t;
+
+typedef struct {
+    const char *p;
+    size_t      len;
+    uint64_t    ts, seq;
+    size_t      idx;
+} rec_t;
+
+typedef struct {
+    pending_t *pend;
+    size_t     npend, cap_pend;
+    rec_t     *recs;
+    size_t     nrecs, cap_recs;
+    char     **owned; /* reassembled records, freed at exit */
+    size_t     nowned, cap_owned;
+    bool       sort, verbose;
+    size_t     records, chunks, joined, torn;
+    uint64_t   last_ts, last_seq;
+} merge_t;
+
+static bool grow(void **arr, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return true;
+    size_t n = *cap ? *cap * 2 : 64;
+    while (n < need) n *= 2;
+    void *p = realloc(*arr, n * elem);
+    if (!p) return false;
+    *arr = p;
+    *cap = n;
+    return true;
+}
+
+/* "YYYY-MM-DD HH:MM:SS.mmm" as the number YYYYMMDDHHMMSSmmm, 0 if the record does not start with one */
+static uint64_t ts_of(const char *p, size_t len) {
+    static const char shape[] = "0000-00-00 00:00:00.000";
+    if (len < sizeof shape - 1) return 0;
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof shape - 1; i++) {
+        if (shape[i] == '0') {
+            if (p[i] < '0' || p[i] > '9') return 0;
+            v = v * 10 + (uint64_t)(p[i] - '0');
+        } else if (p[i] != shape[i]) {
+            return 0;
+        }
+    }
+    return v;
+}
+
+/* the "#N" after the tid, searched in the prefix (before the first '<'); UINT64_MAX if absent */
+static uint64_t seq_of(const char *p, size_t len) {
+    for (size_t i = 1; i + 1 < len && p[i] != '<' && p[i] != '\n'; i++) {
+        if (p[i] != '#' || (p[i - 1] != ' ' && p[i - 1] != '\t') || p[i + 1] < '0' || p[i + 1] > '9') continue;
+        uint64_t v = 0;
+        size_t   j = i + 1;
+        for (; j < len && p[j] >= '0' && p[j] <= '9'; j++) v = v * 10 + (uint64_t)(p[j] - '0');
+        if (j < len && p[j] == ' ') return v;
+    }
+    return UINT64_MAX;
+}
+
+static int emit(merge_t *m, const char *p, size_t len) {
+    m->records++;
+    if (!m->sort) return fwrite(p, 1, len, stdout) == len ? 0 : 2;
+    if (!grow((void **)&m->recs, &m->cap_recs, m->nrecs + 1, sizeof *m->recs)) return 2;
+    const char *text = p;
+    size_t      tlen = len;
+    if (tlen > CLOG_FRAME_HDR && (unsigned char)text[0] == CLOG_FRAME_MARK) {
+        text += CLOG_FRAME_HDR;
+        tlen -= CLOG_FRAME_HDR;
+    }
+    uint64_t ts = ts_of(text, tlen);
+    if (ts) {
+        m->last_ts  = ts;
+        m->last_seq = seq_of(text, tlen);
+    }
+    /* a line without a prefix (a block continuation, a banner) stays behind the record before it */
+    rec_t *r = &m->recs[m->nrecs];
+    r->p     = p;
+    r->len   = len;
+    r->ts    = m->last_ts;
+    r->seq   = m->last_seq;
+    r->idx   = m->nrecs++;
+    return 0;
+}
+
+static void report_torn(merge_t *m, const pending_t *pd, const char *why) {
+    m->torn++;
+    if (m->verbose)
+        fprintf(stderr, "torn: pid %ld record %u: %s after %u of %u chunks\n", pd->pid, pd->id, why, pd->got, pd->n);
+}
+
+static void drop_pending(merge_t *m, size_t i) {
+    free(m->pend[i].buf);
+    m->pend[i] = m->pend[--m->npend];
+}
+
+/* header "<pid>.<id>.<k>/<n>.<len> " after the mark; returns its length or 0 */
+static size_t parse_chunk(const char *p, const char *end, long *pid, unsigned *id, unsigned *k, unsigned *n,
+                          size_t *len) {
+    char hdr[96];
+    size_t h = 0;
+    while (p + h < end && h < sizeof hdr - 1 && p[h] != ' ' && p[h] != '\n') {
+        hdr[h] = p[h];
+        h++;
+    }
+    if (p + h >= end || p[h] != ' ') return 0;
+    hdr[h] = '\0';
+    int used = 0;
+    if (sscanf(hdr, "%ld.%u.%u/%u.%zu%n", pid, id, k, n, len, &used) != 5 || (size_t)used != h || *k >= *n)
+        return 0;
+    return h + 1;
+}
+
+static int add_chunk(merge_t *m, unsigned file, long pid, unsigned id, unsigned k, unsigned n, const char *p,
+                     size_t len) {
+    m->chunks++;
+    size_t i = 0;
+    while (i < m->npend && !(m->pend[i].file == file && m->pend[i].pid == pid && m->pend[i].id == id)) i++;
+    if (i == m->npend) {
+        if (k != 0) {
+            pending_t orphan = {file, id, 0, n, pid, NULL, 0};
+            report_torn(m, &orphan, "missing start");
+            return 0;
+        }
+        if (!grow((void **)&m->pend, &m->cap_pend, m->npend + 1, sizeof *m->pend)) return 2;
+        pending_t fresh = {file, id, 0, n, pid, NULL, 0};
+        m->pend[m->npend++] = fresh;
+    }
+    pending_t *pd = &m->pend[i];
+    if (k != pd->got || n != pd->n) {
+        report_torn(m, pd, "chunk out of order");
+        drop_pending(m, i);
+        return 0;
+    }
+    char *nb = realloc(pd->buf, pd->len + len);
+    if (!nb && pd->len + len) return 2;
+    pd->buf = nb;
+    memcpy(pd->buf + pd->len, p, len);
+    pd->len += len;
+    if (++pd->got < pd->n) return 0;
+
+    m->joined++;
+    if (m->sort && !grow((void **)&m->owned, &m->cap_owned, m->nowned + 1, sizeof *m->owned)) return 2;
+    char  *rec = pd->buf;
+    size_t rl  = pd->len;
+    pd->buf    = NULL;
+    drop_pending(m, i);
+    int rc = emit(m, rec, rl);
+    if (m->sort) m->owned[m->nowned++] = rec;
+    else free(rec);
+    return rc;
+}
+
+static int walk(merge_t *m, unsigned file, const char *base, size_t size) {
+    const char *p = base, *end = base + size;
+    while (p < end) {
+        if ((unsigned char)*p == CLOG_SHARED_MARK) {
+            long     pid;
+            unsigned id, k, n;
+            size_t   len, h = parse_chunk(p + 1, end, &pid, &id, &k, &n, &len);
+            const char *body = p + 1 + h;
+            if (h && len < (size_t)(end - body) && body[len] == '\n') {
+                int rc = add_chunk(m, file, pid, id, k, n, body, len);
+                if (rc) return rc;
+                p = body + len + 1;
+                continue;
+            }
+        } else if ((unsigned char)*p == CLOG_FRAME_MARK && (size_t)(end - p) >= CLOG_FRAME_HDR) {
+            const unsigned char *u = (const unsigned char *)p;
+            uint32_t len = (uint32_t)u[1] | (uint32_t)u[2] << 8 | (uint32_t)u[3] << 16 | (uint32_t)u[4] << 24;
+            if (len <= (size_t)(end - p) - CLOG_FRAME_HDR) {
+                int rc = emit(m, p, CLOG_FRAME_HDR + len);
+                if (rc) return rc;
+                p += CLOG_FRAME_HDR + len;
+                continue;
+            }
+        }
+        /* a plain line (or a damaged chunk header, passed through as text) */
+        const char *nl  = memchr(p, '\n', (size_t)(end - p));
+        const char *eol = nl ? nl + 1 : end;
+        int         rc  = emit(m, p, (size_t)(eol - p));
+        if (rc) return rc;
+        p = eol;
+    }
+    return 0;
+}
+
+static int cmp_rec(const void *a, const void *b) {
+    const rec_t *x = a, *y = b;
+    if (x->ts != y->ts) return x->ts < y->ts ? -1 : 1;
+    if (x->seq != y->seq) return x->seq < y->seq ? -1 : 1;
+    return x->idx < y->idx ? -1 : x->idx > y->idx;
+}
+
+static void usage(void) {
+    fputs(
+        "usage: c-log-merge [options] FILE...\n"
+        "  -s       merge the inputs by timestamp, then by #N within a millisecond\n"
+        "  -v       list every torn record\n",
+        stderr
+    );
+}
+
+int main(int argc, char **argv) {
+    merge_t m;
+    memset(&m, 0, sizeof m);
+    int opt;
+    while ((opt = getopt(argc, argv, "svh")) != -1) {
+        switch (opt) {
+            case 's': m.sort = true; break;
+            case 'v': m.verbose = true; break;
+            default: usage(); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 2;
+    }
+    int     nfiles = argc - optind, rc = 0;
+    void  **maps   = calloc((size_t)nfiles, sizeof *maps);
+    size_t *sizes  = calloc((size_t)nfiles, sizeof *sizes);
+    if (!maps || !sizes) return 2;
+
+    for (int f = 0; f < nfiles && !rc; f++) {
+        const char *path = argv[optind + f];
+        int         fd   = open(path, O_RDONLY);
+        struct stat sb;
+        if (fd < 0 || fstat(fd, &sb) != 0) {
+            fprintf(stderr, "c-log-merge: %s: %s\n", path, strerror(errno));
+            if (fd >= 0) close(fd);
+            rc = 2;
+            break;
+        }
+        sizes[f] = (size_t)sb.st_size;
+        if (sizes[f]) {
+            maps[f] = mmap(NULL, sizes[f], PROT_READ, MAP_PRIVATE, fd, 0);
+            if (maps[f] == MAP_FAILED) {
+                fprintf(stderr, "c-log-merge: %s: mmap: %s\n", path, strerror(errno));
+                maps[f] = NULL;
+                rc      = 2;
+            } else {
+                (void)madvise(maps[f], sizes[f], MADV_SEQUENTIAL);
+                m.last_ts = m.last_seq = 0;
+                rc                     = walk(&m, (unsigned)f, maps[f], sizes[f]);
+            }
+        }
+        close(fd);
+    }
+    for (size_t i = 0; i < m.npend; i++) report_torn(&m, &m.pend[i], "end of file");
+    if (!rc && m.sort) {
+        qsort(m.recs, m.nrecs, sizeof *m.recs, cmp_rec);
+        for (size_t i = 0; i < m.nrecs && !rc; i++)
+            if (fwrite(m.recs[i].p, 1, m.recs[i].len, stdout) != m.recs[i].len) rc = 2;
+    }
+    if (fflush(stdout) != 0) rc = 2;
+
+    fprintf(stderr, "%zu records, %zu reassembled from %zu chunks, %zu torn\n", m.records, m.joined, m.chunks,
+            m.torn);
+    for (int f = 0; f < nfiles; f++)
+        if (maps[f]) munmap(maps[f], sizes[f]);
+    for (size_t i = 0; i < m.npend; i++) free(m.pend[i].buf);
+    for (size_t i = 0; i < m.nowned; i++) free(m.owned[i]);
+    free(m.pend);
+    free(m.recs);
+    free(m.owned);
+    free(maps);
+    free(sizes);
+    return rc ? rc : m.torn ? 1 : 0;
+}
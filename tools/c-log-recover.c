@@ -0,0 +1,159 @@
+// c-log-recover — validate a framed c-log file (clog_set_framing) and print the intact records.
+//
+//   c-log-recover [-c] [-v] [-m MAX] FILE
+//
+// Every frame is CLOG_FRAME_MARK, u32 length, u32 CRC32C (little endian), then the payload. The file is mmapped
+// and walked frame by frame; a frame whose length runs past the end of the file or whose CRC does not match
+// starts a damaged span, and the scan resynchronizes at the next marker byte (memchr) that heads a valid frame.
+// Both the resync and the check run at memory speed: memchr plus the hardware CRC32C from the library.
+// A damaged span that reaches the end of the file is reported as a torn tail.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "c-log.h"  // clog_crc32c and the frame layout; impl compiled in src/c-log-impl.c
+
+#define OUT_CAP ((size_t)1 << 20)
+
+typedef struct {
+    size_t frames, payload_bytes;
+    size_t spans, bad_bytes;
+    size_t torn;
+} stats_t;
+
+static int write_all(int fd, const char *p, size_t n) {
+    while (n) {
+        ssize_t r = write(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static uint32_t get_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* payload length if a valid frame starts at p, else -1 */
+static int64_t frame_at(const unsigned char *p, const unsigned char *end, uint32_t max_len) {
+    if ((size_t)(end - p) < CLOG_FRAME_HDR || p[0] != CLOG_FRAME_MARK) return -1;
+    uint32_t len = get_le32(p + 1);
+    if (len > max_len || len > (size_t)(end - p) - CLOG_FRAME_HDR) return -1;
+    return clog_crc32c(0, p + CLOG_FRAME_HDR, len) == get_le32(p + 5) ? (int64_t)len : -1;
+}
+
+static int recover(const unsigned char *base, size_t size, uint32_t max_len, bool check, bool verbose, stats_t *st) {
+    const unsigned char *p = base, *end = base + size, *bad = NULL;
+    char                *out = check ? NULL : malloc(OUT_CAP);
+    size_t               out_len = 0;
+    int                  rc      = 0;
+    if (!check && !out) return 2;
+
+    while (p < end) {
+        int64_t len = frame_at(p, end, max_len);
+        if (len < 0) {
+            if (!bad) bad = p;
+            const unsigned char *m = memchr(p + 1, CLOG_FRAME_MARK, (size_t)(end - p - 1));
+            p                      = m ? m : end;
+            continue;
+        }
+        if (bad) {
+            if (verbose) fprintf(stderr, "damaged: offset %zu, %zu bytes\n", (size_t)(bad - base), (size_t)(p - bad));
+            st->spans++;
+            st->bad_bytes += (size_t)(p - bad);
+            bad = NULL;
+        }
+        const unsigned char *pl = p + CLOG_FRAME_HDR;
+        st->frames++;
+        st->payload_bytes += (size_t)len;
+        p = pl + len;
+        if (check) continue;
+        if (out_len + (size_t)len > OUT_CAP) {
+            if (write_all(1, out, out_len) != 0) rc = 2;
+            out_len = 0;
+        }
+        if ((size_t)len > OUT_CAP) {
+            if (write_all(1, (const char *)pl, (size_t)len) != 0) rc = 2;
+        } else {
+            memcpy(out + out_len, pl, (size_t)len);
+            out_len += (size_t)len;
+        }
+    }
+    if (bad) {
+        st->torn = (size_t)(end - bad);
+        if (verbose) fprintf(stderr, "torn tail: offset %zu, %zu bytes\n", (size_t)(bad - base), st->torn);
+    }
+    if (out_len && write_all(1, out, out_len) != 0) rc = 2;
+    free(out);
+    return rc;
+}
+
+static void usage(void) {
+    fputs(
+        "usage: c-log-recover [options] FILE\n"
+        "  -c       check only: print nothing but the summary\n"
+        "  -v       list every damaged span and the torn tail\n"
+        "  -m MAX   largest plausible payload in bytes (default 64 MiB)\n",
+        stderr
+    );
+}
+
+int main(int argc, char **argv) {
+    bool     check = false, verbose = false;
+    uint32_t max_len = 64u << 20;
+    int      opt;
+    while ((opt = getopt(argc, argv, "cvm:h")) != -1) {
+        switch (opt) {
+            case 'c': check = true; break;
+            case 'v': verbose = true; break;
+            case 'm': max_len = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default: usage(); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage();
+        return 2;
+    }
+    const char *path = argv[optind];
+    int         fd   = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "c-log-recover: %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) {
+        close(fd);
+        return 2;
+    }
+    size_t  size = (size_t)sb.st_size;
+    stats_t st;
+    memset(&st, 0, sizeof st);
+    int rc = 0;
+    if (size) {
+        const unsigned char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            fprintf(stderr, "c-log-recover: %s: mmap: %s\n", path, strerror(errno));
+            close(fd);
+            return 2;
+        }
+        (void)madvise((void *)(uintptr_t)base, size, MADV_SEQUENTIAL);
+        rc = recover(base, size, max_len, check, verbose, &st);
+        munmap((void *)(uintptr_t)base, size);
+    }
+    close(fd);
+
+    fprintf(stderr, "%zu intact records (%zu bytes), %zu damaged spans (%zu bytes), torn tail %zu bytes\n", st.frames,
+            st.payload_bytes, st.spans, st.bad_bytes, st.torn);
+    return rc ? rc : st.spans || st.torn ? 1 : 0;
+}
@@ -0,0 +1,350 @@
+// c-log-trace — print a function trace dumped by the c_log_trace_hooks library (src/c-log-trace.h).
+//
+//   c-log-trace [-s] [-t TID] [-d DEPTH] FILE
+//
+// Addresses are symbolized here, not in the traced process: every executable mapping recorded in the dump is
+// matched to the PT_LOAD segment of its ELF file that it maps, and the file's .symtab (.dynsym when stripped)
+// names the functions; an address nothing covers prints as path+0xoffset for addr2line. The default output is one
+// line per call, in call order and indented by depth, with the duration formatted like c-log timers ("[...]" when
+// the call had not returned). -s prints a flat profile instead: calls, total time (outermost activation only for
+// recursive functions), self time and the longest call per function. Exits whose entry was overwritten in the ring
+// are skipped.
+
+#define _GNU_SOURCE
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c-log-trace.h"  // dump layout; impl compiled in src/c-log-trace-impl.c (not linked here)
+
+#define K_CLASS (__ELF_NATIVE_CLASS == 64 ? ELFCLASS64 : ELFCLASS32)
+
+typedef struct {
+    uint64_t    addr, size;
+    const char *name;
+} sym_t;
+
+typedef struct {
+    char          *path;
+    unsigned char *base; /* mmapped file, kept for the symbol names */
+    size_t         len;
+    sym_t         *syms;
+    size_t         nsyms;
+} image_t;
+
+typedef struct {
+    uint64_t lo, hi, off, bias;
+    int      img; /* -1: file unreadable or no segment covers the mapping */
+} map_t;
+
+typedef struct {
+    uint64_t fn, t0, t1, child;
+    int      depth;
+    bool     done, outer; /* outer: no activation of fn below it on the stack */
+} call_t;
+
+typedef struct {
+    uint64_t fn, total, self, max;
+    size_t   calls;
+} prof_t;
+
+static image_t *g_imgs;
+static size_t   g_nimgs;
+static map_t   *g_maps;
+static size_t   g_nmaps;
+
+static bool grow(void **arr, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return true;
+    size_t n = *cap ? *cap * 2 : 64;
+    while (n < need) n *= 2;
+    void *p = realloc(*arr, n * elem);
+    if (!p) return false;
+    *arr = p;
+    *cap = n;
+    return true;
+}
+
+static int sym_cmp(const void *a, const void *b) {
+    uint64_t x = ((const sym_t *)a)->addr, y = ((const sym_t *)b)->addr;
+    return x < y ? -1 : x > y;
+}
+
+/* native-class ELF only; anything else leaves the image without symbols */
+static void load_symbols(image_t *im) {
+    int fd = open(im->path, O_RDONLY);
+    if (fd < 0) return;
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(ElfW(Ehdr))) {
+        void *m = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            im->base = m;
+            im->len  = (size_t)sb.st_size;
+        }
+    }
+    close(fd);
+    const ElfW(Ehdr) *eh = (const void *)im->base;
+    if (!eh || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != K_CLASS ||
+        eh->e_shoff == 0 || eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(ElfW(Shdr)) > im->len)
+        return;
+    const ElfW(Shdr) *sh = (const void *)(im->base + eh->e_shoff);
+    const ElfW(Shdr) *tab = NULL;
+    for (unsigned i = 0; i < eh->e_shnum; i++)
+        if (sh[i].sh_type == SHT_SYMTAB || (sh[i].sh_type == SHT_DYNSYM && !tab)) tab = &sh[i];
+    if (!tab || tab->sh_link >= eh->e_shnum) return;
+    const ElfW(Shdr) *str = &sh[tab->sh_link];
+    if (tab->sh_offset + tab->sh_size > im->len || str->sh_offset + str->sh_size > im->len) return;
+
+    const ElfW(Sym) *s   = (const void *)(im->base + tab->sh_offset);
+    size_t           n   = tab->sh_size / sizeof *s;
+    size_t           cap = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ELF64_ST_TYPE(s[i].st_info) != STT_FUNC || !s[i].st_value || s[i].st_name >= str->sh_size) continue;
+        if (!grow((void **)&im->syms, &cap, im->nsyms + 1, sizeof(sym_t))) break;
+        im->syms[im->nsyms++] = (sym_t){s[i].st_value, s[i].st_size,
+                                        (const char *)im->base + str->sh_offset + s[i].st_name};
+    }
+    if (im->nsyms) qsort(im->syms, im->nsyms, sizeof(sym_t), sym_cmp);
+}
+
+/* runtime address = symbol value + bias, from the executable segment the mapping covers */
+static void add_map(uint64_t lo, uint64_t hi, uint64_t off, const char *path, size_t plen) {
+    static size_t cap_maps, cap_imgs;
+    if (!grow((void **)&g_maps, &cap_maps, g_nmaps + 1, sizeof(map_t))) return;
+    map_t *m = &g_maps[g_nmaps++];
+    *m       = (map_t){lo, hi, off, 0, -1};
+    size_t i = 0;
+    while (i < g_nimgs && !(strlen(g_imgs[i].path) == plen && memcmp(g_imgs[i].path, path, plen) == 0)) ++i;
+    if (i == g_nimgs) {
+        if (!grow((void **)&g_imgs, &cap_imgs, g_nimgs + 1, sizeof(image_t))) return;
+        memset(&g_imgs[i], 0, sizeof(image_t));
+        g_imgs[i].path = strndup(path, plen);
+        if (!g_imgs[i].path) return;
+        g_nimgs++;
+        load_symbols(&g_imgs[i]);
+    }
+    const image_t *im = &g_imgs[i];
+    if (!im->base) return;
+    const ElfW(Ehdr) *eh = (const void *)im->base;
+    if (eh->e_phoff + (uint64_t)eh->e_phnum * sizeof(ElfW(Phdr)) > im->len) return;
+    const ElfW(Phdr) *ph = (const void *)(im->base + eh->e_phoff);
+    for (unsigned k = 0; k < eh->e_phnum; k++) {
+        if (ph[k].p_type != PT_LOAD || !(ph[k].p_flags & PF_X)) continue;
+        if (ph[k].p_offset + ph[k].p_filesz <= off || ph[k].p_offset >= off + (hi - lo)) continue;
+        m->bias = lo + ph[k].p_offset - off - ph[k].p_vaddr;
+        m->img  = (int)i;
+        break;
+    }
+}
+
+static const char *resolve(uint64_t addr, char *buf, size_t cap) {
+    for (size_t i = 0; i < g_nmaps; i++) {
+        const map_t *m = &g_maps[i];
+        if (addr < m->lo || addr >= m->hi) continue;
+        if (m->img < 0) break;
+        const image_t *im = &g_imgs[m->img];
+        uint64_t       v  = addr - m->bias;
+        size_t         lo = 0, hi = im->nsyms;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (im->syms[mid].addr <= v) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo && v < im->syms[lo - 1].addr + (im->syms[lo - 1].size ? im->syms[lo - 1].size : 1))
+            return im->syms[lo - 1].name;
+        (void)snprintf(buf, cap, "%s+0x%llx", im->path, (unsigned long long)(addr - m->lo + m->off));
+        return buf;
+    }
+    (void)snprintf(buf, cap, "0x%llx", (unsigned long long)addr);
+    return buf;
+}
+
+/* same units and thresholds as the c-log timers */
+static const char *fmt_dur(uint64_t ns, char *buf, size_t cap) {
+    if (ns < CLOG_TIMER_NS_MAX) (void)snprintf(buf, cap, "%llu ns", (unsigned long long)ns);
+    else if (ns < CLOG_TIMER_US_MAX) (void)snprintf(buf, cap, "%.3f " CLOG_TIMER_UNIT_US, (double)ns / 1e3);
+    else if (ns < CLOG_TIMER_MS_MAX) (void)snprintf(buf, cap, "%.3f ms", (double)ns / 1e6);
+    else (void)snprintf(buf, cap, "%.6f s", (double)ns / 1e9);
+    return buf;
+}
+
+static void print_call(const call_t *c, uint64_t tid, uint64_t wall0, uint64_t mono0) {
+    int64_t   wall = (int64_t)wall0 + (int64_t)(c->t0 - mono0);
+    time_t    sec  = (time_t)(wall / 1000000000);
+    struct tm tmv;
+    char      ts[32], name[512], dur[48];
+    localtime_r(&sec, &tmv);
+    strftime(ts, sizeof ts, "%Y-%m-%d %H:%M:%S", &tmv);
+    printf("%s.%06ld (%llu) %*s%s [%s]\n", ts, (long)(wall % 1000000000 / 1000), (unsigned long long)tid,
+           2 * c->depth, "", resolve(c->fn, name, sizeof name),
+           c->done ? fmt_dur(c->t1 - c->t0, dur, sizeof dur) : "...");
+}
+
+static int prof_cmp(const void *a, const void *b) {
+    const prof_t *x = a, *y = b;
+    return x->total > y->total ? -1 : x->total < y->total;
+}
+
+static int fn_cmp(const void *a, const void *b) {
+    uint64_t x = ((const call_t *)a)->fn, y = ((const call_t *)b)->fn;
+    return x < y ? -1 : x > y;
+}
+
+static void print_profile(call_t *calls, size_t n) {
+    qsort(calls, n, sizeof *calls, fn_cmp);
+    prof_t *p  = calloc(n ? n : 1, sizeof *p);
+    size_t  np = 0;
+    if (!p) return;
+    for (size_t i = 0; i < n; i++) {
+        const call_t *c = &calls[i];
+        if (!c->done) continue;
+        if (!np || p[np - 1].fn != c->fn) p[np++].fn = c->fn;
+        prof_t  *q = &p[np - 1];
+        uint64_t d = c->t1 - c->t0;
+        q->calls++;
+        if (c->outer) q->total += d;
+        q->self += d - c->child;
+        if (d > q->max) q->max = d;
+    }
+    qsort(p, np, sizeof *p, prof_cmp);
+    printf("%10s  %-14s %-14s %-14s %s\n", "calls", "total", "self", "max", "function");
+    for (size_t i = 0; i < np; i++) {
+        char name[512], t[48], s[48], m[48];
+        printf("%10zu  %-14s %-14s %-14s %s\n", p[i].calls, fmt_dur(p[i].total, t, sizeof t),
+               fmt_dur(p[i].self, s, sizeof s), fmt_dur(p[i].max, m, sizeof m), resolve(p[i].fn, name, sizeof name));
+    }
+    free(p);
+}
+
+typedef struct {
+    const unsigned char *p, *end;
+} rd_t;
+
+static bool take(rd_t *r, void *dst, size_t n) {
+    if ((size_t)(r->end - r->p) < n) return false;
+    memcpy(dst, r->p, n);
+    r->p += n;
+    return true;
+}
+
+static void usage(void) {
+    fputs(
+        "usage: c-log-trace [options] FILE\n"
+        "  -s         flat profile per function instead of the call tree\n"
+        "  -t TID     only this thread\n"
+        "  -d DEPTH   omit calls nested deeper than DEPTH\n",
+        stderr
+    );
+}
+
+int main(int argc, char **argv) {
+    bool     profile = false;
+    uint64_t only    = 0;
+    int      max_depth = -1, opt;
+    while ((opt = getopt(argc, argv, "st:d:h")) != -1) {
+        switch (opt) {
+            case 's': profile = true; break;
+            case 't': only = strtoull(optarg, NULL, 0); break;
+            case 'd': max_depth = atoi(optarg); break;
+            default: usage(); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage();
+        return 2;
+    }
+    const char *path = argv[optind];
+    int         fd   = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        fprintf(stderr, "c-log-trace: %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+    size_t               size = (size_t)sb.st_size;
+    const unsigned char *base = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    char     magic[8];
+    uint32_t hdr[4];
+    uint64_t t0[2];
+    rd_t     r = {base, base + size};
+    if (base == MAP_FAILED || !take(&r, magic, 8) || memcmp(magic, CLOG_TRACE_MAGIC, 8) != 0 ||
+        !take(&r, hdr, sizeof hdr) || hdr[0] != 0x01020304u || !take(&r, t0, sizeof t0)) {
+        fprintf(stderr, "c-log-trace: %s: not a trace dump from this architecture\n", path);
+        return 2;
+    }
+
+    for (uint32_t i = 0; i < hdr[1]; i++) {
+        uint64_t m[3];
+        uint32_t plen;
+        if (!take(&r, m, sizeof m) || !take(&r, &plen, sizeof plen) || (size_t)(r.end - r.p) < plen) goto bad;
+        add_map(m[0], m[1], m[2], (const char *)r.p, plen);
+        r.p += plen;
+    }
+
+    call_t             *calls = NULL;
+    size_t             *stack = NULL, cap_calls = 0, cap_stack = 0, total_calls = 0, unfinished = 0;
+    unsigned long long  events = 0, lost = 0;
+    for (uint32_t t = 0; t < hdr[2]; t++) {
+        uint64_t th[3];
+        if (!take(&r, th, sizeof th) || th[2] > (uint64_t)(r.end - r.p) / sizeof(clog_trace_event)) goto bad;
+        const unsigned char *ev = r.p;
+        r.p += th[2] * sizeof(clog_trace_event);
+        if (only && th[0] != only) continue;
+        events += th[2];
+        lost += th[1] - th[2];
+
+        /* the profile merges all threads, so their calls are kept back to back */
+        size_t first = profile ? total_calls : 0, ncalls = first, depth = 0;
+        for (uint64_t i = 0; i < th[2]; i++) {
+            clog_trace_event e;
+            memcpy(&e, ev + i * sizeof e, sizeof e);
+            uint64_t ts = e.ts & ~CLOG_TRACE_EXIT;
+            if (!(e.ts & CLOG_TRACE_EXIT)) {
+                if (!grow((void **)&calls, &cap_calls, ncalls + 1, sizeof *calls) ||
+                    !grow((void **)&stack, &cap_stack, depth + 1, sizeof *stack))
+                    goto oom;
+                bool outer = true;
+                for (size_t k = 0; k < depth && outer; k++) outer = calls[stack[k]].fn != e.fn;
+                calls[ncalls]  = (call_t){e.fn, ts, 0, 0, (int)depth, false, outer};
+                stack[depth++] = ncalls++;
+                continue;
+            }
+            /* unwind to the matching entry (longjmp or exceptions skip exits); none: its entry was overwritten */
+            size_t k = depth;
+            while (k && calls[stack[k - 1]].fn != e.fn) --k;
+            if (!k) continue;
+            depth     = k - 1;
+            call_t *c = &calls[stack[depth]];
+            c->t1     = ts;
+            c->done   = true;
+            if (depth) calls[stack[depth - 1]].child += ts - c->t0;
+        }
+        for (size_t i = first; i < ncalls; i++) {
+            if (!calls[i].done) ++unfinished;
+            if (!profile && (max_depth < 0 || calls[i].depth <= max_depth)) print_call(&calls[i], th[0], t0[0], t0[1]);
+        }
+        total_calls += ncalls - first;
+    }
+    if (profile) print_profile(calls, total_calls);
+    free(stack);
+    free(calls);
+    fflush(stdout);
+    fprintf(stderr, "%llu events in %u threads, %zu calls (%zu unfinished), %llu overwritten\n", events, hdr[2],
+            total_calls, unfinished, lost);
+    return 0;
+oom:
+    fprintf(stderr, "c-log-trace: out of memory\n");
+    return 2;
+bad:
+    fprintf(stderr, "c-log-trace: %s: truncated dump\n", path);
+    return 2;
+}